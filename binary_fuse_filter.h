@@ -0,0 +1,346 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: binary_fuse_filter.h
+// -----------------------------------------------------------------------------
+//
+// A sequence of independent binary fuse filters (e.g., one per stripe), stored
+// in a single fingerprint array. Binary fuse filters are smaller than Xor
+// filters (~1.13x vs. 1.23x the number of keys' fingerprints) and faster to
+// build, since the three positions of a key lie in consecutive segments.
+//
+// A key is hashed once (see Hash(..)); each filter only remixes that hash with
+// its seed, so probing many filters for the same key is cheap.
+//
+// Adapted from https://github.com/FastFilter/xor_singleheader (binaryfusefilter.h)
+// and Graf & Lemire, "Binary Fuse Filters: Fast and Smaller Than Xor Filters".
+
+#ifndef CI_BINARY_FUSE_FILTER_H_
+#define CI_BINARY_FUSE_FILTER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "common/bitmap.h"
+#include "common/int_hash.h"
+
+namespace ci {
+
+// `Fingerprint` is either uint8_t (~9 bits per key, false positive probability
+// of ~0.4%) or uint16_t (~18 bits per key, ~0.002%).
+template <typename Fingerprint>
+class BinaryFuseFilters {
+  static_assert(std::is_same<Fingerprint, uint8_t>::value ||
+                    std::is_same<Fingerprint, uint16_t>::value,
+                "Only 8-bit and 16-bit fingerprints are supported.");
+
+ public:
+  // Returns the hash of `key`, which is used for inserting and probing.
+  static uint64_t Hash(int key) { return HashInt(key); }
+
+  // Appends a filter containing the keys with the given `hashes`, which have to
+  // be duplicate free.
+  void AddFilter(absl::Span<const uint64_t> hashes) {
+    constexpr int kMaxIterations = 100;
+
+    Filter filter = CreateFilter(hashes.size());
+    filter.offset = fingerprints_.size();
+    const size_t array_length = filter.array_length();
+    if (fingerprints_.size() + array_length >
+        std::numeric_limits<uint32_t>::max()) {
+      std::cerr << "Binary fuse filters exceed 2^32 fingerprints." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    fingerprints_.resize(fingerprints_.size() + array_length, 0);
+    if (hashes.empty()) {
+      filters_.push_back(filter);
+      return;
+    }
+
+    // Peeling order: the filter-specific hash of each key and which of its
+    // three positions is "owned" by the key.
+    std::vector<uint64_t> stack_hashes(hashes.size());
+    std::vector<uint8_t> stack_positions(hashes.size());
+    // For each position: the number of keys (<< 2) XOR'd with the keys' index
+    // (0, 1, 2) of this position, and the XOR of the keys' hashes.
+    std::vector<uint8_t> counts(array_length);
+    std::vector<uint64_t> xors(array_length);
+    std::vector<uint32_t> queue;
+    queue.reserve(array_length);
+
+    uint64_t seed = 0x726b2b9d438b9d4dULL;
+    for (int iteration = 0;; ++iteration) {
+      if (iteration == kMaxIterations) {
+        std::cerr << "Couldn't populate binary fuse filter." << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      filter.seed = SplitMix64(&seed);
+      std::fill(counts.begin(), counts.end(), 0);
+      std::fill(xors.begin(), xors.end(), 0);
+      bool overflow = false;
+      for (const uint64_t key_hash : hashes) {
+        const uint64_t hash = FilterHash(key_hash, filter.seed);
+        uint32_t positions[3];
+        filter.GetPositions(hash, positions);
+        for (uint8_t i = 0; i < 3; ++i) {
+          // At most 63 keys per position fit into the counts.
+          overflow |= counts[positions[i]] >= 0xfc;
+          counts[positions[i]] += 4;
+          counts[positions[i]] ^= i;
+          xors[positions[i]] ^= hash;
+        }
+      }
+      if (overflow) continue;
+
+      // Peel positions with a single key until none are left.
+      queue.clear();
+      for (uint32_t i = 0; i < array_length; ++i) {
+        if ((counts[i] >> 2) == 1) queue.push_back(i);
+      }
+      size_t stack_size = 0;
+      while (!queue.empty()) {
+        const uint32_t position = queue.back();
+        queue.pop_back();
+        if ((counts[position] >> 2) != 1) continue;
+        const uint64_t hash = xors[position];
+        const uint8_t found = counts[position] & 3;
+        stack_hashes[stack_size] = hash;
+        stack_positions[stack_size] = found;
+        ++stack_size;
+
+        uint32_t positions[3];
+        filter.GetPositions(hash, positions);
+        for (uint8_t i = 0; i < 3; ++i) {
+          counts[positions[i]] -= 4;
+          counts[positions[i]] ^= i;
+          xors[positions[i]] ^= hash;
+          if (i != found && (counts[positions[i]] >> 2) == 1)
+            queue.push_back(positions[i]);
+        }
+      }
+      if (stack_size == hashes.size()) break;
+    }
+
+    // Assign fingerprints in reverse peeling order.
+    Fingerprint* fingerprints = fingerprints_.data() + filter.offset;
+    for (size_t i = hashes.size(); i-- > 0;) {
+      const uint64_t hash = stack_hashes[i];
+      uint32_t positions[3];
+      filter.GetPositions(hash, positions);
+      const uint8_t found = stack_positions[i];
+      fingerprints[positions[found]] =
+          GetFingerprint(hash) ^
+          fingerprints[positions[(found + 1) % 3]] ^
+          fingerprints[positions[(found + 2) % 3]];
+    }
+    filters_.push_back(filter);
+  }
+
+  // Returns the number of filters.
+  size_t num_filters() const { return filters_.size(); }
+
+  // Returns true if the given filter may contain the key with `hash`.
+  bool Contains(size_t filter, uint64_t hash) const {
+    return FilterContains(filters_[filter], hash);
+  }
+
+  // Sets the bits of the filters [0, `result->bits()`) that may contain the
+  // key with `hash` in `result`.
+  void ContainsAll(uint64_t hash, Bitmap64* result) const {
+    const size_t num_filters = std::min(result->bits(), filters_.size());
+    for (size_t i = 0; i < num_filters; ++i) {
+      if (FilterContains(filters_[i], hash)) result->Set(i, true);
+    }
+  }
+
+  // Like ContainsAll(..), but only probes the filters set in `candidates`.
+  void ContainsAmong(uint64_t hash, const Bitmap64& candidates,
+                     Bitmap64* result) const {
+    const size_t num_filters = std::min(result->bits(), filters_.size());
+    for (const size_t i : candidates.TrueBitIndices()) {
+      if (i >= num_filters) break;
+      if (FilterContains(filters_[i], hash)) result->Set(i, true);
+    }
+  }
+
+  size_t byte_size() const {
+    return fingerprints_.size() * sizeof(Fingerprint) +
+           filters_.size() * sizeof(Filter);
+  }
+
+  // Appends the binary encoding of the filters to `out`. Layout: number of
+  // filters, per filter its seed, number of keys and offset, followed by all
+  // fingerprints.
+  void Encode(std::string* out) const {
+    PutValue(static_cast<uint32_t>(filters_.size()), out);
+    for (const Filter& filter : filters_) {
+      PutValue(filter.seed, out);
+      PutValue(filter.num_keys, out);
+      PutValue(filter.offset, out);
+    }
+    out->append(reinterpret_cast<const char*>(fingerprints_.data()),
+                fingerprints_.size() * sizeof(Fingerprint));
+  }
+
+  // Decodes filters encoded with Encode(..).
+  static BinaryFuseFilters Decode(absl::string_view encoded) {
+    BinaryFuseFilters decoded;
+    size_t pos = 0;
+    const uint32_t num_filters = GetValue<uint32_t>(encoded, &pos);
+    decoded.filters_.reserve(num_filters);
+    size_t num_fingerprints = 0;
+    for (uint32_t i = 0; i < num_filters; ++i) {
+      const uint64_t seed = GetValue<uint64_t>(encoded, &pos);
+      const uint32_t num_keys = GetValue<uint32_t>(encoded, &pos);
+      Filter filter = CreateFilter(num_keys);
+      filter.seed = seed;
+      filter.offset = GetValue<uint32_t>(encoded, &pos);
+      num_fingerprints += filter.array_length();
+      decoded.filters_.push_back(filter);
+    }
+    if (encoded.size() - pos != num_fingerprints * sizeof(Fingerprint)) {
+      std::cerr << "Invalid binary fuse filter encoding." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    decoded.fingerprints_.resize(num_fingerprints);
+    std::memcpy(decoded.fingerprints_.data(), encoded.data() + pos,
+                num_fingerprints * sizeof(Fingerprint));
+    return decoded;
+  }
+
+ private:
+  // Parameters of a single filter. Everything but `seed` and `offset` is
+  // derived from the number of keys.
+  struct Filter {
+    uint64_t seed = 0;
+    uint32_t num_keys = 0;
+    // Offset of the filter's first fingerprint in `fingerprints_`.
+    uint32_t offset = 0;
+    uint32_t segment_length = 0;
+    uint32_t segment_length_mask = 0;
+    uint32_t segment_count = 0;
+    uint32_t segment_count_length = 0;
+
+    size_t array_length() const {
+      return num_keys == 0
+                 ? 0
+                 : static_cast<size_t>(segment_count + 2) * segment_length;
+    }
+
+    // Returns the three positions (one per consecutive segment) of the key
+    // with the filter-specific `hash`.
+    void GetPositions(uint64_t hash, uint32_t positions[3]) const {
+      const uint64_t h0 =
+          absl::Uint128High64(absl::uint128(hash) * segment_count_length);
+      positions[0] = static_cast<uint32_t>(h0);
+      positions[1] = static_cast<uint32_t>(h0 + segment_length) ^
+                     static_cast<uint32_t>((hash >> 18) & segment_length_mask);
+      positions[2] = static_cast<uint32_t>(h0 + 2 * segment_length) ^
+                     static_cast<uint32_t>(hash & segment_length_mask);
+    }
+  };
+
+  // Returns the parameters of a filter with `num_keys` keys (see Section 5 of
+  // the paper).
+  static Filter CreateFilter(size_t num_keys) {
+    Filter filter;
+    filter.num_keys = static_cast<uint32_t>(num_keys);
+    if (num_keys == 0) return filter;
+    const double size = static_cast<double>(std::max<size_t>(num_keys, 2));
+    filter.segment_length = std::min<uint32_t>(
+        uint32_t{1} << static_cast<int>(std::floor(
+            std::log(size) / std::log(3.33) + 2.25)),
+        uint32_t{1} << 18);
+    filter.segment_length_mask = filter.segment_length - 1;
+    const double size_factor =
+        std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(size));
+    const size_t capacity = static_cast<size_t>(std::round(size * size_factor));
+    const size_t num_segments =
+        (capacity + filter.segment_length - 1) / filter.segment_length;
+    filter.segment_count =
+        num_segments <= 2 ? 1 : static_cast<uint32_t>(num_segments - 2);
+    filter.segment_count_length = filter.segment_count * filter.segment_length;
+    return filter;
+  }
+
+  // Remixes the key's hash with the filter's seed.
+  static uint64_t FilterHash(uint64_t hash, uint64_t seed) {
+    uint64_t h = hash + seed;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  static Fingerprint GetFingerprint(uint64_t hash) {
+    return static_cast<Fingerprint>(hash ^ (hash >> 32));
+  }
+
+  static uint64_t SplitMix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  bool FilterContains(const Filter& filter, uint64_t key_hash) const {
+    if (filter.num_keys == 0) return false;
+    const uint64_t hash = FilterHash(key_hash, filter.seed);
+    uint32_t positions[3];
+    filter.GetPositions(hash, positions);
+    const Fingerprint* fingerprints = fingerprints_.data() + filter.offset;
+    return GetFingerprint(hash) == (fingerprints[positions[0]] ^
+                                    fingerprints[positions[1]] ^
+                                    fingerprints[positions[2]]);
+  }
+
+  template <typename T>
+  static void PutValue(T value, std::string* out) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  static T GetValue(absl::string_view encoded, size_t* pos) {
+    if (*pos + sizeof(T) > encoded.size()) {
+      std::cerr << "Invalid binary fuse filter encoding." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    T value;
+    std::memcpy(&value, encoded.data() + *pos, sizeof(T));
+    *pos += sizeof(T);
+    return value;
+  }
+
+  std::vector<Filter> filters_;
+  std::vector<Fingerprint> fingerprints_;
+};
+
+using BinaryFuse8Filters = BinaryFuseFilters<uint8_t>;
+using BinaryFuse16Filters = BinaryFuseFilters<uint16_t>;
+
+}  // namespace ci
+
+#endif  // CI_BINARY_FUSE_FILTER_H_
@@ -0,0 +1,94 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// File: binary_fuse_filter_test.cc
+// -----------------------------------------------------------------------------
+
+#include "binary_fuse_filter.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "gtest/gtest.h"
+#include "stripe_filters_test_util.h"
+
+namespace ci {
+namespace {
+
+template <typename FuseFilters>
+struct BinaryFuseConfig {
+  using Filters = FuseFilters;
+  static void AddFilter(absl::Span<const uint64_t> hashes, Filters* filters) {
+    filters->AddFilter(hashes);
+  }
+};
+
+using Configs = ::testing::Types<BinaryFuseConfig<BinaryFuse8Filters>,
+                                 BinaryFuseConfig<BinaryFuse16Filters>>;
+INSTANTIATE_TYPED_TEST_SUITE_P(BinaryFuse, StripeFiltersTest, Configs);
+
+template <typename Filters>
+class BinaryFuseFiltersTest : public ::testing::Test {};
+
+using FilterTypes = ::testing::Types<BinaryFuse8Filters, BinaryFuse16Filters>;
+TYPED_TEST_SUITE(BinaryFuseFiltersTest, FilterTypes);
+
+TYPED_TEST(BinaryFuseFiltersTest, FalsePositiveRate) {
+  const TypeParam filters = CreateStripeFilters<BinaryFuseConfig<TypeParam>>();
+  // Probe the largest filter with keys that aren't in it.
+  const size_t filter = kNumStripeFilters - 1;
+  const int num_probes = 100000;
+  size_t num_false_positives = 0;
+  for (int key = -num_probes; key < 0; ++key)
+    num_false_positives += filters.Contains(filter, TypeParam::Hash(key));
+  EXPECT_LT(static_cast<double>(num_false_positives) / num_probes, 0.01);
+}
+
+TYPED_TEST(BinaryFuseFiltersTest, EncodeDecode) {
+  const TypeParam filters = CreateStripeFilters<BinaryFuseConfig<TypeParam>>();
+  std::string encoded;
+  filters.Encode(&encoded);
+  const TypeParam decoded = TypeParam::Decode(encoded);
+
+  ASSERT_EQ(decoded.num_filters(), kNumStripeFilters);
+  for (int key = -1000; key < StripeFilterOffset(kNumStripeFilters); ++key) {
+    const uint64_t hash = TypeParam::Hash(key);
+    for (size_t i = 0; i < kNumStripeFilters; ++i)
+      EXPECT_EQ(decoded.Contains(i, hash), filters.Contains(i, hash));
+  }
+  std::string reencoded;
+  decoded.Encode(&reencoded);
+  EXPECT_EQ(reencoded, encoded);
+}
+
+TEST(BinaryFuseFiltersTest, SmallerThanXorFilters) {
+  constexpr int kNumKeys = 1000000;
+  std::vector<uint64_t> hashes;
+  for (int key = 0; key < kNumKeys; ++key)
+    hashes.push_back(BinaryFuse8Filters::Hash(key));
+  BinaryFuse8Filters filters;
+  filters.AddFilter(hashes);
+
+  std::string encoded;
+  filters.Encode(&encoded);
+  // Xor filters use ~1.23 bytes per key, binary fuse filters ~1.13 bytes.
+  EXPECT_LT(encoded.size(), 1.15 * kNumKeys);
+}
+
+}  // namespace
+}  // namespace ci
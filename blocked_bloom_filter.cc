@@ -0,0 +1,177 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: blocked_bloom_filter.cc
+// -----------------------------------------------------------------------------
+
+#include "blocked_bloom_filter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CI_BLOCKED_BLOOM_AVX2 1
+#endif
+
+namespace ci {
+namespace {
+
+// Odd constants for deriving the bit of each word from the key's hash.
+constexpr uint32_t kSalts[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU,
+                                0xa2b7289dU, 0x705495c7U, 0x2df1424bU,
+                                0x9efc4947U, 0x5c6bfb31U};
+
+// Returns the bit to set in `word` (one of 8) for the (lower 32 bits of the)
+// hash `key`.
+inline uint32_t WordMask(uint32_t key, size_t word) {
+  return uint32_t{1} << ((key * kSalts[word]) >> 27);
+}
+
+inline bool BlockContains(const uint32_t* words, uint32_t key) {
+  for (size_t i = 0; i < 8; ++i) {
+    if ((words[i] & WordMask(key, i)) == 0) return false;
+  }
+  return true;
+}
+
+#ifdef CI_BLOCKED_BLOOM_AVX2
+__attribute__((target("avx2"))) inline bool BlockContainsAvx2(
+    const uint32_t* words, uint32_t key) {
+  const __m256i salts =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kSalts));
+  const __m256i shifts = _mm256_srli_epi32(
+      _mm256_mullo_epi32(_mm256_set1_epi32(key), salts), 27);
+  const __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+  const __m256i block =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(words));
+  // True iff all bits of `mask` are set in `block`.
+  return _mm256_testc_si256(block, mask);
+}
+
+#endif
+
+std::atomic<bool> avx2_enabled{true};
+
+bool UseAvx2() {
+#ifdef CI_BLOCKED_BLOOM_AVX2
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2 && avx2_enabled.load(std::memory_order_relaxed);
+#else
+  return false;
+#endif
+}
+
+// Probes the filters in [0, `num_filters`) (if `candidates` is null) or the
+// ones set in `candidates`.
+template <typename GetBlock>
+void ProbeFilters(size_t num_filters, const Bitmap64* candidates, uint32_t key,
+                  const GetBlock& get_block, Bitmap64* result) {
+  if (candidates == nullptr) {
+    for (size_t filter = 0; filter < num_filters; ++filter) {
+      if (BlockContains(get_block(filter), key)) result->Set(filter, true);
+    }
+    return;
+  }
+  for (const size_t filter : candidates->TrueBitIndices()) {
+    if (filter >= num_filters) break;
+    if (BlockContains(get_block(filter), key)) result->Set(filter, true);
+  }
+}
+
+#ifdef CI_BLOCKED_BLOOM_AVX2
+// Same as above, but using AVX2.
+template <typename GetBlock>
+__attribute__((target("avx2"))) void ProbeFiltersAvx2(
+    size_t num_filters, const Bitmap64* candidates, uint32_t key,
+    const GetBlock& get_block, Bitmap64* result) {
+  if (candidates == nullptr) {
+    for (size_t filter = 0; filter < num_filters; ++filter) {
+      if (BlockContainsAvx2(get_block(filter), key)) result->Set(filter, true);
+    }
+    return;
+  }
+  for (const size_t filter : candidates->TrueBitIndices()) {
+    if (filter >= num_filters) break;
+    if (BlockContainsAvx2(get_block(filter), key)) result->Set(filter, true);
+  }
+}
+#endif
+
+}  // namespace
+
+void BlockedBloomFilters::SetAvx2Enabled(bool enabled) {
+  avx2_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void BlockedBloomFilters::AddFilter(absl::Span<const uint64_t> hashes,
+                                    size_t num_bits_per_key) {
+  const size_t num_blocks = std::max<size_t>(
+      1, (hashes.size() * num_bits_per_key + kBlockBits - 1) / kBlockBits);
+  const size_t offset = blocks_.size();
+  if (offset + num_blocks > std::numeric_limits<uint32_t>::max()) {
+    std::cerr << "Blocked Bloom filters exceed 2^32 blocks." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  blocks_.resize(offset + num_blocks, Block{});
+  offsets_.push_back(offset + num_blocks);
+
+  const size_t filter = num_filters() - 1;
+  for (const uint64_t hash : hashes) {
+    Block& block = blocks_[BlockIndex(filter, hash)];
+    for (size_t i = 0; i < 8; ++i)
+      block.words[i] |= WordMask(static_cast<uint32_t>(hash), i);
+  }
+}
+
+bool BlockedBloomFilters::Contains(size_t filter, uint64_t hash) const {
+  const uint32_t* words = blocks_[BlockIndex(filter, hash)].words;
+#ifdef CI_BLOCKED_BLOOM_AVX2
+  if (UseAvx2()) return BlockContainsAvx2(words, static_cast<uint32_t>(hash));
+#endif
+  return BlockContains(words, static_cast<uint32_t>(hash));
+}
+
+void BlockedBloomFilters::ContainsAll(uint64_t hash, Bitmap64* result) const {
+  Probe(hash, /*candidates=*/nullptr, result);
+}
+
+void BlockedBloomFilters::ContainsAmong(uint64_t hash,
+                                        const Bitmap64& candidates,
+                                        Bitmap64* result) const {
+  Probe(hash, &candidates, result);
+}
+
+void BlockedBloomFilters::Probe(uint64_t hash, const Bitmap64* candidates,
+                                Bitmap64* result) const {
+  const size_t num_filters = std::min(result->bits(), this->num_filters());
+  const auto get_block = [this, hash](size_t filter) {
+    return blocks_[BlockIndex(filter, hash)].words;
+  };
+  const uint32_t key = static_cast<uint32_t>(hash);
+  // Dispatch once per call rather than once per filter.
+#ifdef CI_BLOCKED_BLOOM_AVX2
+  if (UseAvx2()) {
+    ProbeFiltersAvx2(num_filters, candidates, key, get_block, result);
+    return;
+  }
+#endif
+  ProbeFilters(num_filters, candidates, key, get_block, result);
+}
+
+}  // namespace ci
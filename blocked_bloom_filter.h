@@ -0,0 +1,114 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: blocked_bloom_filter.h
+// -----------------------------------------------------------------------------
+//
+// A sequence of independent split-block Bloom filters (e.g., one per stripe),
+// stored in a single buffer.
+//
+// Each filter consists of 256-bit blocks, aligned such that a block never
+// crosses a cache line. A key is hashed once (see Hash(..)) and the same hash
+// is used for probing every filter: its upper 32 bits select the block, its
+// lower 32 bits set one bit in each of the block's eight 32-bit words. Hence, a
+// probe touches a single block, and (with AVX2) checks all eight bits with a
+// few vector instructions.
+//
+// Adapted from the split-block Bloom filters of Apache Impala and Parquet, see
+// also Putze et al., "Cache-, Hash- and Space-Efficient Bloom Filters".
+
+#ifndef CI_BLOCKED_BLOOM_FILTER_H_
+#define CI_BLOCKED_BLOOM_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "common/bitmap.h"
+#include "common/int_hash.h"
+
+namespace ci {
+
+class BlockedBloomFilters {
+ public:
+  // Number of bits per block.
+  static constexpr size_t kBlockBits = 256;
+
+  BlockedBloomFilters() : offsets_({0}) {}
+
+  // Returns the hash of `key`, which is used for inserting and probing.
+  static uint64_t Hash(int key) { return HashInt(key); }
+
+  // Appends a filter containing the keys with the given `hashes`, which have to
+  // be duplicate free, using `num_bits_per_key` bits per key.
+  void AddFilter(absl::Span<const uint64_t> hashes, size_t num_bits_per_key);
+
+  // Returns the number of filters.
+  size_t num_filters() const { return offsets_.size() - 1; }
+
+  // Returns true if the given filter may contain the key with `hash`.
+  bool Contains(size_t filter, uint64_t hash) const;
+
+  // Sets the bits of the filters [0, `result->bits()`) that may contain the
+  // key with `hash` in `result`.
+  void ContainsAll(uint64_t hash, Bitmap64* result) const;
+
+  // Like ContainsAll(..), but only probes the filters set in `candidates`.
+  void ContainsAmong(uint64_t hash, const Bitmap64& candidates,
+                     Bitmap64* result) const;
+
+  // Enables or disables probing with AVX2 where the CPU supports it (enabled by
+  // default). Disabling it forces the portable code path, e.g., for testing
+  // that both paths agree.
+  static void SetAvx2Enabled(bool enabled);
+
+  // Returns the blocks of all filters.
+  absl::string_view Data() const {
+    return absl::string_view(reinterpret_cast<const char*>(blocks_.data()),
+                             blocks_.size() * sizeof(Block));
+  }
+
+  size_t byte_size() const {
+    return blocks_.size() * sizeof(Block) + offsets_.size() * sizeof(uint32_t);
+  }
+
+ private:
+  struct alignas(32) Block {
+    uint32_t words[8];
+  };
+
+  // Probes the filters set in `candidates` (or all filters if null).
+  void Probe(uint64_t hash, const Bitmap64* candidates,
+             Bitmap64* result) const;
+
+  // Returns the index of the block of `filter` that the key with `hash` maps
+  // to.
+  size_t BlockIndex(size_t filter, uint64_t hash) const {
+    const uint64_t num_blocks = offsets_[filter + 1] - offsets_[filter];
+    // Maps the upper 32 bits to [0, num_blocks) without a division.
+    return offsets_[filter] + (((hash >> 32) * num_blocks) >> 32);
+  }
+
+  std::vector<Block> blocks_;
+  // Offset of each filter's first block in `blocks_`, followed by the total
+  // number of blocks.
+  std::vector<uint32_t> offsets_;
+};
+
+}  // namespace ci
+
+#endif  // CI_BLOCKED_BLOOM_FILTER_H_
@@ -0,0 +1,106 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: blocked_bloom_filter_test.cc
+// -----------------------------------------------------------------------------
+
+#include "blocked_bloom_filter.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "common/bitmap.h"
+#include "gtest/gtest.h"
+#include "stripe_filters_test_util.h"
+
+namespace ci {
+namespace {
+
+struct BloomConfig {
+  using Filters = BlockedBloomFilters;
+  static void AddFilter(absl::Span<const uint64_t> hashes, Filters* filters) {
+    filters->AddFilter(hashes, /*num_bits_per_key=*/10);
+  }
+};
+
+INSTANTIATE_TYPED_TEST_SUITE_P(BlockedBloom, StripeFiltersTest, BloomConfig);
+
+constexpr size_t kNumFilters = 8;
+constexpr size_t kNumKeysPerFilter = 1000;
+
+// Returns the hash of the (small, non-negative) `key`.
+uint64_t KeyHash(size_t key) {
+  return BlockedBloomFilters::Hash(static_cast<int>(key));
+}
+
+// Filter `i` contains the keys [i * kNumKeysPerFilter, (i + 1) *
+// kNumKeysPerFilter).
+BlockedBloomFilters CreateFilters(size_t num_bits_per_key) {
+  BlockedBloomFilters filters;
+  for (size_t i = 0; i < kNumFilters; ++i) {
+    std::vector<uint64_t> hashes;
+    for (size_t key = 0; key < kNumKeysPerFilter; ++key)
+      hashes.push_back(KeyHash(i * kNumKeysPerFilter + key));
+    filters.AddFilter(hashes, num_bits_per_key);
+  }
+  return filters;
+}
+
+TEST(BlockedBloomFiltersTest, FalsePositiveRate) {
+  const BlockedBloomFilters filters = CreateFilters(/*num_bits_per_key=*/10);
+  // Probe filter 0 with keys of the other filters.
+  size_t num_false_positives = 0;
+  const size_t num_probes = (kNumFilters - 1) * kNumKeysPerFilter;
+  for (size_t key = kNumKeysPerFilter; key < kNumKeysPerFilter + num_probes;
+       ++key) {
+    if (filters.Contains(0, KeyHash(key))) ++num_false_positives;
+  }
+  // Split-block Bloom filters have a FPR of ~1% with 10 bits per key.
+  EXPECT_LT(static_cast<double>(num_false_positives) / num_probes, 0.03);
+}
+
+TEST(BlockedBloomFiltersTest, ScalarMatchesAvx2) {
+  const BlockedBloomFilters filters = CreateFilters(/*num_bits_per_key=*/4);
+  Bitmap64 candidates(/*size=*/kNumFilters);
+  candidates.Set(0, true);
+  candidates.Set(5, true);
+
+  for (size_t key = 0; key < 2 * kNumFilters * kNumKeysPerFilter; ++key) {
+    const uint64_t hash = KeyHash(key);
+    Bitmap64 all[2] = {Bitmap64(/*size=*/kNumFilters),
+                       Bitmap64(/*size=*/kNumFilters)};
+    Bitmap64 among[2] = {Bitmap64(/*size=*/kNumFilters),
+                         Bitmap64(/*size=*/kNumFilters)};
+    std::vector<bool> contains[2];
+    // Uses AVX2 (if supported by the CPU) first, then the scalar code.
+    for (const int scalar : {0, 1}) {
+      BlockedBloomFilters::SetAvx2Enabled(scalar == 0);
+      filters.ContainsAll(hash, &all[scalar]);
+      filters.ContainsAmong(hash, candidates, &among[scalar]);
+      for (size_t i = 0; i < kNumFilters; ++i)
+        contains[scalar].push_back(filters.Contains(i, hash));
+    }
+    BlockedBloomFilters::SetAvx2Enabled(true);
+    for (size_t i = 0; i < kNumFilters; ++i) {
+      EXPECT_EQ(all[0].Get(i), all[1].Get(i));
+      EXPECT_EQ(among[0].Get(i), among[1].Get(i));
+    }
+    EXPECT_EQ(contains[0], contains[1]);
+  }
+}
+
+}  // namespace
+}  // namespace ci
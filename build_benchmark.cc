@@ -76,26 +76,22 @@
 // BuildTime/Synthethic_10000000/65536/PerStripeXor                  3.83 ns
 
 #include <cstdlib>
+#include <fstream>
 #include <random>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "benchmark/benchmark.h"
+#include "common/perf_counters.h"
 #include "common/profiling.h"
 #include "cuckoo_index.h"
 #include "cuckoo_utils.h"
 #include "index_structure.h"
+#include "per_stripe_binary_fuse.h"
 #include "per_stripe_bloom.h"
 #include "per_stripe_xor.h"
+#include "table_flags.h"
 
-ABSL_FLAG(int, generate_num_values, 100000,
-"Number of values to generate (number of rows).");
-ABSL_FLAG(int, num_unique_values, 1000,
-"Number of unique values to generate (cardinality).");
-ABSL_FLAG(std::string, input_csv_path, "", "Path to the input CSV file.");
-ABSL_FLAG(std::vector<std::string>, columns_to_test, {},
-          "Comma-separated list of columns to tests, e.g. "
-          "'company_name,country_code'.");
 ABSL_FLAG(std::string, sorting, "NONE",
           "Sorting to apply to the data. Supported values: 'NONE', "
           "'BY_CARDINALITY' (sorts lexicographically, starting with columns "
@@ -117,6 +113,7 @@ void BM_BuildTime(const ci::Column& column,
                   size_t num_rows_per_stripe, benchmark::State& state) {
   ci::Profiler::GetThreadInstance().Reset();
 
+  ci::ScopedPerfCounters perf_counters(state);
   for (auto _ : state) {
     benchmark::DoNotOptimize(factory.Create(column, num_rows_per_stripe));
   }
@@ -136,32 +133,16 @@ void BM_BuildTime(const ci::Column& column,
   state.counters["5-GetGlobalBitmap"] = benchmark::Counter(
       ci::Profiler::GetThreadInstance().GetValue(ci::Counter::GetGlobalBitmap),
       benchmark::Counter::kAvgIterations);
+  state.counters["6-EncodeIndex"] = benchmark::Counter(
+      ci::Profiler::GetThreadInstance().GetValue(ci::Counter::EncodeIndex),
+      benchmark::Counter::kAvgIterations);
 }
 
 int main(int argc, char* argv[]) {
   absl::ParseCommandLine(argc, argv);
 
-  const size_t generate_num_values = absl::GetFlag(FLAGS_generate_num_values);
-  const size_t num_unique_values = absl::GetFlag(FLAGS_num_unique_values);
-  const std::string input_csv_path = absl::GetFlag(FLAGS_input_csv_path);
-  const std::vector<std::string>
-      columns_to_test = absl::GetFlag(FLAGS_columns_to_test);
-
   // Define data.
-  std::unique_ptr<ci::Table> table;
-  if (input_csv_path.empty() || columns_to_test.empty()) {
-    std::cerr
-        << "[WARNING] --input_csv_path or --columns_to_test not specified, "
-           "generating synthetic data." << std::endl;
-    std::cout << "Generating " << generate_num_values << " values ("
-              << static_cast<double>(num_unique_values) / generate_num_values
-                  * 100 << "% unique)..." << std::endl;
-    table = ci::GenerateUniformData(generate_num_values, num_unique_values);
-  } else {
-    std::cout << "Loading data from file " << input_csv_path << "..."
-              << std::endl;
-    table = ci::Table::FromCsv(input_csv_path, columns_to_test);
-  }
+  std::unique_ptr<ci::Table> table = ci::LoadTableFromFlags();
 
   // Potentially sort the data.
   const std::string sorting = absl::GetFlag(FLAGS_sorting);
@@ -186,6 +167,10 @@ int main(int argc, char* argv[]) {
   index_factories.push_back(
       absl::make_unique<ci::PerStripeBloomFactory>(/*num_bits_per_key=*/10));
   index_factories.push_back(absl::make_unique<ci::PerStripeXorFactory>());
+  index_factories.push_back(
+      absl::make_unique<ci::PerStripeBinaryFuse8Factory>());
+  index_factories.push_back(
+      absl::make_unique<ci::PerStripeBinaryFuse16Factory>());
 
   // Set up the benchmarks.
   for (const std::unique_ptr<ci::Column>& column : table->GetColumns()) {
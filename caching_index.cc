@@ -0,0 +1,139 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: caching_index.cc
+// -----------------------------------------------------------------------------
+
+#include "caching_index.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include "absl/hash/hash.h"
+
+namespace ci {
+
+CachingIndex::CachingIndex(IndexStructurePtr index, size_t max_cache_bytes,
+                           size_t num_shards)
+    : index_(std::move(index)),
+      max_shard_bytes_(num_shards == 0 ? 0 : max_cache_bytes / num_shards),
+      shards_(new Shard[num_shards]),
+      num_shards_(num_shards) {
+  if (num_shards_ == 0) {
+    std::cerr << "CachingIndex needs at least one shard." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+Bitmap64 CachingIndex::GetQualifyingStripes(int value,
+                                            size_t num_stripes) const {
+  Shard& shard = GetShard(value);
+  {
+    absl::MutexLock lock(&shard.mutex);
+    const auto it = shard.entries.find(value);
+    if (it != shard.entries.end() && it->second->num_stripes == num_stripes) {
+      // Move the entry to the front of the LRU list.
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      num_hits_.fetch_add(1, std::memory_order_relaxed);
+      return Decompress(*it->second);
+    }
+  }
+  num_misses_.fetch_add(1, std::memory_order_relaxed);
+
+  // Look up the value without holding the lock.
+  Bitmap64 result = index_->GetQualifyingStripes(value, num_stripes);
+  Entry entry = Compress(value, num_stripes, result);
+  const size_t entry_bytes = entry.byte_size();
+  if (entry_bytes > max_shard_bytes_) return result;
+
+  absl::MutexLock lock(&shard.mutex);
+  const auto it = shard.entries.find(value);
+  if (it != shard.entries.end()) {
+    // Another thread inserted the value in the meantime (or it was cached for
+    // a different number of stripes): replace it.
+    shard.byte_size -= it->second->byte_size();
+    shard.lru.erase(it->second);
+    shard.entries.erase(it);
+  }
+  // Evict the least recently used entries.
+  while (shard.byte_size + entry_bytes > max_shard_bytes_) {
+    const Entry& victim = shard.lru.back();
+    shard.byte_size -= victim.byte_size();
+    shard.entries.erase(victim.value);
+    shard.lru.pop_back();
+    num_evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  shard.lru.push_front(std::move(entry));
+  shard.entries[value] = shard.lru.begin();
+  shard.byte_size += entry_bytes;
+  return result;
+}
+
+size_t CachingIndex::cache_byte_size() const {
+  size_t byte_size = 0;
+  for (size_t i = 0; i < num_shards_; ++i) {
+    absl::MutexLock lock(&shards_[i].mutex);
+    byte_size += shards_[i].byte_size;
+  }
+  return byte_size;
+}
+
+void CachingIndex::Clear() {
+  for (size_t i = 0; i < num_shards_; ++i) {
+    absl::MutexLock lock(&shards_[i].mutex);
+    shards_[i].lru.clear();
+    shards_[i].entries.clear();
+    shards_[i].byte_size = 0;
+  }
+  num_hits_ = 0;
+  num_misses_ = 0;
+  num_evictions_ = 0;
+}
+
+CachingIndex::Entry CachingIndex::Compress(int value, size_t num_stripes,
+                                           const Bitmap64& bitmap) {
+  Entry entry;
+  entry.value = value;
+  entry.num_stripes = num_stripes;
+  entry.num_bits = bitmap.bits();
+  const size_t num_words = (bitmap.bits() + 63) / 64;
+  const size_t num_ones = bitmap.GetOnesCount();
+  entry.is_sparse = num_ones * sizeof(uint32_t) < num_words * sizeof(uint64_t);
+  if (entry.is_sparse) {
+    entry.positions.reserve(num_ones);
+    for (const size_t pos : bitmap.TrueBitIndices())
+      entry.positions.push_back(pos);
+  } else {
+    entry.words.resize(num_words, 0);
+    for (const size_t pos : bitmap.TrueBitIndices())
+      entry.words[pos / 64] |= uint64_t{1} << (pos % 64);
+  }
+  return entry;
+}
+
+Bitmap64 CachingIndex::Decompress(const Entry& entry) {
+  if (!entry.is_sparse)
+    return Bitmap64::FromWords(entry.words.data(), entry.num_bits);
+  Bitmap64 bitmap(/*size=*/entry.num_bits);
+  for (const uint32_t pos : entry.positions) bitmap.Set(pos, true);
+  return bitmap;
+}
+
+CachingIndex::Shard& CachingIndex::GetShard(int value) const {
+  return shards_[absl::Hash<int>()(value) % num_shards_];
+}
+
+}  // namespace ci
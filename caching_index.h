@@ -0,0 +1,170 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: caching_index.h
+// -----------------------------------------------------------------------------
+//
+// An IndexStructure wrapper that caches the qualifying stripes of recently
+// looked up values. Useful for skewed workloads where a small set of hot keys
+// accounts for most lookups. The cache is sharded by value (each shard has its
+// own lock and LRU list) and bounded in its total byte size. Cached results
+// are stored compactly, either as positions of set bits or as raw words.
+
+#ifndef CUCKOO_INDEX_CACHING_INDEX_H_
+#define CUCKOO_INDEX_CACHING_INDEX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "common/bitmap.h"
+#include "index_structure.h"
+
+namespace ci {
+
+class CachingIndex : public IndexStructure {
+ public:
+  static constexpr size_t kDefaultNumShards = 16;
+
+  // Caches results of `index` using up to `max_cache_bytes` (summed up over
+  // all `num_shards` shards).
+  CachingIndex(IndexStructurePtr index, size_t max_cache_bytes,
+               size_t num_shards = kDefaultNumShards);
+
+  bool StripeContains(size_t stripe_id, int value) const override {
+    return index_->StripeContains(stripe_id, value);
+  }
+
+  // Thread-safe. Returns the cached result for `value` if present, otherwise
+  // looks it up in the wrapped index and caches it.
+  Bitmap64 GetQualifyingStripes(int value, size_t num_stripes) const override;
+
+  Bitmap64 GetQualifyingStripesIn(absl::Span<const int> values,
+                                  size_t num_stripes) const override {
+    return index_->GetQualifyingStripesIn(values, num_stripes);
+  }
+
+  Bitmap64 GetQualifyingStripesAmong(
+      int value, const Bitmap64& candidate_stripes) const override {
+    return index_->GetQualifyingStripesAmong(value, candidate_stripes);
+  }
+
+  double EstimateSelectivity(int value, size_t num_stripes) const override {
+    return index_->EstimateSelectivity(value, num_stripes);
+  }
+
+  std::string name() const override { return index_->name() + ":cached"; }
+
+  // Sizes of the wrapped index (the cache is not persisted).
+  size_t byte_size() const override { return index_->byte_size(); }
+  size_t compressed_byte_size() const override {
+    return index_->compressed_byte_size();
+  }
+
+  size_t num_hits() const { return num_hits_.load(std::memory_order_relaxed); }
+  size_t num_misses() const {
+    return num_misses_.load(std::memory_order_relaxed);
+  }
+  size_t num_evictions() const {
+    return num_evictions_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the current size of all cached results in bytes.
+  size_t cache_byte_size() const;
+
+  // Removes all cached results and resets the counters.
+  void Clear();
+
+ private:
+  // A compactly stored result.
+  struct Entry {
+    int value;
+    // Requested number of stripes (part of the cache key).
+    size_t num_stripes;
+    // Size of the cached bitmap, which may differ from `num_stripes` (e.g.,
+    // CuckooIndex returns all of its stripes for positive lookups).
+    size_t num_bits;
+    // Either the positions of the set bits (for sparse results) or the raw
+    // 64-bit words of the bitmap.
+    bool is_sparse;
+    std::vector<uint32_t> positions;
+    std::vector<uint64_t> words;
+
+    size_t byte_size() const {
+      return sizeof(Entry) + positions.size() * sizeof(uint32_t) +
+             words.size() * sizeof(uint64_t);
+    }
+  };
+
+  struct Shard {
+    mutable absl::Mutex mutex;
+    // Most recently used entries first.
+    std::list<Entry> lru ABSL_GUARDED_BY(mutex);
+    absl::flat_hash_map<int, std::list<Entry>::iterator> entries
+        ABSL_GUARDED_BY(mutex);
+    size_t byte_size ABSL_GUARDED_BY(mutex) = 0;
+  };
+
+  // Compresses the `bitmap` returned for `value` and `num_stripes`.
+  static Entry Compress(int value, size_t num_stripes, const Bitmap64& bitmap);
+  static Bitmap64 Decompress(const Entry& entry);
+
+  Shard& GetShard(int value) const;
+
+  const IndexStructurePtr index_;
+  const size_t max_shard_bytes_;
+  const std::unique_ptr<Shard[]> shards_;
+  const size_t num_shards_;
+
+  mutable std::atomic<size_t> num_hits_{0};
+  mutable std::atomic<size_t> num_misses_{0};
+  mutable std::atomic<size_t> num_evictions_{0};
+};
+
+class CachingIndexFactory : public IndexStructureFactory {
+ public:
+  CachingIndexFactory(std::unique_ptr<IndexStructureFactory> index_factory,
+                      size_t max_cache_bytes,
+                      size_t num_shards = CachingIndex::kDefaultNumShards)
+      : index_factory_(std::move(index_factory)),
+        max_cache_bytes_(max_cache_bytes),
+        num_shards_(num_shards) {}
+
+  IndexStructurePtr Create(const Column& column,
+                           size_t num_rows_per_stripe) const override {
+    return IndexStructurePtr(
+        new CachingIndex(index_factory_->Create(column, num_rows_per_stripe),
+                         max_cache_bytes_, num_shards_));
+  }
+
+  std::string index_name() const override {
+    return index_factory_->index_name() + ":cached";
+  }
+
+ private:
+  const std::unique_ptr<IndexStructureFactory> index_factory_;
+  const size_t max_cache_bytes_;
+  const size_t num_shards_;
+};
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_CACHING_INDEX_H_
@@ -0,0 +1,176 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: caching_index_test.cc
+// -----------------------------------------------------------------------------
+
+#include "caching_index.h"
+
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "cuckoo_index.h"
+#include "cuckoo_utils.h"
+#include "data.h"
+#include "gtest/gtest.h"
+
+namespace ci {
+
+constexpr size_t kNumRowsPerStripe = 10;
+// The column contains all values in [kMinValue, kMaxValue].
+constexpr int kMinValue = 1;
+constexpr int kMaxValue = 100;
+
+class CachingIndexTest : public ::testing::Test {
+ protected:
+  CachingIndexTest() {
+    std::vector<int> data;
+    for (int i = 0; i < 1000; ++i)
+      data.push_back(kMinValue + (i * 7) % kMaxValue);
+    column_ = Column::IntColumn("column", std::move(data));
+    num_stripes_ = column_->num_rows() / kNumRowsPerStripe;
+    factory_ = absl::make_unique<CuckooIndexFactory>(
+        CuckooAlgorithm::SKEWED_KICKING, kMaxLoadFactor1SlotsPerBucket,
+        /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+        /*prefix_bits_optimization=*/false);
+  }
+
+  // Creates a CachingIndex and sets `index_` to the wrapped index, so that
+  // cached results are compared against the very same index (building is
+  // randomized, so false positives differ between builds).
+  std::unique_ptr<CachingIndex> CreateCachingIndex(size_t max_cache_bytes,
+                                                   size_t num_shards) {
+    IndexStructurePtr index = factory_->Create(*column_, kNumRowsPerStripe);
+    index_ = index.get();
+    return absl::make_unique<CachingIndex>(std::move(index), max_cache_bytes,
+                                           num_shards);
+  }
+
+  ColumnPtr column_;
+  size_t num_stripes_;
+  std::unique_ptr<IndexStructureFactory> factory_;
+  // Owned by the last CachingIndex created.
+  const IndexStructure* index_ = nullptr;
+};
+
+TEST_F(CachingIndexTest, CachedResultsMatchIndex) {
+  const std::unique_ptr<CachingIndex> cached =
+      CreateCachingIndex(/*max_cache_bytes=*/1 << 20, /*num_shards=*/4);
+  for (int round = 0; round < 2; ++round) {
+    for (int value = kMinValue; value <= kMaxValue; ++value) {
+      EXPECT_EQ(cached->GetQualifyingStripes(value, num_stripes_).ToString(),
+                index_->GetQualifyingStripes(value, num_stripes_).ToString());
+    }
+  }
+  EXPECT_EQ(cached->num_misses(), kMaxValue);
+  EXPECT_EQ(cached->num_hits(), kMaxValue);
+  EXPECT_EQ(cached->num_evictions(), 0);
+  EXPECT_GT(cached->cache_byte_size(), 0);
+
+  cached->Clear();
+  EXPECT_EQ(cached->cache_byte_size(), 0);
+  EXPECT_EQ(cached->num_hits(), 0);
+}
+
+TEST_F(CachingIndexTest, NegativeLookupsMatchIndex) {
+  const std::unique_ptr<CachingIndex> cached =
+      CreateCachingIndex(/*max_cache_bytes=*/1 << 20, /*num_shards=*/4);
+  for (int round = 0; round < 2; ++round) {
+    for (int value = kMaxValue + 1; value <= 2 * kMaxValue; ++value) {
+      EXPECT_EQ(cached->GetQualifyingStripes(value, num_stripes_).ToString(),
+                index_->GetQualifyingStripes(value, num_stripes_).ToString());
+    }
+  }
+  EXPECT_EQ(cached->num_misses(), kMaxValue);
+  EXPECT_EQ(cached->num_hits(), kMaxValue);
+}
+
+TEST_F(CachingIndexTest, LookupsOfFewerStripesMatchIndex) {
+  // CuckooIndex returns bitmaps of all its stripes for positive lookups, but
+  // of `num_stripes` ones for negative lookups.
+  const std::unique_ptr<CachingIndex> cached =
+      CreateCachingIndex(/*max_cache_bytes=*/1 << 20, /*num_shards=*/4);
+  for (const size_t num_stripes : {num_stripes_ / 2, num_stripes_}) {
+    for (int round = 0; round < 2; ++round) {
+      for (int value = kMinValue; value <= 2 * kMaxValue; ++value) {
+        const Bitmap64 expected =
+            index_->GetQualifyingStripes(value, num_stripes);
+        const Bitmap64 actual = cached->GetQualifyingStripes(value, num_stripes);
+        EXPECT_EQ(actual.bits(), expected.bits());
+        EXPECT_EQ(actual.ToString(), expected.ToString());
+      }
+    }
+  }
+  EXPECT_EQ(cached->num_misses(), 2 * 2 * kMaxValue);
+  EXPECT_EQ(cached->num_hits(), 2 * 2 * kMaxValue);
+}
+
+TEST_F(CachingIndexTest, CacheSizeIsBounded) {
+  constexpr size_t kMaxCacheBytes = 2048;
+  const std::unique_ptr<CachingIndex> cached =
+      CreateCachingIndex(kMaxCacheBytes, /*num_shards=*/2);
+  for (int value = kMinValue; value <= kMaxValue; ++value) {
+    EXPECT_EQ(cached->GetQualifyingStripes(value, num_stripes_).ToString(),
+              index_->GetQualifyingStripes(value, num_stripes_).ToString());
+    EXPECT_LE(cached->cache_byte_size(), kMaxCacheBytes);
+  }
+  EXPECT_GT(cached->num_evictions(), 0);
+}
+
+TEST_F(CachingIndexTest, EvictsLeastRecentlyUsed) {
+  const std::unique_ptr<CachingIndex> cached =
+      CreateCachingIndex(/*max_cache_bytes=*/2048, /*num_shards=*/1);
+  // Keep value 1 hot while looking up many other values.
+  for (int value = 2; value <= kMaxValue; ++value) {
+    cached->GetQualifyingStripes(1, num_stripes_);
+    cached->GetQualifyingStripes(value, num_stripes_);
+  }
+  const size_t num_misses = cached->num_misses();
+  cached->GetQualifyingStripes(1, num_stripes_);
+  EXPECT_EQ(cached->num_misses(), num_misses);
+}
+
+TEST_F(CachingIndexTest, ConcurrentLookups) {
+  const std::unique_ptr<CachingIndex> cached =
+      CreateCachingIndex(/*max_cache_bytes=*/4096, /*num_shards=*/4);
+  std::vector<std::string> expected(kMaxValue + 1);
+  for (int value = kMinValue; value <= kMaxValue; ++value) {
+    expected[value] =
+        index_->GetQualifyingStripes(value, num_stripes_).ToString();
+  }
+
+  constexpr int kNumThreads = 8;
+  std::vector<std::thread> threads;
+  std::vector<int> num_mismatches(kNumThreads, 0);
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < 2000; ++i) {
+        const int value = kMinValue + (i * (t + 1)) % kMaxValue;
+        if (cached->GetQualifyingStripes(value, num_stripes_).ToString() !=
+            expected[value]) {
+          ++num_mismatches[t];
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  for (const int n : num_mismatches) EXPECT_EQ(n, 0);
+  EXPECT_EQ(cached->num_hits() + cached->num_misses(), kNumThreads * 2000);
+  EXPECT_LE(cached->cache_byte_size(), 4096);
+}
+
+}  // namespace ci
@@ -1,12 +1,23 @@
 include(benchmark)
 
+# Reports to benchmark counters, hence only built with the benchmarks.
+add_library(common_perf_counters "${PROJECT_SOURCE_DIR}/common/perf_counters.cc" "${PROJECT_SOURCE_DIR}/common/perf_counters.h")
+target_link_libraries(common_perf_counters
+  absl::flags
+  absl::span
+  benchmark
+)
+
 add_executable(build_benchmark "${PROJECT_SOURCE_DIR}/build_benchmark.cc")
 target_link_libraries(build_benchmark 
   cuckoo_index
   cuckoo_utils
   index_structure
+  per_stripe_binary_fuse
   per_stripe_bloom
   per_stripe_xor
+  table_flags
+  common_perf_counters
   common_profiling
   absl::flags
   absl::flags_parse
@@ -16,13 +27,22 @@ target_link_libraries(build_benchmark
 
 add_executable(lookup_benchmark "${PROJECT_SOURCE_DIR}/lookup_benchmark.cc")
 target_link_libraries(lookup_benchmark 
+  caching_index
   cuckoo_index
   cuckoo_utils
   index_structure
+  inverted_stripe_index
+  per_stripe_binary_fuse
   per_stripe_bloom
   per_stripe_xor
+  zone_map
+  zone_map_cuckoo_index
+  table_flags
+  common_perf_counters
   absl::flags
   absl::flags_parse
+  absl::random_random
+  absl::time
   benchmark
   gtest
 )
\ No newline at end of file
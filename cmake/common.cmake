@@ -1,3 +1,12 @@
+add_library(common_allocation_counter "${PROJECT_SOURCE_DIR}/common/allocation_counter.cc" "${PROJECT_SOURCE_DIR}/common/allocation_counter.h")
+
+# Replaces the global operator new and delete, only link into binaries that
+# report allocation counts.
+add_library(common_allocation_counter_hooks OBJECT "${PROJECT_SOURCE_DIR}/common/allocation_counter_hooks.cc")
+target_link_libraries(common_allocation_counter_hooks
+  common_allocation_counter
+)
+
 add_library(common_byte_coding "${PROJECT_SOURCE_DIR}/common/byte_coding.h")
 target_link_libraries(common_byte_coding
   absl::strings
@@ -19,10 +28,13 @@ target_link_libraries(common_bitmap
   Boost::dynamic_bitset
 )
 
+add_library(common_int_hash "${PROJECT_SOURCE_DIR}/common/int_hash.h")
+
 add_library(common_profiling "${PROJECT_SOURCE_DIR}/common/profiling.cc" "${PROJECT_SOURCE_DIR}/common/profiling.h")
 target_link_libraries(common_profiling
-  absl::flat_hash_map
-  absl::time
+  absl::base
+  absl::strings
+  absl::str_format
 )
 
 add_library(common_rle_bitmap "${PROJECT_SOURCE_DIR}/common/rle_bitmap.cc" "${PROJECT_SOURCE_DIR}/common/rle_bitmap.h")
@@ -30,4 +42,14 @@ target_link_libraries(common_rle_bitmap
   common_bit_packing
   common_bitmap
   absl::strings
+  absl::span
+)
+
+add_library(common_string_dictionary "${PROJECT_SOURCE_DIR}/common/string_dictionary.cc" "${PROJECT_SOURCE_DIR}/common/string_dictionary.h")
+target_link_libraries(common_string_dictionary
+  common_bit_packing
+  common_byte_coding
+  absl::memory
+  absl::strings
+  absl::span
 )
@@ -3,7 +3,6 @@ include(absl)
 include(boost)
 include(croaring)
 include(csvparser)
-include(leveldb)
 include(protobuf)
 include(xor_singleheader)
 
@@ -49,22 +48,48 @@ add_library(data "${PROJECT_SOURCE_DIR}/data.cc" "${PROJECT_SOURCE_DIR}/data.h")
 target_link_libraries(data
   evaluation_utils
   common_byte_coding
-  Boost::math
-  Boost::multiprecision
+  common_string_dictionary
+  absl::base
+  absl::flat_hash_map
   absl::flat_hash_set
   absl::memory
   absl::random_random
   absl::strings
+  absl::span
   csv-parser
 )
 
+add_library(table_flags "${PROJECT_SOURCE_DIR}/table_flags.cc" "${PROJECT_SOURCE_DIR}/table_flags.h")
+target_link_libraries(table_flags
+  data
+  absl::flags
+)
+
+add_library(blocked_bloom_filter "${PROJECT_SOURCE_DIR}/blocked_bloom_filter.cc" "${PROJECT_SOURCE_DIR}/blocked_bloom_filter.h")
+target_link_libraries(blocked_bloom_filter
+  common_bitmap
+  common_int_hash
+  absl::strings
+  absl::span
+)
+
+add_library(per_stripe_filter_utils "${PROJECT_SOURCE_DIR}/per_stripe_filter_utils.h")
+target_link_libraries(per_stripe_filter_utils
+  common_int_hash
+  absl::strings
+  absl::span
+)
+
 add_library(per_stripe_bloom "${PROJECT_SOURCE_DIR}/per_stripe_bloom.h")
 target_link_libraries(per_stripe_bloom
+  blocked_bloom_filter
+  common_bitmap
   data
   evaluation_utils
   index_structure
+  per_stripe_filter_utils
   absl::strings
-  leveldb
+  absl::span
 )
 
 add_library(xor_filter "${PROJECT_SOURCE_DIR}/xor_filter.h")
@@ -73,28 +98,73 @@ target_link_libraries(xor_filter
   xor_singleheader
 )
 
+add_library(binary_fuse_filter "${PROJECT_SOURCE_DIR}/binary_fuse_filter.h")
+target_link_libraries(binary_fuse_filter
+  common_bitmap
+  common_int_hash
+  absl::int128
+  absl::strings
+  absl::span
+)
+
+add_library(per_stripe_binary_fuse "${PROJECT_SOURCE_DIR}/per_stripe_binary_fuse.h")
+target_link_libraries(per_stripe_binary_fuse
+  binary_fuse_filter
+  common_bitmap
+  data
+  evaluation_utils
+  index_structure
+  per_stripe_filter_utils
+  absl::memory
+  absl::strings
+  absl::span
+)
+
 add_library(per_stripe_xor "${PROJECT_SOURCE_DIR}/per_stripe_xor.h")
 target_link_libraries(per_stripe_xor
   data
   evaluation_utils
   index_structure
+  per_stripe_filter_utils
   absl::strings
+  absl::span
   xor_singleheader
 )
 
+add_library(fast_cuckoo_table "${PROJECT_SOURCE_DIR}/fast_cuckoo_table.cc" "${PROJECT_SOURCE_DIR}/fast_cuckoo_table.h")
+target_link_libraries(fast_cuckoo_table
+  cuckoo_utils
+  common_bitmap
+  absl::span
+)
+
+add_library(slot_bitmap_store "${PROJECT_SOURCE_DIR}/slot_bitmap_store.cc" "${PROJECT_SOURCE_DIR}/slot_bitmap_store.h")
+target_link_libraries(slot_bitmap_store
+  common_bit_packing
+  common_bitmap
+  common_byte_coding
+  common_rle_bitmap
+  croaring
+  absl::memory
+  absl::span
+)
+
 add_library(cuckoo_index "${PROJECT_SOURCE_DIR}/cuckoo_index.cc" "${PROJECT_SOURCE_DIR}/cuckoo_index.h")
 target_link_libraries(cuckoo_index
   cuckoo_kicker
   cuckoo_utils
   evaluation_utils
+  fast_cuckoo_table
   fingerprint_store
   index_structure
+  slot_bitmap_store
   common_byte_coding
   common_profiling
   common_rle_bitmap
   absl::flat_hash_map
   absl::memory
   absl::strings
+  absl::span
 )
 
 add_library(cuckoo_kicker "${PROJECT_SOURCE_DIR}/cuckoo_kicker.cc" "${PROJECT_SOURCE_DIR}/cuckoo_kicker.h")
@@ -142,15 +212,52 @@ add_library(index_structure "${PROJECT_SOURCE_DIR}/index_structure.h")
 target_link_libraries(index_structure
   data
   evaluation_cc_proto
+  absl::span
+)
+
+add_library(inverted_stripe_index "${PROJECT_SOURCE_DIR}/inverted_stripe_index.cc" "${PROJECT_SOURCE_DIR}/inverted_stripe_index.h")
+target_link_libraries(inverted_stripe_index
+  common_bitmap
+  croaring
+  data
+  evaluation_utils
+  index_structure
+  absl::memory
+  absl::span
 )
 
-add_library(zone_map "${PROJECT_SOURCE_DIR}/zone_map.h")
+add_library(zone_map "${PROJECT_SOURCE_DIR}/zone_map.cc" "${PROJECT_SOURCE_DIR}/zone_map.h")
 target_link_libraries(zone_map
   data
   evaluation_utils
   index_structure
   absl::memory
   absl::strings
+  absl::span
+)
+
+add_library(stripe_predicate "${PROJECT_SOURCE_DIR}/stripe_predicate.cc" "${PROJECT_SOURCE_DIR}/stripe_predicate.h")
+target_link_libraries(stripe_predicate
+  index_structure
+  common_bitmap
+)
+
+add_library(caching_index "${PROJECT_SOURCE_DIR}/caching_index.cc" "${PROJECT_SOURCE_DIR}/caching_index.h")
+target_link_libraries(caching_index
+  index_structure
+  common_bitmap
+  absl::flat_hash_map
+  absl::hash
+  absl::synchronization
+)
+
+add_library(zone_map_cuckoo_index "${PROJECT_SOURCE_DIR}/zone_map_cuckoo_index.h")
+target_link_libraries(zone_map_cuckoo_index
+  data
+  index_structure
+  zone_map
+  absl::memory
+  absl::strings
 )
 
 add_library(evaluator "${PROJECT_SOURCE_DIR}/evaluator.cc" "${PROJECT_SOURCE_DIR}/evaluator.h")
@@ -158,8 +265,14 @@ target_link_libraries(evaluator
   data
   evaluation_cc_proto
   index_structure
+  common_allocation_counter
+  common_profiling
+  absl::base
+  absl::memory
   absl::random_random
+  absl::strings
   absl::str_format
+  absl::span
 )
 
 add_executable(evaluate "${PROJECT_SOURCE_DIR}/evaluate.cc")
@@ -171,9 +284,15 @@ target_link_libraries(evaluate
   evaluation_utils
   evaluator
   index_structure
+  inverted_stripe_index
+  per_stripe_binary_fuse
   per_stripe_bloom
   per_stripe_xor
   zone_map
+  zone_map_cuckoo_index
+  table_flags
+  common_allocation_counter_hooks
+  common_profiling
   absl::flags
   absl::flags_parse
   absl::memory
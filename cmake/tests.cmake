@@ -6,6 +6,13 @@ target_link_libraries(data_test
   gtest_main
 )
 
+add_executable(blocked_bloom_filter_test "${PROJECT_SOURCE_DIR}/blocked_bloom_filter_test.cc")
+target_link_libraries(blocked_bloom_filter_test 
+  blocked_bloom_filter
+  common_bitmap
+  gtest_main
+)
+
 add_executable(per_stripe_bloom_test "${PROJECT_SOURCE_DIR}/per_stripe_bloom_test.cc")
 target_link_libraries(per_stripe_bloom_test 
   per_stripe_bloom
@@ -18,6 +25,19 @@ target_link_libraries(xor_filter_test
   gtest_main
 )
 
+add_executable(binary_fuse_filter_test "${PROJECT_SOURCE_DIR}/binary_fuse_filter_test.cc")
+target_link_libraries(binary_fuse_filter_test 
+  binary_fuse_filter
+  common_bitmap
+  gtest_main
+)
+
+add_executable(per_stripe_binary_fuse_test "${PROJECT_SOURCE_DIR}/per_stripe_binary_fuse_test.cc")
+target_link_libraries(per_stripe_binary_fuse_test 
+  per_stripe_binary_fuse
+  gtest_main
+)
+
 add_executable(per_stripe_xor_test "${PROJECT_SOURCE_DIR}/per_stripe_xor_test.cc")
 target_link_libraries(per_stripe_xor_test 
   per_stripe_xor
@@ -55,12 +75,81 @@ target_link_libraries(fingerprint_store_test
   gtest_main
 )
 
+add_executable(slot_bitmap_store_test "${PROJECT_SOURCE_DIR}/slot_bitmap_store_test.cc")
+target_link_libraries(slot_bitmap_store_test 
+  slot_bitmap_store
+  absl::random_random
+  gtest_main
+)
+
+add_executable(inverted_stripe_index_test "${PROJECT_SOURCE_DIR}/inverted_stripe_index_test.cc")
+target_link_libraries(inverted_stripe_index_test 
+  inverted_stripe_index
+  gtest_main
+)
+
 add_executable(zone_map_test "${PROJECT_SOURCE_DIR}/zone_map_test.cc")
 target_link_libraries(zone_map_test 
   zone_map
   gtest_main
 )
 
+add_executable(stripe_predicate_test "${PROJECT_SOURCE_DIR}/stripe_predicate_test.cc")
+target_link_libraries(stripe_predicate_test 
+  cuckoo_index
+  data
+  stripe_predicate
+  zone_map
+  gtest_main
+)
+
+add_executable(zone_map_cuckoo_index_test "${PROJECT_SOURCE_DIR}/zone_map_cuckoo_index_test.cc")
+target_link_libraries(zone_map_cuckoo_index_test 
+  cuckoo_index
+  cuckoo_utils
+  data
+  zone_map_cuckoo_index
+  gtest_main
+)
+
+add_executable(caching_index_test "${PROJECT_SOURCE_DIR}/caching_index_test.cc")
+target_link_libraries(caching_index_test 
+  caching_index
+  cuckoo_index
+  cuckoo_utils
+  data
+  absl::memory
+  gtest_main
+)
+
+add_executable(evaluator_test "${PROJECT_SOURCE_DIR}/evaluator_test.cc")
+target_link_libraries(evaluator_test 
+  cuckoo_index
+  cuckoo_utils
+  data
+  evaluator
+  per_stripe_xor
+  zone_map
+  common_allocation_counter_hooks
+  absl::memory
+  gtest_main
+)
+
+add_executable(concurrent_lookup_test "${PROJECT_SOURCE_DIR}/concurrent_lookup_test.cc")
+target_link_libraries(concurrent_lookup_test 
+  caching_index
+  cuckoo_index
+  cuckoo_utils
+  data
+  index_structure
+  per_stripe_bloom
+  per_stripe_xor
+  zone_map
+  zone_map_cuckoo_index
+  absl::memory
+  gtest_main
+)
+
 add_executable(bitmap_benchmark_test "${PROJECT_SOURCE_DIR}/bitmap_benchmark_test.cc")
 target_link_libraries(bitmap_benchmark_test 
   evaluation_utils
@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: allocation_counter.cc
+// -----------------------------------------------------------------------------
+
+#include "common/allocation_counter.h"
+
+namespace {
+
+// Constant-initialized, so they can be used by allocations of any thread at
+// any time.
+struct ThreadAllocations {
+  int64_t num_allocations;
+  int64_t allocated_bytes;
+  int64_t peak_allocated_bytes;
+};
+thread_local ThreadAllocations thread_allocations = {0, 0, 0};
+
+bool enabled = false;
+
+}  // namespace
+
+namespace ci {
+
+namespace allocation_counter_internal {
+
+void Enable() { enabled = true; }
+
+void RecordAllocation(int64_t num_bytes) {
+  ThreadAllocations& allocations = thread_allocations;
+  ++allocations.num_allocations;
+  allocations.allocated_bytes += num_bytes;
+  if (allocations.allocated_bytes > allocations.peak_allocated_bytes)
+    allocations.peak_allocated_bytes = allocations.allocated_bytes;
+}
+
+void RecordDeallocation(int64_t num_bytes) {
+  thread_allocations.allocated_bytes -= num_bytes;
+}
+
+}  // namespace allocation_counter_internal
+
+ScopedAllocationCounter::ScopedAllocationCounter()
+    : num_allocations_start_(thread_allocations.num_allocations),
+      allocated_bytes_start_(thread_allocations.allocated_bytes) {
+  thread_allocations.peak_allocated_bytes = thread_allocations.allocated_bytes;
+}
+
+bool ScopedAllocationCounter::IsEnabled() { return enabled; }
+
+int64_t ScopedAllocationCounter::num_allocations() const {
+  return thread_allocations.num_allocations - num_allocations_start_;
+}
+
+int64_t ScopedAllocationCounter::peak_allocated_bytes() const {
+  return thread_allocations.peak_allocated_bytes - allocated_bytes_start_;
+}
+
+}  // namespace ci
@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: allocation_counter.h
+// -----------------------------------------------------------------------------
+//
+// Counts the heap allocations of the current thread. Allocations are only
+// counted in binaries that also link the allocation_counter_hooks library,
+// which replaces the global operator new and delete with ones that keep
+// per-thread counts of the allocations and of the allocated bytes (as reported
+// by malloc_usable_size()).
+
+#ifndef CUCKOO_INDEX_COMMON_ALLOCATION_COUNTER_H_
+#define CUCKOO_INDEX_COMMON_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+namespace ci {
+
+// Instantiate a local variable with this class to count the allocations of
+// the current thread in the local scope. Example:
+//   ScopedAllocationCounter counter;
+//   .... // Allocate memory.
+//   std::cout << counter.num_allocations() << std::endl;
+class ScopedAllocationCounter {
+ public:
+  ScopedAllocationCounter();
+
+  ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+  ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) = delete;
+
+  // Returns true if allocations are counted, i.e., if the binary links the
+  // allocation_counter_hooks library. Otherwise, all counts are 0.
+  static bool IsEnabled();
+
+  // Returns the number of allocations since construction.
+  int64_t num_allocations() const;
+
+  // Returns the peak number of bytes allocated (and not yet freed) since
+  // construction. Memory freed by the current thread that was allocated by
+  // another one (or before construction) lowers the count.
+  int64_t peak_allocated_bytes() const;
+
+ private:
+  const int64_t num_allocations_start_;
+  const int64_t allocated_bytes_start_;
+};
+
+namespace allocation_counter_internal {
+
+// Called by the replaced operator new and delete.
+void Enable();
+void RecordAllocation(int64_t num_bytes);
+void RecordDeallocation(int64_t num_bytes);
+
+}  // namespace allocation_counter_internal
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_COMMON_ALLOCATION_COUNTER_H_
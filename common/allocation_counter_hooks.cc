@@ -0,0 +1,91 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: allocation_counter_hooks.cc
+// -----------------------------------------------------------------------------
+
+// Replaces the global operator new and delete with ones that count the
+// allocations for ScopedAllocationCounter.
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+
+#include "common/allocation_counter.h"
+
+namespace {
+
+using ci::allocation_counter_internal::RecordAllocation;
+using ci::allocation_counter_internal::RecordDeallocation;
+
+// Enables ScopedAllocationCounter at static initialization.
+const bool enabled = (ci::allocation_counter_internal::Enable(), true);
+
+void* Allocate(size_t size) {
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr != nullptr) RecordAllocation(malloc_usable_size(ptr));
+  return ptr;
+}
+
+void* AllocateAligned(size_t size, std::align_val_t alignment) {
+  const size_t align = static_cast<size_t>(alignment);
+  // aligned_alloc(..) requires the size to be a multiple of the alignment.
+  void* ptr = aligned_alloc(align, (size + align - 1) / align * align);
+  if (ptr != nullptr) RecordAllocation(malloc_usable_size(ptr));
+  return ptr;
+}
+
+void Free(void* ptr) {
+  if (ptr == nullptr) return;
+  RecordDeallocation(malloc_usable_size(ptr));
+  std::free(ptr);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  void* ptr = Allocate(size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+  void* ptr = AllocateAligned(size, alignment);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept { Free(ptr); }
+void operator delete[](void* ptr) noexcept { Free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { Free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { Free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { Free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { Free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  Free(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  Free(ptr);
+}
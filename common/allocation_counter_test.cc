@@ -0,0 +1,68 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: allocation_counter_test.cc
+// -----------------------------------------------------------------------------
+
+#include "common/allocation_counter.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ci {
+namespace {
+
+// Keeps the compiler from eliding allocations.
+void* volatile sink;
+
+TEST(ScopedAllocationCounterTest, CountsAllocations) {
+  ASSERT_TRUE(ScopedAllocationCounter::IsEnabled());
+  ScopedAllocationCounter counter;
+  EXPECT_EQ(counter.num_allocations(), 0);
+  EXPECT_EQ(counter.peak_allocated_bytes(), 0);
+
+  {
+    std::vector<char> large(1 << 20);
+    auto small = std::make_unique<int>(42);
+    sink = large.data();
+    sink = small.get();
+  }
+  EXPECT_EQ(counter.num_allocations(), 2);
+  EXPECT_GE(counter.peak_allocated_bytes(), (1 << 20) + 4);
+
+  // The peak is relative to the allocated bytes at construction.
+  std::vector<char> allocated(1 << 20);
+  ScopedAllocationCounter other_counter;
+  EXPECT_EQ(other_counter.peak_allocated_bytes(), 0);
+}
+
+TEST(ScopedAllocationCounterTest, CountsPerThread) {
+  ScopedAllocationCounter counter;
+  std::thread thread([]() {
+    for (int i = 0; i < 10; ++i) {
+      auto value = std::make_unique<int>(i);
+      sink = value.get();
+    }
+  });
+  thread.join();
+  // Only the allocation(s) for starting the thread are counted.
+  EXPECT_LT(counter.num_allocations(), 10);
+}
+
+}  // namespace
+}  // namespace ci
@@ -118,6 +118,20 @@ class Bitmap64 {
     return decoded;
   }
 
+  // Returns a bitmap with `num_bits` bits, read from the 64-bit `words` (the
+  // least-significant bit of a word comes first). Bits beyond `num_bits` in
+  // the last word must be zero.
+  static Bitmap64 FromWords(const uint64_t* words, size_t num_bits) {
+    using Block = boost::dynamic_bitset<>::block_type;
+    static_assert(sizeof(Block) == sizeof(uint64_t),
+                  "Expected 64-bit blocks in boost::dynamic_bitset.");
+    Bitmap64 bitmap(num_bits);
+    const Block* begin = reinterpret_cast<const Block*>(words);
+    boost::from_block_range(begin, begin + bitmap.bitset_.num_blocks(),
+                            bitmap.bitset_);
+    return bitmap;
+  }
+
   Bitmap64() = default;
 
   explicit Bitmap64(size_t num_bits) : bitset_(num_bits) {}
@@ -181,6 +195,30 @@ class Bitmap64 {
 
   void Set(size_t pos, bool value) { bitset_[pos] = value; }
 
+  // Bitwise operations with a bitmap of the same size. Invalidate the rank
+  // lookup table (call InitRankLookupTable() again if needed).
+  Bitmap64& operator&=(const Bitmap64& other) {
+    assert(bits() == other.bits());
+    bitset_ &= other.bitset_;
+    rank_lookup_table_.clear();
+    return *this;
+  }
+
+  Bitmap64& operator|=(const Bitmap64& other) {
+    assert(bits() == other.bits());
+    bitset_ |= other.bitset_;
+    rank_lookup_table_.clear();
+    return *this;
+  }
+
+  // Clears all bits that are set in `other`.
+  Bitmap64& AndNot(const Bitmap64& other) {
+    assert(bits() == other.bits());
+    bitset_ -= other.bitset_;
+    rank_lookup_table_.clear();
+    return *this;
+  }
+
   std::vector<size_t> TrueBitIndices() const {
     std::vector<size_t> indices;
 
@@ -0,0 +1,41 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: int_hash.h
+// -----------------------------------------------------------------------------
+
+#ifndef CUCKOO_INDEX_COMMON_INT_HASH_H_
+#define CUCKOO_INDEX_COMMON_INT_HASH_H_
+
+#include <cstdint>
+
+namespace ci {
+
+// Returns a 64-bit hash of `key` (Murmur3's 64-bit finalizer). Filters that
+// hash a key once and probe many filters with the same hash (e.g., one filter
+// per stripe) use it as their key hash.
+inline uint64_t HashInt(int key) {
+  uint64_t h = static_cast<uint32_t>(key) ^ 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_COMMON_INT_HASH_H_
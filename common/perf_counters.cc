@@ -0,0 +1,180 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: perf_counters.cc
+// -----------------------------------------------------------------------------
+
+#include "common/perf_counters.h"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "absl/flags/flag.h"
+
+ABSL_FLAG(bool, perf_counters, false,
+          "If set, reports hardware performance counters (cycles, "
+          "instructions, cache/TLB/branch misses) per benchmark iteration as "
+          "benchmark counters. Unavailable counters are skipped.");
+
+namespace ci {
+namespace {
+
+#ifdef __linux__
+// Encodes a generalized cache event (see perf_event_open(2)).
+constexpr uint64_t CacheEvent(uint64_t cache, uint64_t op, uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+int PerfEventOpen(const PerfEvent& event, int group_fd) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  // Only the leader is disabled, the other counters follow it.
+  attr.disabled = group_fd == -1 ? 1 : 0;
+  // Required for unprivileged users with the default perf_event_paranoid.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, /*pid=*/0,
+                                  /*cpu=*/-1, group_fd, /*flags=*/0));
+}
+#endif
+
+// Warns about unavailable events only once per process.
+void WarnUnavailable(const std::string& name) {
+  static std::atomic<bool> warned{false};
+  if (warned.exchange(true)) return;
+  std::cerr << "[WARNING] Performance counter " << name
+            << " (and possibly others) not available." << std::endl;
+}
+
+}  // namespace
+
+std::vector<PerfEvent> DefaultPerfEvents() {
+#ifdef __linux__
+  return {
+      {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+      {"l1d_load_misses", PERF_TYPE_HW_CACHE,
+       CacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                  PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {"dtlb_load_misses", PERF_TYPE_HW_CACHE,
+       CacheEvent(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                  PERF_COUNT_HW_CACHE_RESULT_MISS)},
+  };
+#else
+  return {};
+#endif
+}
+
+PerfCounters::PerfCounters(absl::Span<const PerfEvent> events) {
+  for (const PerfEvent& event : events) {
+#ifdef __linux__
+    const int fd = PerfEventOpen(event, leader_fd_);
+#else
+    const int fd = -1;
+#endif
+    if (fd == -1) {
+      WarnUnavailable(event.name);
+      continue;
+    }
+    if (leader_fd_ == -1) leader_fd_ = fd;
+    counters_.push_back({event.name, fd, 0});
+  }
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (const Counter& counter : counters_) close(counter.fd);
+#endif
+}
+
+void PerfCounters::Start() {
+#ifdef __linux__
+  if (leader_fd_ == -1) return;
+  ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+void PerfCounters::Stop() {
+#ifdef __linux__
+  if (leader_fd_ == -1) return;
+  ioctl(leader_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  // Layout: nr, time_enabled, time_running, values[nr].
+  std::vector<uint64_t> buffer(3 + counters_.size());
+  const ssize_t size =
+      read(leader_fd_, buffer.data(), buffer.size() * sizeof(uint64_t));
+  if (size != static_cast<ssize_t>(buffer.size() * sizeof(uint64_t)) ||
+      buffer[0] != counters_.size()) {
+    // Leave the totals unchanged, but don't report them.
+    WarnUnavailable(counters_[0].name);
+    read_failed_ = true;
+    return;
+  }
+  const uint64_t time_enabled = buffer[1];
+  const uint64_t time_running = buffer[2];
+  time_running_ns_ += time_running;
+  const double scale = time_running == 0 ? 0.0
+                                         : static_cast<double>(time_enabled) /
+                                               time_running;
+  for (size_t i = 0; i < counters_.size(); ++i)
+    counters_[i].total += static_cast<int64_t>(buffer[3 + i] * scale);
+#endif
+}
+
+std::vector<std::pair<std::string, int64_t>> PerfCounters::Read() const {
+  std::vector<std::pair<std::string, int64_t>> values;
+  values.reserve(counters_.size());
+  for (const Counter& counter : counters_)
+    values.emplace_back(counter.name, counter.total);
+  return values;
+}
+
+ScopedPerfCounters::ScopedPerfCounters(benchmark::State& state)
+    : state_(state),
+      counters_(absl::GetFlag(FLAGS_perf_counters) ? DefaultPerfEvents()
+                                                   : std::vector<PerfEvent>()) {
+  counters_.Start();
+}
+
+ScopedPerfCounters::~ScopedPerfCounters() {
+  counters_.Stop();
+  if (!counters_.available()) return;
+  if (!counters_.counted()) {
+    state_.SetLabel("perf counters not available");
+    return;
+  }
+  for (const auto& [name, value] : counters_.Read()) {
+    state_.counters[name] =
+        benchmark::Counter(value, benchmark::Counter::kAvgIterations);
+  }
+}
+
+}  // namespace ci
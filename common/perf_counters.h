@@ -0,0 +1,133 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: perf_counters.h
+// -----------------------------------------------------------------------------
+//
+// Hardware performance counters (cycles, instructions, cache misses, ..) of the
+// current thread, collected with Linux' perf_event_open(2). The counters are
+// opened as a single group, so that they're scheduled (and multiplexed)
+// together and their values are comparable.
+//
+// Counters that aren't available (e.g., on other platforms, in VMs or due to
+// /proc/sys/kernel/perf_event_paranoid) are skipped, so callers don't need to
+// special-case machines without performance counters.
+//
+// Benchmarks can use ScopedPerfCounters to report the counters selected by
+// --perf_counters.
+
+#ifndef CUCKOO_INDEX_COMMON_PERF_COUNTERS_H_
+#define CUCKOO_INDEX_COMMON_PERF_COUNTERS_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+
+ABSL_DECLARE_FLAG(bool, perf_counters);
+
+namespace ci {
+
+// A hardware event as passed to perf_event_open(2).
+struct PerfEvent {
+  std::string name;
+  uint32_t type;
+  uint64_t config;
+};
+
+// Returns the events relevant for cache-bound index structures: cycles,
+// instructions, branch misses, last-level cache misses, L1 data cache load
+// misses and data TLB load misses.
+std::vector<PerfEvent> DefaultPerfEvents();
+
+// Example:
+//   PerfCounters counters(DefaultPerfEvents());
+//   counters.Start();
+//   .... // Do expensive stuff.
+//   counters.Stop();
+//   for (const auto& [name, value] : counters.Read()) ..
+class PerfCounters {
+ public:
+  // Opens counters for the given `events` on the current thread. Must only be
+  // used on that thread.
+  explicit PerfCounters(absl::Span<const PerfEvent> events);
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Returns true if at least one of the events could be opened.
+  bool available() const { return !counters_.empty(); }
+
+  // Starts counting.
+  void Start();
+
+  // Stops counting and adds the counted values to the totals.
+  void Stop();
+
+  // Returns the names and total values of the available counters. Values are
+  // scaled up if the kernel had to multiplex the counters.
+  std::vector<std::pair<std::string, int64_t>> Read() const;
+
+  // Returns true if the counters were actually running (i.e., scheduled on the
+  // PMU) at some point between Start() and Stop() and could always be read.
+  // Otherwise, e.g., if other processes occupied the PMU, Read() returns
+  // meaningless (or incomplete) values.
+  bool counted() const { return !read_failed_ && time_running_ns_ > 0; }
+
+ private:
+  struct Counter {
+    std::string name;
+    int fd;
+    int64_t total;
+  };
+
+  // File descriptor of the group leader (the first available counter).
+  int leader_fd_ = -1;
+  std::vector<Counter> counters_;
+  uint64_t time_running_ns_ = 0;
+  // Set if reading the counters failed in any call of Stop().
+  bool read_failed_ = false;
+};
+
+// Counts the events selected by --perf_counters (none unless set) of the
+// current thread from construction to destruction and reports them per
+// iteration as counters of the benchmark `state`. If the counters never ran
+// (or couldn't be read), labels the benchmark with "perf counters not
+// available" instead. Example:
+//   void BM_Lookup(benchmark::State& state) {
+//     ScopedPerfCounters perf_counters(state);
+//     for (auto _ : state) ..
+//   }
+class ScopedPerfCounters {
+ public:
+  explicit ScopedPerfCounters(benchmark::State& state);
+  ~ScopedPerfCounters();
+
+  ScopedPerfCounters(const ScopedPerfCounters&) = delete;
+  ScopedPerfCounters& operator=(const ScopedPerfCounters&) = delete;
+
+ private:
+  benchmark::State& state_;
+  PerfCounters counters_;
+};
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_COMMON_PERF_COUNTERS_H_
@@ -0,0 +1,57 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: perf_counters_test.cc
+// -----------------------------------------------------------------------------
+
+#include "common/perf_counters.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+namespace ci {
+namespace {
+
+TEST(PerfCountersTest, NoEvents) {
+  PerfCounters counters({});
+  EXPECT_FALSE(counters.available());
+  counters.Start();
+  counters.Stop();
+  EXPECT_FALSE(counters.counted());
+  EXPECT_TRUE(counters.Read().empty());
+}
+
+TEST(PerfCountersTest, CountsInstructions) {
+  PerfCounters counters(DefaultPerfEvents());
+  // Performance counters aren't available everywhere (e.g., in containers).
+  if (!counters.available()) GTEST_SKIP() << "No performance counters.";
+
+  volatile int64_t sum = 0;
+  counters.Start();
+  for (int i = 0; i < 1000000; ++i) sum += i;
+  counters.Stop();
+
+  if (!counters.counted()) GTEST_SKIP() << "Counters were never scheduled.";
+  for (const auto& [name, value] : counters.Read()) {
+    EXPECT_GE(value, 0) << name;
+    if (name == "instructions") {
+      EXPECT_GE(value, 1000000);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace ci
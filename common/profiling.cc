@@ -1,10 +1,279 @@
 #include "common/profiling.h"
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "absl/base/call_once.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
 namespace ci {
+namespace {
+
+// Profilers of all live threads and the stats of exited ones.
+struct Registry {
+  std::mutex mutex;
+  std::vector<const Profiler*> profilers;
+  ProfileStats exited_stats;
+  // Trace events of exited threads, formatted as JSON objects.
+  std::string exited_trace_events;
+  uint32_t next_thread_id = 0;
+};
+
+Registry& GetRegistry() {
+  static auto* registry = new Registry();
+  return *registry;
+}
+
+// Returns the tick count at which the first profiler was created, which is the
+// origin of trace timestamps.
+uint64_t OriginTicks() {
+  static const uint64_t origin_ticks = Profiler::ReadTicks();
+  return origin_ticks;
+}
+
+// Returns the number of ticks per nanosecond. Is calibrated against the steady
+// clock when first called.
+double TicksPerNanosecond() {
+#if defined(__x86_64__) || defined(__i386__)
+  static absl::once_flag once;
+  static double ticks_per_ns;
+  absl::call_once(once, [] {
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t start_ticks = __rdtsc();
+    std::chrono::nanoseconds elapsed;
+    do {
+      elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(10));
+    ticks_per_ns =
+        static_cast<double>(__rdtsc() - start_ticks) / elapsed.count();
+  });
+  return ticks_per_ns;
+#else
+  return 1.0;
+#endif
+}
+
+int64_t TicksToNanoseconds(uint64_t ticks) {
+  return static_cast<int64_t>(ticks / TicksPerNanosecond());
+}
+
+void Add(const CounterStats& b, CounterStats* a) {
+  a->num_calls += b.num_calls;
+  a->total_ns += b.total_ns;
+  a->self_ns += b.self_ns;
+}
+
+void Subtract(const CounterStats& b, CounterStats* a) {
+  a->num_calls -= b.num_calls;
+  a->total_ns -= b.total_ns;
+  a->self_ns -= b.self_ns;
+}
+
+// Appends the nested scopes of `parent` to `out`. `path` contains the counters
+// of the enclosing scopes and is used to stop at recursive scopes.
+void AppendCallTree(const ProfileStats& stats, size_t parent,
+                    std::vector<size_t>* path, std::string* out) {
+  for (size_t child = 0; child < kNumCounters; ++child) {
+    const CounterStats& edge = stats.Edge(parent, static_cast<Counter>(child));
+    if (edge.num_calls == 0) continue;
+    const std::string name =
+        absl::StrCat(std::string(2 * path->size(), ' '),
+                     CounterName(static_cast<Counter>(child)));
+    absl::StrAppendFormat(out, "%-40s %12d %14.3f %14.3f\n", name,
+                          edge.num_calls, edge.total_ns / 1e6,
+                          edge.self_ns / 1e6);
+    if (std::find(path->begin(), path->end(), child) != path->end()) continue;
+    path->push_back(child);
+    AppendCallTree(stats, child, path, out);
+    path->pop_back();
+  }
+}
+
+}  // namespace
+
+const char* CounterName(Counter counter) {
+  switch (counter) {
+    case Counter::CreateCuckooIndex:
+      return "CreateCuckooIndex";
+    case Counter::ValueToStripeBitmaps:
+      return "ValueToStripeBitmaps";
+    case Counter::DistributeValues:
+      return "DistributeValues";
+    case Counter::CreateSlots:
+      return "CreateSlots";
+    case Counter::CreateFingerprintStore:
+      return "CreateFingerprintStore";
+    case Counter::GetGlobalBitmap:
+      return "GetGlobalBitmap";
+    case Counter::EncodeIndex:
+      return "EncodeIndex";
+    case Counter::Lookup:
+      return "Lookup";
+    case Counter::LookupIn:
+      return "LookupIn";
+    case Counter::LookupAmong:
+      return "LookupAmong";
+    case Counter::StripeContains:
+      return "StripeContains";
+    case Counter::kNumCounters:
+      break;
+  }
+  return "Unknown";
+}
+
+ProfileStats& ProfileStats::operator+=(const ProfileStats& other) {
+  for (size_t i = 0; i < kNumCounters; ++i)
+    Add(other.counters_[i], &counters_[i]);
+  for (size_t i = 0; i <= kNumCounters; ++i) {
+    for (size_t j = 0; j < kNumCounters; ++j)
+      Add(other.edges_[i][j], &edges_[i][j]);
+  }
+  return *this;
+}
+
+ProfileStats& ProfileStats::operator-=(const ProfileStats& other) {
+  for (size_t i = 0; i < kNumCounters; ++i)
+    Subtract(other.counters_[i], &counters_[i]);
+  for (size_t i = 0; i <= kNumCounters; ++i) {
+    for (size_t j = 0; j < kNumCounters; ++j)
+      Subtract(other.edges_[i][j], &edges_[i][j]);
+  }
+  return *this;
+}
+
+std::string ProfileStats::ToTextSummary() const {
+  // The call tree is built from (parent, child) pairs, i.e., the nested scopes
+  // of a scope are aggregated across all of its parents.
+  std::string out = absl::StrFormat("%-40s %12s %14s %14s\n", "Scope", "Calls",
+                                    "Total (ms)", "Self (ms)");
+  std::vector<size_t> path;
+  AppendCallTree(*this, kNumCounters, &path, &out);
+  return out;
+}
+
+std::atomic<bool> Profiler::lookup_profiling_enabled_{false};
+std::atomic<bool> Profiler::tracing_enabled_{false};
 
 Profiler& Profiler::GetThreadInstance() {
   thread_local static Profiler static_profiler;
   return static_profiler;
 }
 
+Profiler::Profiler() {
+  OriginTicks();
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  thread_id_ = registry.next_thread_id++;
+  registry.profilers.push_back(this);
+}
+
+Profiler::~Profiler() {
+  ProfileStats stats;
+  AddStatsTo(&stats);
+  std::string trace_events;
+  {
+    std::lock_guard<std::mutex> lock(trace_events_mutex_);
+    for (const TraceEvent& event : trace_events_) {
+      absl::StrAppend(&trace_events, trace_events.empty() ? "" : ",\n",
+                      FormatTraceEvent(event));
+    }
+  }
+
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.exited_stats += stats;
+  if (!trace_events.empty()) {
+    absl::StrAppend(&registry.exited_trace_events,
+                    registry.exited_trace_events.empty() ? "" : ",\n",
+                    trace_events);
+  }
+  registry.profilers.erase(std::find(registry.profilers.begin(),
+                                     registry.profilers.end(), this));
+}
+
+ProfileStats Profiler::GetStats() const {
+  ProfileStats stats;
+  AddStatsTo(&stats);
+  return stats;
+}
+
+void Profiler::Reset() {
+  const auto reset = [](Slot* slot) {
+    slot->num_calls.store(0, std::memory_order_relaxed);
+    slot->total_ticks.store(0, std::memory_order_relaxed);
+    slot->self_ticks.store(0, std::memory_order_relaxed);
+  };
+  for (Slot& slot : counters_) reset(&slot);
+  for (auto& slots : edges_) {
+    for (Slot& slot : slots) reset(&slot);
+  }
+  std::lock_guard<std::mutex> lock(trace_events_mutex_);
+  trace_events_.clear();
+}
+
+ProfileStats Profiler::GetAggregatedStats() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  ProfileStats stats = registry.exited_stats;
+  for (const Profiler* profiler : registry.profilers)
+    profiler->AddStatsTo(&stats);
+  return stats;
+}
+
+std::string Profiler::ToChromeTraceJson() {
+  std::string events;
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    events = registry.exited_trace_events;
+    for (const Profiler* profiler : registry.profilers) {
+      std::lock_guard<std::mutex> events_lock(profiler->trace_events_mutex_);
+      for (const TraceEvent& event : profiler->trace_events_) {
+        absl::StrAppend(&events, events.empty() ? "" : ",\n",
+                        profiler->FormatTraceEvent(event));
+      }
+    }
+  }
+  return absl::StrCat("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", events,
+                      "\n]}\n");
+}
+
+void Profiler::AddTraceEvent(const TraceEvent& event) {
+  std::lock_guard<std::mutex> lock(trace_events_mutex_);
+  if (trace_events_.size() < kMaxNumTraceEventsPerThread)
+    trace_events_.push_back(event);
+}
+
+std::string Profiler::FormatTraceEvent(const TraceEvent& event) const {
+  // Chrome traces use microseconds.
+  const double start_us =
+      TicksToNanoseconds(event.start_ticks - OriginTicks()) / 1e3;
+  const double duration_us =
+      TicksToNanoseconds(event.end_ticks - event.start_ticks) / 1e3;
+  return absl::StrFormat(
+      "{\"name\":\"%s\",\"cat\":\"ci\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+      "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%d}}",
+      CounterName(event.counter), thread_id_, start_us, duration_us,
+      event.depth);
+}
+
+void Profiler::AddStatsTo(ProfileStats* stats) const {
+  const auto add = [](const Slot& slot, CounterStats* counter_stats) {
+    counter_stats->num_calls += slot.num_calls.load(std::memory_order_relaxed);
+    counter_stats->total_ns +=
+        TicksToNanoseconds(slot.total_ticks.load(std::memory_order_relaxed));
+    counter_stats->self_ns +=
+        TicksToNanoseconds(slot.self_ticks.load(std::memory_order_relaxed));
+  };
+  for (size_t i = 0; i < kNumCounters; ++i)
+    add(counters_[i], &(*stats)[static_cast<Counter>(i)]);
+  for (size_t i = 0; i <= kNumCounters; ++i) {
+    for (size_t j = 0; j < kNumCounters; ++j)
+      add(edges_[i][j], &stats->Edge(i, static_cast<Counter>(j)));
+  }
+}
+
 }  // namespace ci
@@ -1,22 +1,114 @@
+#ifndef CUCKOO_INDEX_COMMON_PROFILING_H_
+#define CUCKOO_INDEX_COMMON_PROFILING_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
 
-#include "absl/container/flat_hash_map.h"
-#include "absl/time/time.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
 
 namespace ci {
 
+// Profiled scopes. Counters are stored in fixed slots, so add new ones before
+// `kNumCounters` and give them a name in CounterName().
 enum class Counter {
+  // Build of a CuckooIndex (see CuckooIndexFactory::Create(..)), enclosing all
+  // of the following build phases.
+  CreateCuckooIndex,
   ValueToStripeBitmaps,
   DistributeValues,
   CreateSlots,
   CreateFingerprintStore,
-  GetGlobalBitmap
+  GetGlobalBitmap,
+  EncodeIndex,
+  // Lookups in a CuckooIndex. Only recorded if lookup profiling is enabled (see
+  // Profiler::SetLookupProfilingEnabled(..)).
+  Lookup,
+  LookupIn,
+  LookupAmong,
+  StripeContains,
+  kNumCounters
+};
+
+constexpr size_t kNumCounters = static_cast<size_t>(Counter::kNumCounters);
+
+// Returns the name of `counter`.
+const char* CounterName(Counter counter);
+
+// Returns true for counters on lookup paths, which are too hot for being
+// profiled unconditionally.
+constexpr bool IsLookupCounter(Counter counter) {
+  return counter >= Counter::Lookup;
+}
+
+// Profiling results of a single counter.
+struct CounterStats {
+  int64_t num_calls = 0;
+  // Time spent in the scope, including nested scopes.
+  int64_t total_ns = 0;
+  // Time spent in the scope, excluding nested scopes.
+  int64_t self_ns = 0;
 };
 
-// A simple profiler that can collect stats. Use `ScopedProfile` for registering
+// Profiling results of all counters, including the number of calls and the
+// time spent per (parent scope, nested scope) pair.
+class ProfileStats {
+ public:
+  const CounterStats& operator[](Counter counter) const {
+    return counters_[static_cast<size_t>(counter)];
+  }
+  CounterStats& operator[](Counter counter) {
+    return counters_[static_cast<size_t>(counter)];
+  }
+
+  // Stats of `child` scopes nested (directly) in `parent` scopes. A `parent`
+  // of `kNumCounters` stands for scopes that aren't nested.
+  const CounterStats& Edge(size_t parent, Counter child) const {
+    return edges_[parent][static_cast<size_t>(child)];
+  }
+  CounterStats& Edge(size_t parent, Counter child) {
+    return edges_[parent][static_cast<size_t>(child)];
+  }
+
+  ProfileStats& operator+=(const ProfileStats& other);
+  ProfileStats& operator-=(const ProfileStats& other);
+  friend ProfileStats operator-(ProfileStats a, const ProfileStats& b) {
+    return a -= b;
+  }
+
+  // Returns a human-readable call tree with the time spent per scope.
+  std::string ToTextSummary() const;
+
+ private:
+  std::array<CounterStats, kNumCounters> counters_{};
+  std::array<std::array<CounterStats, kNumCounters>, kNumCounters + 1>
+      edges_{};
+};
+
+// A low-overhead, hierarchical profiler. Use `ScopedProfile` for registering
 // counters to profile.
 //
-// Is thread-safe, because there can be only a single instance per thread.
+// There's a single instance per thread, which is the only writer of its
+// counters, so ScopedProfiles can be used concurrently from any number of
+// threads without synchronization. Reading the stats of other threads (e.g.,
+// with GetAggregatedStats()) is safe as well, but may not include their
+// currently open scopes. Time is measured in CPU timestamp counter ticks
+// (where available) and only converted to nanoseconds when reading the
+// counters. Scopes may be nested: a scope's self time excludes the time spent
+// in nested scopes. Note that recursive scopes of the same counter are counted
+// repeatedly in the total time.
+//
+// Profilers of all threads (including threads that already exited) can be
+// aggregated with GetAggregatedStats(). If tracing is enabled, every scope is
+// also recorded as an event that can be exported as a Chrome trace.
 class Profiler {
  public:
   // Retrieves a `Profiler` instance for the current thread.
@@ -24,53 +116,175 @@ class Profiler {
 
   Profiler(const Profiler&) = delete;
   Profiler& operator=(const Profiler&) = delete;
-  virtual ~Profiler() {}
+  virtual ~Profiler();
 
+  // Returns the total time in nanoseconds spent in scopes of `counter`.
   int64_t GetValue(Counter counter) const {
-    const auto value_it = counters_.find(counter);
-    return value_it != counters_.end() ? value_it->second : 0;
+    return GetStats()[counter].total_ns;
+  }
+
+  // Returns the stats of this thread.
+  ProfileStats GetStats() const;
+
+  // Clears the stats of this thread. Must not be called from within a profiled
+  // scope.
+  void Reset();
+
+  // Returns the sum of the stats of all threads.
+  static ProfileStats GetAggregatedStats();
+
+  // Enables or disables profiling of lookup counters (disabled by default).
+  static void SetLookupProfilingEnabled(bool enabled) {
+    lookup_profiling_enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  static bool lookup_profiling_enabled() {
+    return lookup_profiling_enabled_.load(std::memory_order_relaxed);
   }
 
-  void Reset() { counters_.clear(); }
+  // Enables or disables recording of trace events (disabled by default). At
+  // most `kMaxNumTraceEventsPerThread` events are recorded per thread.
+  static void SetTracingEnabled(bool enabled) {
+    tracing_enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Returns the recorded trace events of all threads in the Chrome trace event
+  // format (load with chrome://tracing or https://ui.perfetto.dev).
+  static std::string ToChromeTraceJson();
+
+  static constexpr size_t kMaxNumTraceEventsPerThread = 1 << 20;
+
+  // Returns the current value of the CPU timestamp counter (or of the steady
+  // clock in nanoseconds on other architectures).
+  static uint64_t ReadTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
 
  private:
   friend class ScopedProfile;
 
-  Profiler() {}
+  // A single execution of a profiled scope.
+  struct TraceEvent {
+    Counter counter;
+    uint32_t depth;
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+  };
+
+  // Maximum depth of nested scopes. Deeper scopes are ignored.
+  static constexpr size_t kMaxDepth = 32;
+
+  // A single counter slot. Is only written by the owning thread, but may be
+  // read concurrently, hence the (relaxed) atomics.
+  struct Slot {
+    std::atomic<int64_t> num_calls{0};
+    std::atomic<int64_t> total_ticks{0};
+    std::atomic<int64_t> self_ticks{0};
+  };
+
+  // An open scope.
+  struct Frame {
+    Counter counter;
+    uint64_t start_ticks;
+    // Ticks spent in nested scopes.
+    uint64_t child_ticks;
+  };
+
+  Profiler();
 
   // Starts profiling for the given counter.
   void Start(Counter counter) {
-    counters_[counter] -= absl::GetCurrentTimeNanos();
+    if (depth_ < kMaxDepth) stack_[depth_] = {counter, ReadTicks(), 0};
+    ++depth_;
   }
 
-  // Stops profiling for the given counter.
-  void Stop(Counter counter) {
-    counters_[counter] += absl::GetCurrentTimeNanos();
+  // Stops profiling for the innermost scope.
+  void Stop() {
+    --depth_;
+    if (depth_ >= kMaxDepth) return;
+    const uint64_t end_ticks = ReadTicks();
+    const Frame& frame = stack_[depth_];
+    const uint64_t ticks = end_ticks - frame.start_ticks;
+    const size_t parent = depth_ == 0
+                              ? kNumCounters
+                              : static_cast<size_t>(stack_[depth_ - 1].counter);
+    const size_t child = static_cast<size_t>(frame.counter);
+    Add(&counters_[child], ticks, frame.child_ticks);
+    Add(&edges_[parent][child], ticks, frame.child_ticks);
+    if (depth_ > 0) stack_[depth_ - 1].child_ticks += ticks;
+    if (tracing_enabled_.load(std::memory_order_relaxed))
+      AddTraceEvent({frame.counter, static_cast<uint32_t>(depth_),
+                     frame.start_ticks, end_ticks});
   }
 
-  absl::flat_hash_map<Counter, int64_t> counters_;
+  static void Add(Slot* slot, uint64_t ticks, uint64_t child_ticks) {
+    slot->num_calls.store(slot->num_calls.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+    slot->total_ticks.store(
+        slot->total_ticks.load(std::memory_order_relaxed) + ticks,
+        std::memory_order_relaxed);
+    slot->self_ticks.store(
+        slot->self_ticks.load(std::memory_order_relaxed) + ticks - child_ticks,
+        std::memory_order_relaxed);
+  }
+
+  void AddTraceEvent(const TraceEvent& event);
+
+  // Returns `event` as a JSON object in the Chrome trace event format.
+  std::string FormatTraceEvent(const TraceEvent& event) const;
+
+  // Adds the stats of this thread to `stats`.
+  void AddStatsTo(ProfileStats* stats) const;
+
+  static std::atomic<bool> lookup_profiling_enabled_;
+  static std::atomic<bool> tracing_enabled_;
+
+  // Sequential id of the thread (used in traces).
+  uint32_t thread_id_;
+
+  std::array<Slot, kNumCounters> counters_;
+  std::array<std::array<Slot, kNumCounters>, kNumCounters + 1> edges_;
+
+  std::array<Frame, kMaxDepth> stack_;
+  size_t depth_ = 0;
+
+  // Guards `trace_events_`, which are read when exporting the trace.
+  mutable std::mutex trace_events_mutex_;
+  std::vector<TraceEvent> trace_events_;
 };
 
 // Instantiate a local variable with this class to profile the local scope.
 // Example:
 //   void MyClass::MyMethod() {
-//     ScopedProfile t(Counters::MyClass_MyMethod);
+//     ScopedProfile t(Counter::MyClass_MyMethod);
 //     .... // Do expensive stuff.
 //   }
 class ScopedProfile {
  public:
   // ScopedProfile is neither copyable nor moveable.
-  ScopedProfile(const Profiler&) = delete;
-  ScopedProfile& operator=(const Profiler&) = delete;
+  ScopedProfile(const ScopedProfile&) = delete;
+  ScopedProfile& operator=(const ScopedProfile&) = delete;
 
-  explicit ScopedProfile(Counter counter) : counter_(counter) {
-    Profiler::GetThreadInstance().Start(counter);
+  explicit ScopedProfile(Counter counter) {
+    if (IsLookupCounter(counter) && !Profiler::lookup_profiling_enabled())
+      return;
+    profiler_ = &Profiler::GetThreadInstance();
+    profiler_->Start(counter);
   }
 
-  ~ScopedProfile() { Profiler::GetThreadInstance().Stop(counter_); }
+  ~ScopedProfile() {
+    if (profiler_ != nullptr) profiler_->Stop();
+  }
 
  private:
-  Counter counter_;
+  Profiler* profiler_ = nullptr;
 };
 
 }  // namespace ci
+
+#endif  // CUCKOO_INDEX_COMMON_PROFILING_H_
@@ -0,0 +1,111 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: profiling_test.cc
+// -----------------------------------------------------------------------------
+
+#include "common/profiling.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace ci {
+namespace {
+
+void BusyWait(std::chrono::microseconds duration) {
+  const auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < duration) {
+  }
+}
+
+TEST(ProfilerTest, CountsNestedScopes) {
+  Profiler& profiler = Profiler::GetThreadInstance();
+  profiler.Reset();
+  {
+    ScopedProfile outer(Counter::CreateCuckooIndex);
+    for (int i = 0; i < 3; ++i) {
+      ScopedProfile inner(Counter::CreateSlots);
+      BusyWait(std::chrono::microseconds(1000));
+    }
+  }
+
+  const ProfileStats stats = profiler.GetStats();
+  const CounterStats& outer = stats[Counter::CreateCuckooIndex];
+  const CounterStats& inner = stats[Counter::CreateSlots];
+  EXPECT_EQ(outer.num_calls, 1);
+  EXPECT_EQ(inner.num_calls, 3);
+  EXPECT_GE(inner.total_ns, 2500000);
+  EXPECT_EQ(inner.self_ns, inner.total_ns);
+  EXPECT_GE(outer.total_ns, inner.total_ns);
+  EXPECT_LT(outer.self_ns, inner.total_ns);
+  EXPECT_EQ(profiler.GetValue(Counter::CreateSlots), inner.total_ns);
+
+  EXPECT_EQ(stats.Edge(kNumCounters, Counter::CreateCuckooIndex).num_calls, 1);
+  EXPECT_EQ(stats.Edge(static_cast<size_t>(Counter::CreateCuckooIndex),
+                       Counter::CreateSlots)
+                .num_calls,
+            3);
+  EXPECT_EQ(stats.Edge(kNumCounters, Counter::CreateSlots).num_calls, 0);
+
+  const std::string summary = stats.ToTextSummary();
+  EXPECT_NE(summary.find("CreateCuckooIndex"), std::string::npos);
+  EXPECT_NE(summary.find("  CreateSlots"), std::string::npos);
+
+  profiler.Reset();
+  EXPECT_EQ(profiler.GetStats()[Counter::CreateSlots].num_calls, 0);
+}
+
+TEST(ProfilerTest, SkipsLookupCountersUnlessEnabled) {
+  Profiler& profiler = Profiler::GetThreadInstance();
+  profiler.Reset();
+  { ScopedProfile profile(Counter::Lookup); }
+  EXPECT_EQ(profiler.GetStats()[Counter::Lookup].num_calls, 0);
+
+  Profiler::SetLookupProfilingEnabled(true);
+  { ScopedProfile profile(Counter::Lookup); }
+  Profiler::SetLookupProfilingEnabled(false);
+  EXPECT_EQ(profiler.GetStats()[Counter::Lookup].num_calls, 1);
+}
+
+TEST(ProfilerTest, AggregatesAcrossThreads) {
+  const ProfileStats start = Profiler::GetAggregatedStats();
+  Profiler::SetTracingEnabled(true);
+  std::thread thread([]() {
+    for (int i = 0; i < 5; ++i) ScopedProfile profile(Counter::EncodeIndex);
+  });
+  thread.join();
+  { ScopedProfile profile(Counter::EncodeIndex); }
+  Profiler::SetTracingEnabled(false);
+
+  // Includes the stats of the exited thread.
+  const ProfileStats stats = Profiler::GetAggregatedStats() - start;
+  EXPECT_EQ(stats[Counter::EncodeIndex].num_calls, 6);
+
+  const std::string trace = Profiler::ToChromeTraceJson();
+  EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0),
+            0);
+  size_t num_events = 0;
+  for (size_t pos = trace.find("\"EncodeIndex\""); pos != std::string::npos;
+       pos = trace.find("\"EncodeIndex\"", pos + 1)) {
+    ++num_events;
+  }
+  EXPECT_EQ(num_events, 6);
+}
+
+}  // namespace
+}  // namespace ci
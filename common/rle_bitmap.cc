@@ -311,4 +311,121 @@ Bitmap64 RleBitmap::ExtractSparse(size_t offset, size_t size) const {
   return result;
 }
 
+void RleBitmap::ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                          Bitmap64* result) const {
+  assert(result->bits() == size);
+  if (is_sparse_) {
+    ExtractOrSparse(offsets, size, result);
+  } else {
+    ExtractOrDense(offsets, size, result);
+  }
+}
+
+void RleBitmap::ExtractOrDense(absl::Span<const size_t> offsets, size_t size,
+                               Bitmap64* result) const {
+  // The scan state: `pos` is the position of the next bit to decode.
+  size_t pos = 0;
+  size_t rle_pos = 0;
+  size_t bits_pos = 0;
+  size_t count_rep = 0;
+  size_t count_raw = 0;
+  // The next entry in the skip-list and the positions its block starts at.
+  size_t skip_pos = 0;
+  size_t skip_begin = 0;
+  size_t skip_bits_begin = 0;
+
+  assert(skip_offsets_size_ % 2 == 0);
+  for (size_t k = 0; k < offsets.size(); ++k) {
+    const size_t offset = offsets[k];
+    assert(k == 0 || offsets[k - 1] + size <= offset);
+    assert(offset + size <= size_);
+
+    // Use the skip-list to jump forward (only ever moves forward).
+    while (skip_pos < skip_offsets_size_ &&
+           skip_begin + skip_offsets_.Get(skip_pos) <= offset) {
+      skip_begin += skip_offsets_.Get(skip_pos);
+      skip_bits_begin += skip_offsets_.Get(skip_pos + 1);
+      skip_pos += 2;
+    }
+    if (skip_begin > pos) {
+      pos = skip_begin;
+      rle_pos = skip_pos / 2 * skip_offsets_step_;
+      bits_pos = skip_bits_begin;
+      count_rep = 0;
+      count_raw = 0;
+    }
+
+    // Scan from the current state on.
+    for (; pos < offset + size; ++pos) {
+      if (count_rep == 0 && count_raw == 0) {
+        const uint32_t rle_entry = run_lengths_.Get(rle_pos++);
+        if (rle_entry & 1) {
+          count_raw = (rle_entry >> 1) + 1;
+        } else {
+          count_rep = (rle_entry >> 1) + kMinDenseRunLength;
+        }
+      }
+      bool bit;
+      if (count_rep > 0) {
+        count_rep--;
+        bit = bits_.Get(bits_pos);
+        if (count_rep == 0) bits_pos++;
+      } else {
+        assert(count_raw > 0);
+        count_raw--;
+        bit = bits_.Get(bits_pos++);
+      }
+      if (pos >= offset && bit) result->Set(pos - offset, true);
+    }
+  }
+}
+
+void RleBitmap::ExtractOrSparse(absl::Span<const size_t> offsets, size_t size,
+                                Bitmap64* result) const {
+  // The scan state: `i` is the last decoded position, which is a 1-bit if
+  // `i_is_set` holds.
+  int64_t i = -1;
+  bool i_is_set = false;
+  size_t rle_pos = 0;
+  // The next entry in the skip-list and the position its block starts at.
+  size_t skip_pos = 0;
+  size_t skip_begin = 0;
+
+  for (size_t k = 0; k < offsets.size(); ++k) {
+    const size_t offset = offsets[k];
+    assert(k == 0 || offsets[k - 1] + size <= offset);
+    assert(offset + size <= size_);
+    const int64_t begin = static_cast<int64_t>(offset);
+    const int64_t end = static_cast<int64_t>(offset + size);
+
+    // Use the skip-list to jump forward (only ever moves forward).
+    while (skip_pos < skip_offsets_size_ &&
+           skip_begin + skip_offsets_.Get(skip_pos) <= offset) {
+      skip_begin += skip_offsets_.Get(skip_pos);
+      ++skip_pos;
+    }
+    if (static_cast<int64_t>(skip_begin) - 1 > i) {
+      i = static_cast<int64_t>(skip_begin) - 1;
+      i_is_set = false;
+      rle_pos = skip_pos * skip_offsets_step_;
+    }
+
+    // The 1-bit decoded last (past the previous slice) may fall into this one.
+    if (i_is_set && i >= begin && i < end) result->Set(i - begin, true);
+
+    // Scan from the current state on.
+    while (i < end && rle_pos < run_lengths_size_) {
+      const uint32_t count = run_lengths_.Get(rle_pos++);
+      if (count == 0) {
+        i += kMaxSparseRunLength;
+        i_is_set = false;
+      } else {
+        i += count;
+        i_is_set = true;
+        if (i >= begin && i < end) result->Set(i - begin, true);
+      }
+    }
+  }
+}
+
 }  // namespace ci
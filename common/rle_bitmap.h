@@ -24,6 +24,7 @@
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "common/bit_packing.h"
 #include "common/bitmap.h"
 
@@ -49,11 +50,24 @@ class RleBitmap {
 
   bool Get(size_t pos) const { return Extract(pos, 1).Get(0); }
 
+  // ORs the slices of the bitmap from each of the `offsets` on of the given
+  // `size` into `result` (which has to have `size` bits). `offsets` have to be
+  // sorted and the slices must not overlap, so that the run-lengths are decoded
+  // in a single forward scan.
+  void ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                 Bitmap64* result) const;
+
  private:
   // Extract(..) implementations for the dense and the sparse encoding.
   Bitmap64 ExtractDense(size_t offset, size_t size) const;
   Bitmap64 ExtractSparse(size_t offset, size_t size) const;
 
+  // ExtractOr(..) implementations for the dense and the sparse encoding.
+  void ExtractOrDense(absl::Span<const size_t> offsets, size_t size,
+                      Bitmap64* result) const;
+  void ExtractOrSparse(absl::Span<const size_t> offsets, size_t size,
+                       Bitmap64* result) const;
+
   bool is_sparse_;
   size_t size_;
   uint32_t skip_offsets_step_;
@@ -18,6 +18,8 @@
 
 #include "common/rle_bitmap.h"
 
+#include <vector>
+
 #include "common/bitmap.h"
 #include "gtest/gtest.h"
 
@@ -34,6 +36,25 @@ void CheckBitmap(const Bitmap64& bitmap) {
         ASSERT_EQ(extracted.Get(i), bitmap.Get(i + offset));
     }
   }
+
+  // For a host of slice sizes and strides, check that ExtractOr(..) fetches
+  // the union of the individual slices.
+  for (size_t size = 1; size <= bitmap.bits(); size = size * 3 + 1) {
+    for (size_t stride = size; stride <= bitmap.bits(); stride = stride * 2) {
+      std::vector<size_t> offsets;
+      Bitmap64 expected(size);
+      for (size_t offset = 0; offset + size <= bitmap.bits();
+           offset += stride) {
+        offsets.push_back(offset);
+        for (size_t i = 0; i < size; ++i) {
+          if (bitmap.Get(offset + i)) expected.Set(i, true);
+        }
+      }
+      Bitmap64 result(size);
+      rle_bitmap.ExtractOr(offsets, size, &result);
+      ASSERT_EQ(result.ToString(), expected.ToString());
+    }
+  }
 }
 
 TEST(RleBitmapTest, EmptyBitmap) { CheckBitmap(Bitmap64()); }
@@ -0,0 +1,168 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: string_dictionary.cc
+// -----------------------------------------------------------------------------
+
+#include "common/string_dictionary.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "common/bit_packing.h"
+#include "common/byte_coding.h"
+
+namespace ci {
+namespace {
+
+// Returns the length of the common prefix of `a` and `b`.
+size_t SharedPrefixLength(absl::string_view a, absl::string_view b) {
+  const size_t max_length = std::min(a.size(), b.size());
+  size_t length = 0;
+  while (length < max_length && a[length] == b[length]) ++length;
+  return length;
+}
+
+}  // namespace
+
+StringDictionary::StringDictionary(absl::Span<const std::string> strings,
+                                   size_t block_size) {
+  assert(block_size > 0);
+  std::vector<absl::string_view> sorted(strings.begin(), strings.end());
+  // Only sort if `strings` aren't sorted and distinct already.
+  if (std::adjacent_find(sorted.begin(), sorted.end(),
+                         [](absl::string_view a, absl::string_view b) {
+                           return a >= b;
+                         }) != sorted.end()) {
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  }
+  const size_t num_blocks = (sorted.size() + block_size - 1) / block_size;
+
+  // Front-code the blocks.
+  ByteBuffer blocks;
+  std::vector<uint32_t> block_offsets;
+  block_offsets.reserve(num_blocks);
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    if (i % block_size == 0) {
+      block_offsets.push_back(blocks.pos());
+      PutString(sorted[i], &blocks);
+    } else {
+      const size_t shared = SharedPrefixLength(sorted[i - 1], sorted[i]);
+      PutVarint32(shared, &blocks);
+      PutString(sorted[i].substr(shared), &blocks);
+    }
+  }
+  if (blocks.pos() > std::numeric_limits<uint32_t>::max()) {
+    std::cerr << "String dictionary exceeds 4 GiB." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  ByteBuffer result;
+  PutPrimitive<uint32_t>(sorted.size(), &result);
+  PutPrimitive<uint32_t>(block_size, &result);
+  PutPrimitive<uint32_t>(num_blocks, &result);
+  for (const uint32_t offset : block_offsets)
+    PutPrimitive<uint32_t>(offset, &result);
+  PutBytes(blocks.data(), blocks.pos(), &result);
+  // Varints are read with a fixed window which may exceed the last block.
+  PutSlopBytes(&result);
+  owned_data_ = std::string(result.data(), result.pos());
+  data_ = owned_data_;
+  Init();
+}
+
+StringDictionary::StringDictionary(absl::string_view data) : data_(data) {
+  Init();
+}
+
+StringDictionaryPtr StringDictionary::FromEncoded(absl::string_view data) {
+  // Need to use WrapUnique<>(..) since we're calling a private c'tor.
+  return absl::WrapUnique(new StringDictionary(data));
+}
+
+void StringDictionary::Init() {
+  size_t pos = 0;
+  num_strings_ = GetPrimitive<uint32_t>(data_, &pos);
+  block_size_ = GetPrimitive<uint32_t>(data_, &pos);
+  num_blocks_ = GetPrimitive<uint32_t>(data_, &pos);
+  block_offsets_pos_ = pos;
+  blocks_pos_ = block_offsets_pos_ + num_blocks_ * sizeof(uint32_t);
+}
+
+size_t StringDictionary::BlockPos(size_t block) const {
+  assert(block < num_blocks_);
+  size_t pos = block_offsets_pos_ + block * sizeof(uint32_t);
+  return blocks_pos_ + GetPrimitive<uint32_t>(data_, &pos);
+}
+
+absl::string_view StringDictionary::FirstString(size_t block) const {
+  size_t pos = BlockPos(block);
+  return ci::GetString(data_, &pos);
+}
+
+std::string StringDictionary::GetString(size_t id) const {
+  assert(id < num_strings_);
+  size_t pos = BlockPos(id / block_size_);
+  std::string result(ci::GetString(data_, &pos));
+  for (size_t i = 0; i < id % block_size_; ++i) {
+    const size_t shared = GetVarint32(data_, &pos);
+    result.resize(shared);
+    absl::StrAppend(&result, ci::GetString(data_, &pos));
+  }
+  return result;
+}
+
+bool StringDictionary::GetId(absl::string_view str, size_t* id) const {
+  if (num_blocks_ == 0) return false;
+  // Find the last block whose first string is <= `str`.
+  size_t begin = 0;
+  size_t end = num_blocks_;
+  while (end - begin > 1) {
+    const size_t mid = begin + (end - begin) / 2;
+    if (FirstString(mid) <= str) {
+      begin = mid;
+    } else {
+      end = mid;
+    }
+  }
+
+  // Scan the block.
+  size_t pos = BlockPos(begin);
+  std::string current(ci::GetString(data_, &pos));
+  const size_t first_id = begin * block_size_;
+  const size_t block_end = std::min(first_id + block_size_, num_strings_);
+  for (size_t i = first_id; i < block_end; ++i) {
+    if (i > first_id) {
+      const size_t shared = GetVarint32(data_, &pos);
+      current.resize(shared);
+      absl::StrAppend(&current, ci::GetString(data_, &pos));
+    }
+    if (current == str) {
+      *id = i;
+      return true;
+    }
+    // The strings are sorted, so `str` can't be in the rest of the block.
+    if (current > str) return false;
+  }
+  return false;
+}
+
+}  // namespace ci
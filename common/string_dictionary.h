@@ -0,0 +1,106 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: string_dictionary.h
+// -----------------------------------------------------------------------------
+//
+// Order-preserving dictionary of distinct strings, mapping each string to its
+// rank (id) in the sorted order. The strings are front-coded in blocks of
+// `block_size` strings: the first string of a block is stored in full, all
+// others as the length of the prefix shared with their predecessor followed by
+// the remaining suffix. Fixed-width block offsets allow for jumping to any
+// block, so decoding an id only decodes (part of) a single block and encoding a
+// string binary searches the blocks' first strings.
+//
+// Lookups operate directly on the encoded form, so a dictionary can also be
+// used on top of externally owned (e.g., mmap-ed) memory.
+
+#ifndef CUCKOO_INDEX_COMMON_STRING_DICTIONARY_H_
+#define CUCKOO_INDEX_COMMON_STRING_DICTIONARY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace ci {
+
+class StringDictionary;
+using StringDictionaryPtr = std::unique_ptr<StringDictionary>;
+
+class StringDictionary {
+ public:
+  static constexpr size_t kDefaultBlockSize = 16;
+
+  // Creates a dictionary of the distinct `strings` (which don't need to be
+  // sorted and may contain duplicates). Sorted and distinct `strings` are
+  // used as is, without sorting them again.
+  explicit StringDictionary(absl::Span<const std::string> strings,
+                            size_t block_size = kDefaultBlockSize);
+
+  // Returns a dictionary operating on the encoded dictionary `data` (see
+  // Encode()), which has to outlive the dictionary.
+  static StringDictionaryPtr FromEncoded(absl::string_view data);
+
+  // Forbid copying and moving.
+  StringDictionary(const StringDictionary&) = delete;
+  StringDictionary& operator=(const StringDictionary&) = delete;
+  StringDictionary(StringDictionary&&) = delete;
+  StringDictionary& operator=(StringDictionary&&) = delete;
+
+  // Returns the number of strings in the dictionary.
+  size_t size() const { return num_strings_; }
+
+  // Returns the string with the given `id` (which has to be < size()).
+  std::string GetString(size_t id) const;
+
+  // Returns true and sets `id` if `str` is in the dictionary.
+  bool GetId(absl::string_view str, size_t* id) const;
+
+  // Returns the encoded dictionary.
+  absl::string_view Encode() const { return data_; }
+
+  size_t byte_size() const { return data_.size(); }
+
+ private:
+  explicit StringDictionary(absl::string_view data);
+
+  // Reads the header of `data_`.
+  void Init();
+
+  // Returns the position of the given block in `data_`.
+  size_t BlockPos(size_t block) const;
+
+  // Returns the (uncompressed) first string of the given block.
+  absl::string_view FirstString(size_t block) const;
+
+  // Only set if the dictionary owns its data.
+  std::string owned_data_;
+  absl::string_view data_;
+
+  size_t num_strings_;
+  size_t block_size_;
+  size_t num_blocks_;
+  // Positions of the block offsets and of the first block in `data_`.
+  size_t block_offsets_pos_;
+  size_t blocks_pos_;
+};
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_COMMON_STRING_DICTIONARY_H_
@@ -0,0 +1,99 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: string_dictionary_test.cc
+// -----------------------------------------------------------------------------
+
+#include "common/string_dictionary.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace ci {
+
+// Checks that all `strings` are encoded to their rank and decoded back.
+void CheckDictionary(const StringDictionary& dictionary,
+                     std::vector<std::string> strings) {
+  std::sort(strings.begin(), strings.end());
+  strings.erase(std::unique(strings.begin(), strings.end()), strings.end());
+  ASSERT_EQ(dictionary.size(), strings.size());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    EXPECT_EQ(dictionary.GetString(i), strings[i]);
+    size_t id;
+    ASSERT_TRUE(dictionary.GetId(strings[i], &id));
+    EXPECT_EQ(id, i);
+  }
+}
+
+TEST(StringDictionaryTest, EncodesAndDecodes) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < 1000; ++i)
+    strings.push_back(absl::StrCat("prefix-", i * 7 % 1000));
+  // Duplicates, the empty string and strings sharing their whole prefix.
+  strings.push_back("prefix-1");
+  strings.push_back("");
+  strings.push_back("prefix-");
+  for (const size_t block_size : {1, 2, 16, 2000}) {
+    CheckDictionary(StringDictionary(strings, block_size), strings);
+  }
+}
+
+TEST(StringDictionaryTest, SortedInputMatchesUnsortedInput) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < 100; ++i)
+    strings.push_back(absl::StrCat("value-", i * 7 % 100));
+  strings.push_back("value-1");
+  const StringDictionary unsorted(strings);
+  std::sort(strings.begin(), strings.end());
+  strings.erase(std::unique(strings.begin(), strings.end()), strings.end());
+  EXPECT_EQ(StringDictionary(strings).Encode(), unsorted.Encode());
+}
+
+TEST(StringDictionaryTest, AbsentStrings) {
+  const StringDictionary dictionary({"b", "d", "f"}, /*block_size=*/2);
+  size_t id;
+  for (const std::string str : {"", "a", "c", "e", "g", "bb"}) {
+    EXPECT_FALSE(dictionary.GetId(str, &id)) << str;
+  }
+  EXPECT_FALSE(
+      StringDictionary(std::vector<std::string>()).GetId("a", &id));
+}
+
+TEST(StringDictionaryTest, FromEncoded) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < 100; ++i) strings.push_back(absl::StrCat("value-", i));
+  const StringDictionary dictionary(strings);
+  // E.g., read from a file or mmap-ed.
+  const std::string encoded(dictionary.Encode());
+  const StringDictionaryPtr decoded = StringDictionary::FromEncoded(encoded);
+  EXPECT_EQ(decoded->byte_size(), dictionary.byte_size());
+  CheckDictionary(*decoded, strings);
+}
+
+TEST(StringDictionaryTest, FrontCodingSavesSpace) {
+  std::vector<std::string> strings;
+  size_t total_size = 0;
+  for (int i = 0; i < 10000; ++i) {
+    strings.push_back(absl::StrCat("https://www.example.com/some/path/", i));
+    total_size += strings.back().size();
+  }
+  EXPECT_LT(StringDictionary(strings).byte_size(), total_size / 3);
+}
+
+}  // namespace ci
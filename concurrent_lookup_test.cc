@@ -0,0 +1,168 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: concurrent_lookup_test.cc
+// -----------------------------------------------------------------------------
+//
+// Checks that lookups on shared index structures from many threads return the
+// same results as single-threaded lookups. Run with --config=tsan (or
+// -fsanitize=thread) to also detect data races.
+
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "caching_index.h"
+#include "cuckoo_index.h"
+#include "cuckoo_utils.h"
+#include "data.h"
+#include "gtest/gtest.h"
+#include "index_structure.h"
+#include "per_stripe_bloom.h"
+#include "per_stripe_xor.h"
+#include "zone_map.h"
+#include "zone_map_cuckoo_index.h"
+
+namespace ci {
+
+constexpr size_t kNumRows = 20000;
+constexpr size_t kNumRowsPerStripe = 500;
+constexpr size_t kNumThreads = 8;
+// Lookup values: [kMinValue, kMaxValue) (i.e., both positive and negative
+// lookups).
+constexpr int kMinValue = 1;
+constexpr int kMaxValue = 600;
+
+// The results of all lookup methods for a single value.
+struct LookupResults {
+  std::string stripe_contains;
+  std::string qualifying_stripes;
+  std::string qualifying_stripes_among;
+  std::string qualifying_stripes_in;
+
+  bool operator==(const LookupResults& other) const {
+    return stripe_contains == other.stripe_contains &&
+           qualifying_stripes == other.qualifying_stripes &&
+           qualifying_stripes_among == other.qualifying_stripes_among &&
+           qualifying_stripes_in == other.qualifying_stripes_in;
+  }
+};
+
+LookupResults Lookup(const IndexStructure& index, int value,
+                     size_t num_stripes) {
+  LookupResults results;
+  for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+    results.stripe_contains +=
+        index.StripeContains(stripe_id, value) ? '1' : '0';
+  }
+  results.qualifying_stripes =
+      index.GetQualifyingStripes(value, num_stripes).ToString();
+  Bitmap64 candidates(/*size=*/num_stripes);
+  for (size_t stripe_id = 0; stripe_id < num_stripes; stripe_id += 2)
+    candidates.Set(stripe_id, true);
+  results.qualifying_stripes_among =
+      index.GetQualifyingStripesAmong(value, candidates).ToString();
+  const std::vector<int> in_list = {value, value + 1, value + 7};
+  results.qualifying_stripes_in =
+      index.GetQualifyingStripesIn(in_list, num_stripes).ToString();
+  return results;
+}
+
+ColumnPtr CreateColumn() {
+  std::vector<int> data;
+  data.reserve(kNumRows);
+  // Sorted runs of values interleaved with random ones.
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> value_d(1, 500);
+  for (size_t i = 0; i < kNumRows; ++i)
+    data.push_back(i % 2 == 0 ? 1 + i / 100 : value_d(gen));
+  return Column::IntColumn("column", std::move(data));
+}
+
+class ConcurrentLookupTest
+    : public ::testing::TestWithParam<
+          std::shared_ptr<const IndexStructureFactory>> {};
+
+TEST_P(ConcurrentLookupTest, MatchesSingleThreadedLookups) {
+  const ColumnPtr column = CreateColumn();
+  const size_t num_stripes = column->num_rows() / kNumRowsPerStripe;
+  const IndexStructurePtr index =
+      GetParam()->Create(*column, kNumRowsPerStripe);
+
+  std::vector<LookupResults> expected;
+  for (int value = kMinValue; value < kMaxValue; ++value)
+    expected.push_back(Lookup(*index, value, num_stripes));
+
+  std::vector<size_t> num_mismatches(kNumThreads, 0);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      // Each thread starts at a different value.
+      const int num_values = kMaxValue - kMinValue;
+      for (int i = 0; i < num_values; ++i) {
+        const int offset = (i + t * num_values / kNumThreads) % num_values;
+        if (!(Lookup(*index, kMinValue + offset, num_stripes) ==
+              expected[offset])) {
+          ++num_mismatches[t];
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  for (size_t t = 0; t < kNumThreads; ++t)
+    EXPECT_EQ(num_mismatches[t], 0) << "thread " << t;
+}
+
+std::shared_ptr<const IndexStructureFactory> CuckooFactory(
+    CuckooIndexLayout layout,
+    SlotBitmapBackend backend = SlotBitmapBackend::RLE) {
+  return std::make_shared<CuckooIndexFactory>(
+      CuckooAlgorithm::SKEWED_KICKING, kMaxLoadFactor1SlotsPerBucket,
+      /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+      /*prefix_bits_optimization=*/false, layout, backend);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllIndexStructures, ConcurrentLookupTest,
+    ::testing::Values(
+        CuckooFactory(CuckooIndexLayout::COMPRESSED),
+        CuckooFactory(CuckooIndexLayout::COMPRESSED,
+                      SlotBitmapBackend::ROARING),
+        CuckooFactory(CuckooIndexLayout::COMPRESSED, SlotBitmapBackend::DENSE),
+        CuckooFactory(CuckooIndexLayout::COMPRESSED,
+                      SlotBitmapBackend::SORTED_LIST),
+        CuckooFactory(CuckooIndexLayout::FAST),
+        std::make_shared<PerStripeBloomFactory>(/*num_bits_per_key=*/10),
+        std::make_shared<PerStripeXorFactory>(),
+        std::make_shared<ZoneMapFactory>(),
+        std::make_shared<ZoneMapCuckooIndexFactory>(
+            absl::make_unique<CuckooIndexFactory>(
+                CuckooAlgorithm::SKEWED_KICKING,
+                kMaxLoadFactor1SlotsPerBucket, /*scan_rate=*/0.01,
+                /*slots_per_bucket=*/1,
+                /*prefix_bits_optimization=*/false)),
+        std::make_shared<CachingIndexFactory>(
+            absl::make_unique<CuckooIndexFactory>(
+                CuckooAlgorithm::SKEWED_KICKING,
+                kMaxLoadFactor1SlotsPerBucket, /*scan_rate=*/0.01,
+                /*slots_per_bucket=*/1,
+                /*prefix_bits_optimization=*/false),
+            /*max_cache_bytes=*/8192)));
+
+}  // namespace ci
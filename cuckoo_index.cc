@@ -18,6 +18,7 @@
 
 #include "cuckoo_index.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <iostream>
@@ -31,7 +32,9 @@
 #include "cuckoo_kicker.h"
 #include "cuckoo_utils.h"
 #include "evaluation_utils.h"
+#include "fast_cuckoo_table.h"
 #include "fingerprint_store.h"
+#include "slot_bitmap_store.h"
 
 namespace ci {
 namespace {
@@ -40,24 +43,6 @@ namespace {
 // increase the number of requested buckets by this factor.
 constexpr double kNumBucketsGrowFactor = 1.01;
 
-// Returns a map from values to their stripe-bitmaps.
-const absl::flat_hash_map<int, Bitmap64Ptr> ValueToStripeBitmaps(
-    const Column& column, size_t num_rows_per_stripe) {
-  ScopedProfile profile(Counter::ValueToStripeBitmaps);
-  absl::flat_hash_map<int, Bitmap64Ptr> bitmaps;
-  // Round down the number of rows to the next multiple of
-  // `num_rows_per_stripe`, i.e., ignore the last stripe as elsewhere.
-  const size_t num_stripes = column.num_rows() / num_rows_per_stripe;
-  const size_t num_rows = num_stripes * num_rows_per_stripe;
-  for (size_t row = 0; row < num_rows; ++row) {
-    const int value = column[row];
-    if (!bitmaps.contains(value))
-      bitmaps[value] = absl::make_unique<Bitmap64>(/*size=*/num_stripes);
-    bitmaps[value]->Set(row / num_rows_per_stripe, true);
-  }
-  return bitmaps;
-}
-
 // Distributes the `values` to buckets with the "kicking algorithm". Returns an
 // empty vector if this failed, i.e., if there were too few buckets.
 std::vector<Bucket> DistributeByKicking(size_t num_buckets,
@@ -86,15 +71,11 @@ std::vector<Bucket> DistributeByKicking(size_t num_buckets,
   return buckets;
 }
 
-// Distributes the `distinct_values` to buckets. Returns an empty vector if this
+// Distributes the distinct `values` to buckets. Returns an empty vector if this
 // failed, i.e., if there were too few buckets.
-std::vector<Bucket> Distribute(
-    size_t num_buckets, size_t slots_per_bucket, CuckooAlgorithm cuckoo_alg,
-    const absl::flat_hash_set<int>& distinct_values) {
-  std::vector<CuckooValue> values;
-  values.reserve(distinct_values.size());
-  for (size_t value : distinct_values)
-    values.push_back(CuckooValue(value, num_buckets));
+std::vector<Bucket> Distribute(size_t num_buckets, size_t slots_per_bucket,
+                               CuckooAlgorithm cuckoo_alg,
+                               const std::vector<CuckooValue>& values) {
   switch (cuckoo_alg) {
     case CuckooAlgorithm::KICKING:
       return DistributeByKicking(num_buckets, slots_per_bucket, values,
@@ -202,12 +183,52 @@ void CreateSlots(double scan_rate, size_t slots_per_bucket,
   }
 }
 
+// Returns the name of `key_type` (e.g., "INT").
+std::string KeyTypeName(CuckooKeyType key_type) {
+  switch (key_type) {
+    case CuckooKeyType::INT:
+      return "INT";
+    case CuckooKeyType::INT64:
+      return "INT64";
+    case CuckooKeyType::UINT64:
+      return "UINT64";
+    case CuckooKeyType::DOUBLE:
+      return "DOUBLE";
+    case CuckooKeyType::BINARY:
+      return "BINARY";
+    case CuckooKeyType::STRING:
+      return "STRING";
+  }
+  std::cerr << "Unknown key type: " << static_cast<int>(key_type) << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+// Returns the suffix of the index name for `key_type` (none for INT keys).
+std::string KeyTypeSuffix(CuckooKeyType key_type) {
+  switch (key_type) {
+    case CuckooKeyType::INT:
+      return "";
+    case CuckooKeyType::INT64:
+      return ":int64_keys";
+    case CuckooKeyType::UINT64:
+      return ":uint64_keys";
+    case CuckooKeyType::DOUBLE:
+      return ":double_keys";
+    case CuckooKeyType::BINARY:
+      return ":binary_keys";
+    case CuckooKeyType::STRING:
+      return ":string_keys";
+  }
+  std::cerr << "Unknown key type: " << static_cast<int>(key_type) << std::endl;
+  exit(EXIT_FAILURE);
+}
+
 // Returns the fingerprints and bitmaps encoded in a compact manner.
 std::string Encode(const FingerprintStore& fingerprint_store,
                    const size_t slots_per_bucket,
                    const bool prefix_bits_optimization,
                    const Bitmap64Ptr& prefix_bits_bitmap,
-                   const RleBitmap& global_slot_bitmap) {
+                   const SlotBitmapStore& global_slot_bitmap) {
   ByteBuffer result;
   PutString(fingerprint_store.Encode(), &result);
   const size_t fp_size = result.pos();
@@ -225,9 +246,10 @@ std::string Encode(const FingerprintStore& fingerprint_store,
               << std::endl;
   }
 
-  // Add the global bitmap, encoded as RleBitmap.
+  // Add the global bitmap, encoded with its backend (preceded by the backend).
   const size_t before_global_bitmap = result.pos();
-  PutString(global_slot_bitmap.data(), &result);
+  PutPrimitive(static_cast<uint8_t>(global_slot_bitmap.backend()), &result);
+  PutString(global_slot_bitmap.Encode(), &result);
   std::cout << "Encoded bitmaps: " << result.pos() - before_global_bitmap
             << std::endl;
   return std::string(result.data(), result.pos());
@@ -236,36 +258,151 @@ std::string Encode(const FingerprintStore& fingerprint_store,
 }  // namespace
 
 bool CuckooIndex::StripeContains(size_t stripe_id, int value) const {
-  const CuckooValue val(value, num_buckets_);
-  size_t slot;
-  if (!BucketContains(val.primary_bucket, val.fingerprint, &slot)) {
-    if (!BucketContains(val.secondary_bucket, val.fingerprint, &slot))
-      return false;
+  CheckKeyType(CuckooKeyType::INT);
+  return StripeContains(stripe_id, CuckooValue(value, num_buckets_));
+}
+
+Bitmap64 CuckooIndex::GetQualifyingStripes(int value,
+                                           size_t num_stripes) const {
+  CheckKeyType(CuckooKeyType::INT);
+  return GetQualifyingStripes(CuckooValue(value, num_buckets_), num_stripes);
+}
+
+bool CuckooIndex::StripeContains(size_t stripe_id,
+                                 const CuckooValue& val) const {
+  ScopedProfile profile(Counter::StripeContains);
+  if (fast_table_ != nullptr) {
+    size_t bitmap_offset;
+    if (!fast_table_->Lookup(val, &bitmap_offset)) return false;
+    return fast_table_->StripeContains(bitmap_offset, stripe_id);
   }
 
-  // Inactive slots are empty and their corresponding bitmaps are skipped in the
-  // `global_slot_bitmap_`, so we need to compute the actual slot by subtracting
-  // the number of skipped (empty) slots before `slot`.
-  const size_t actual_slot = GetNthNonEmptyBitmapSlot(slot);
-  const size_t global_slot_bitmap_offset =
-      num_stripes_ * actual_slot + stripe_id;
-  return global_slot_bitmap_->Get(global_slot_bitmap_offset);
+  size_t bitmap_offset;
+  if (!LookupSlotBitmap(val, &bitmap_offset)) return false;
+  return global_slot_bitmap_->Get(bitmap_offset + stripe_id);
 }
 
-Bitmap64 CuckooIndex::GetQualifyingStripes(int value,
+Bitmap64 CuckooIndex::GetQualifyingStripes(const CuckooValue& val,
                                            size_t num_stripes) const {
-  const CuckooValue val(value, num_buckets_);
-  size_t slot;
-  if (!BucketContains(val.primary_bucket, val.fingerprint, &slot)) {
-    if (!BucketContains(val.secondary_bucket, val.fingerprint, &slot)) {
+  ScopedProfile profile(Counter::Lookup);
+  if (fast_table_ != nullptr) {
+    size_t bitmap_offset;
+    if (!fast_table_->Lookup(val, &bitmap_offset)) {
       // Not found. Return an empty bitmap.
       return Bitmap64(/*size=*/num_stripes);
     }
+    return fast_table_->GetStripeBitmap(bitmap_offset);
+  }
+
+  size_t bitmap_offset;
+  if (!LookupSlotBitmap(val, &bitmap_offset)) {
+    // Not found. Return an empty bitmap.
+    return Bitmap64(/*size=*/num_stripes);
+  }
+  return global_slot_bitmap_->Extract(bitmap_offset, /*size=*/num_stripes_);
+}
+
+Bitmap64 CuckooIndex::GetQualifyingStripesIn(absl::Span<const int> values,
+                                             size_t num_stripes) const {
+  CheckKeyType(CuckooKeyType::INT);
+  ScopedProfile profile(Counter::LookupIn);
+  std::vector<int> keys(values.begin(), values.end());
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // Hash all keys upfront.
+  std::vector<CuckooValue> cuckoo_values;
+  cuckoo_values.reserve(keys.size());
+  for (const int key : keys) cuckoo_values.emplace_back(key, num_buckets_);
+
+  std::vector<size_t> bitmap_offsets;
+  bitmap_offsets.reserve(cuckoo_values.size());
+  for (const CuckooValue& val : cuckoo_values) {
+    size_t bitmap_offset;
+    const bool found = fast_table_ != nullptr
+                           ? fast_table_->Lookup(val, &bitmap_offset)
+                           : LookupSlotBitmap(val, &bitmap_offset);
+    if (found) bitmap_offsets.push_back(bitmap_offset);
+  }
+  if (bitmap_offsets.empty()) return Bitmap64(/*size=*/num_stripes);
+  // Decode the slot bitmaps in the order in which they're stored. Different
+  // keys may be found in the same slot.
+  std::sort(bitmap_offsets.begin(), bitmap_offsets.end());
+  bitmap_offsets.erase(
+      std::unique(bitmap_offsets.begin(), bitmap_offsets.end()),
+      bitmap_offsets.end());
+
+  if (fast_table_ != nullptr)
+    return fast_table_->GetStripeBitmapUnion(bitmap_offsets);
+  Bitmap64 result(/*size=*/num_stripes_);
+  global_slot_bitmap_->ExtractOr(bitmap_offsets, /*size=*/num_stripes_,
+                                 &result);
+  return result;
+}
+
+Bitmap64 CuckooIndex::GetQualifyingStripesAmong(
+    int value, const Bitmap64& candidate_stripes) const {
+  CheckKeyType(CuckooKeyType::INT);
+  ScopedProfile profile(Counter::LookupAmong);
+  const CuckooValue val(value, num_buckets_);
+  size_t bitmap_offset;
+  if (fast_table_ != nullptr) {
+    Bitmap64 result(/*size=*/candidate_stripes.bits());
+    if (!fast_table_->Lookup(val, &bitmap_offset)) return result;
+    for (const size_t stripe_id : candidate_stripes.TrueBitIndices()) {
+      if (fast_table_->StripeContains(bitmap_offset, stripe_id))
+        result.Set(stripe_id, true);
+    }
+    return result;
   }
 
+  if (!LookupSlotBitmap(val, &bitmap_offset))
+    return Bitmap64(/*size=*/candidate_stripes.bits());
+  // Only decodes the parts of the slot bitmap needed for `candidate_stripes`.
+  return global_slot_bitmap_->ExtractMasked(bitmap_offset, candidate_stripes);
+}
+
+double CuckooIndex::EstimateSelectivity(int value,
+                                        size_t /*num_stripes*/) const {
+  CheckKeyType(CuckooKeyType::INT);
+  if (num_stripes_ == 0) return 0.0;
+  const CuckooValue val(value, num_buckets_);
+  size_t bitmap_offset;
+  if (fast_table_ != nullptr) {
+    if (!fast_table_->Lookup(val, &bitmap_offset)) return 0.0;
+    return static_cast<double>(fast_table_->GetOnesCount(bitmap_offset)) /
+           num_stripes_;
+  }
+
+  if (!LookupSlotBitmap(val, &bitmap_offset)) return 0.0;
+  return static_cast<double>(
+             global_slot_bitmap_->GetOnesCount(bitmap_offset, num_stripes_)) /
+         num_stripes_;
+}
+
+void CuckooIndex::CheckKeyType(CuckooKeyType key_type) const {
+  if (key_type != key_type_) {
+    std::cerr << "Lookup of " << KeyTypeName(key_type)
+              << " keys in a CuckooIndex with " << KeyTypeName(key_type_)
+              << " keys." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+bool CuckooIndex::LookupSlotBitmap(const CuckooValue& value,
+                                   size_t* bitmap_offset) const {
+  size_t slot;
+  if (!BucketContains(value.primary_bucket, value.fingerprint, &slot)) {
+    if (!BucketContains(value.secondary_bucket, value.fingerprint, &slot))
+      return false;
+  }
+
+  // Inactive slots are empty and their corresponding bitmaps are skipped in the
+  // `global_slot_bitmap_`, so we need to compute the actual slot by subtracting
+  // the number of skipped (empty) slots before `slot`.
   const size_t actual_slot = GetNthNonEmptyBitmapSlot(slot);
-  return global_slot_bitmap_->Extract(/*offset=*/num_stripes_ * actual_slot,
-                                      /*size=*/num_stripes_);
+  *bitmap_offset = num_stripes_ * actual_slot;
+  return true;
 }
 
 bool CuckooIndex::BucketContains(size_t bucket, uint64_t fingerprint,
@@ -290,30 +427,51 @@ bool CuckooIndex::BucketContains(size_t bucket, uint64_t fingerprint,
 
 std::unique_ptr<IndexStructure> CuckooIndexFactory::Create(
     const Column& column, size_t num_rows_per_stripe) const {
-  absl::flat_hash_map<int, Bitmap64Ptr> value_to_bitmap =
-      ValueToStripeBitmaps(column, num_rows_per_stripe);
-  // Fetch the set of distinct-values in `value_to_bitmap`. Note that this is
-  // not necessarily the same as column.distinct_values(), since rows may have
-  // been dropped at the end (so each stripe has the same size).
-  absl::flat_hash_set<int> distinct_values;
-  distinct_values.reserve(value_to_bitmap.size());
-  for (const auto& [value, _] : value_to_bitmap) distinct_values.insert(value);
-
-  size_t num_buckets = GetMinNumBuckets(distinct_values.size(),
-                                        slots_per_bucket_, max_load_factor_);
+  ScopedProfile profile(Counter::CreateCuckooIndex);
+  switch (key_type_) {
+    case CuckooKeyType::INT:
+      return CreateFromKeys<int>(column.data(), num_rows_per_stripe);
+    case CuckooKeyType::STRING: {
+      if (column.type() != DataType::STRING) {
+        std::cerr << "STRING keys require a STRING column, got: "
+                  << DataTypeName(column.type()) << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      // The dictionary is only needed for hashing the strings while building
+      // the index.
+      const std::vector<std::string> dictionary = column.dictionary();
+      std::vector<absl::string_view> keys;
+      keys.reserve(column.num_rows());
+      for (const int id : column.data()) keys.push_back(dictionary[id]);
+      return CreateFromKeys<absl::string_view>(keys, num_rows_per_stripe);
+    }
+    default:
+      std::cerr << "Columns can only be indexed with INT or STRING keys."
+                << std::endl;
+      exit(EXIT_FAILURE);
+  }
+}
+
+std::unique_ptr<CuckooIndex> CuckooIndexFactory::CreateFromValues(
+    CuckooKeyType key_type, size_t num_stripes, size_t num_values,
+    const std::function<std::vector<CuckooValue>(size_t num_buckets)>&
+        hash_values,
+    absl::flat_hash_map<int, Bitmap64Ptr>* value_to_bitmap) const {
+  size_t num_buckets =
+      GetMinNumBuckets(num_values, slots_per_bucket_, max_load_factor_);
 
   std::vector<Bucket> buckets;
   {
     ScopedProfile profile(Counter::DistributeValues);
     while (buckets.empty()) {
-      std::cout << "Attempting to distribute " << distinct_values.size()
-                << " values to " << num_buckets << " buckets with "
-                << slots_per_bucket_ << " slots each. I.e., load-factor: "
-                << static_cast<double>(distinct_values.size()) /
-                    (slots_per_bucket_ * num_buckets)
+      std::cout << "Attempting to distribute " << num_values << " values to "
+                << num_buckets << " buckets with " << slots_per_bucket_
+                << " slots each. I.e., load-factor: "
+                << static_cast<double>(num_values) /
+                       (slots_per_bucket_ * num_buckets)
                 << std::endl;
       buckets = Distribute(num_buckets, slots_per_bucket_, cuckoo_alg_,
-                           distinct_values);
+                           hash_values(num_buckets));
       num_buckets =
           std::max(static_cast<size_t>(num_buckets * kNumBucketsGrowFactor),
                    num_buckets + 1);
@@ -323,9 +481,24 @@ std::unique_ptr<IndexStructure> CuckooIndexFactory::Create(
   std::vector<Fingerprint> slot_fingerprints;
   Bitmap64Ptr use_prefix_bits_bitmap;
   std::vector<Bitmap64Ptr> slot_bitmaps;
-  CreateSlots(scan_rate_, slots_per_bucket_, buckets, &value_to_bitmap,
+  CreateSlots(scan_rate_, slots_per_bucket_, buckets, value_to_bitmap,
               &slot_fingerprints, prefix_bits_optimization_,
               &use_prefix_bits_bitmap, &slot_bitmaps);
+
+  if (layout_ == CuckooIndexLayout::FAST) {
+    auto fast_table = absl::make_unique<FastCuckooTable>(
+        slot_fingerprints, slots_per_bucket_, use_prefix_bits_bitmap.get(),
+        slot_bitmaps, num_stripes);
+    size_t compressed_byte_size;
+    {
+      ScopedProfile profile(Counter::EncodeIndex);
+      compressed_byte_size = Compress(fast_table->Encode()).size();
+    }
+    return absl::WrapUnique<CuckooIndex>(new CuckooIndex(
+        IndexName(key_type), key_type, num_stripes, slots_per_bucket_,
+        std::move(fast_table), compressed_byte_size));
+  }
+
   std::unique_ptr<FingerprintStore> fingerprint_store;
   {
     ScopedProfile profile(Counter::CreateFingerprintStore);
@@ -334,28 +507,44 @@ std::unique_ptr<IndexStructure> CuckooIndexFactory::Create(
         /*use_rle_to_encode_block_bitmaps=*/false);
   }
 
-  RleBitmapPtr global_slot_bitmap;
+  SlotBitmapStorePtr global_slot_bitmap;
   {
     ScopedProfile profile(Counter::GetGlobalBitmap);
-    global_slot_bitmap =
-        absl::make_unique<RleBitmap>(GetGlobalBitmap(slot_bitmaps));
+    global_slot_bitmap = SlotBitmapStore::Create(
+        slot_bitmap_backend_, GetGlobalBitmap(slot_bitmaps), num_stripes);
   }
 
-  const std::string data =
-      Encode(*fingerprint_store, slots_per_bucket_, prefix_bits_optimization_,
-             use_prefix_bits_bitmap, *global_slot_bitmap);
+  size_t byte_size;
+  size_t compressed_byte_size;
+  {
+    ScopedProfile profile(Counter::EncodeIndex);
+    const std::string data =
+        Encode(*fingerprint_store, slots_per_bucket_, prefix_bits_optimization_,
+               use_prefix_bits_bitmap, *global_slot_bitmap);
+    byte_size = data.size();
+    compressed_byte_size = Compress(data).size();
+  }
 
   // Need to use WrapUnique<>(..) since we're calling a private c'tor.
   return absl::WrapUnique<CuckooIndex>(new CuckooIndex(
-      index_name(), /*num_stripes=*/column.num_rows() / num_rows_per_stripe,
-      slots_per_bucket_, std::move(fingerprint_store),
-      std::move(use_prefix_bits_bitmap), std::move(global_slot_bitmap),
-      data.size(), Compress(data).size()));
+      IndexName(key_type), key_type, num_stripes, slots_per_bucket_,
+      std::move(fingerprint_store), std::move(use_prefix_bits_bitmap),
+      std::move(global_slot_bitmap), byte_size, compressed_byte_size));
 }
 
 std::string CuckooIndexFactory::index_name() const {
+  return IndexName(key_type_);
+}
+
+std::string CuckooIndexFactory::IndexName(CuckooKeyType key_type) const {
   return absl::StrCat("CuckooIndex:", cuckoo_alg_, ":", max_load_factor_, ":",
-                      scan_rate_);
+                      scan_rate_,
+                      layout_ == CuckooIndexLayout::FAST ? ":fast" : "",
+                      slot_bitmap_backend_ == SlotBitmapBackend::RLE
+                          ? ""
+                          : absl::StrCat(":", SlotBitmapBackendName(
+                                                  slot_bitmap_backend_)),
+                      KeyTypeSuffix(key_type));
 }
 
 }  // namespace ci
@@ -19,20 +19,70 @@
 #ifndef CUCKOO_INDEX_CUCKOO_INDEX_H_
 #define CUCKOO_INDEX_CUCKOO_INDEX_H_
 
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
-#include "common/rle_bitmap.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "common/profiling.h"
 #include "cuckoo_utils.h"
+#include "fast_cuckoo_table.h"
 #include "fingerprint_store.h"
 #include "index_structure.h"
+#include "slot_bitmap_store.h"
 
 namespace ci {
 
 class CuckooIndex : public IndexStructure {
  public:
+  // Note that the int-keyed lookups may only be used with INT keys (see
+  // CuckooKeyType in cuckoo_utils.h). Exits for indexes with other keys.
   bool StripeContains(size_t stripe_id, int value) const override;
 
   Bitmap64 GetQualifyingStripes(int value, size_t num_stripes) const override;
 
+  // String-keyed lookups (only for STRING keys).
+  bool StripeContains(size_t stripe_id, absl::string_view value) const {
+    return StripeContainsKey(stripe_id, value);
+  }
+  Bitmap64 GetQualifyingStripes(absl::string_view value,
+                                size_t num_stripes) const {
+    return GetQualifyingStripesForKey(value, num_stripes);
+  }
+
+  // Lookups of natively hashed keys (see CuckooIndexFactory::CreateFromKeys).
+  // `Key` has to match the key type the index was built with (exits
+  // otherwise).
+  template <typename Key>
+  bool StripeContainsKey(size_t stripe_id, const Key& key) const {
+    CheckKeyType(CuckooKeyHasher<Key>::kKeyType);
+    return StripeContains(stripe_id,
+                          CuckooValue(/*value=*/0, key, num_buckets_));
+  }
+  template <typename Key>
+  Bitmap64 GetQualifyingStripesForKey(const Key& key,
+                                      size_t num_stripes) const {
+    CheckKeyType(CuckooKeyHasher<Key>::kKeyType);
+    return GetQualifyingStripes(CuckooValue(/*value=*/0, key, num_buckets_),
+                                num_stripes);
+  }
+
+  // Resolves all distinct `values` first and then decodes their slot bitmaps
+  // in a single forward pass into one result bitmap.
+  Bitmap64 GetQualifyingStripesIn(absl::Span<const int> values,
+                                  size_t num_stripes) const override;
+
+  Bitmap64 GetQualifyingStripesAmong(
+      int value, const Bitmap64& candidate_stripes) const override;
+
+  // Returns the share of stripes set in the slot bitmap of `value` (0.0 if
+  // `value` is not found in the Cuckoo table).
+  double EstimateSelectivity(int value, size_t num_stripes) const override;
+
   std::string name() const override { return name_; }
 
   // Returns the in-memory size of the index structure.
@@ -41,7 +91,10 @@ class CuckooIndex : public IndexStructure {
   // Returns the in-memory size of the compressed index structure.
   size_t compressed_byte_size() const override { return compressed_byte_size_; }
 
+  CuckooKeyType key_type() const { return key_type_; }
+
   size_t active_slots() const {
+    if (fast_table_ != nullptr) return fast_table_->active_slots();
     size_t active_slots = 0;
     for (size_t i = 0; i < fingerprint_store_->num_slots(); ++i) {
       if (fingerprint_store_->GetFingerprint(i).active) ++active_slots;
@@ -52,12 +105,14 @@ class CuckooIndex : public IndexStructure {
  private:
   friend class CuckooIndexFactory;
 
-  CuckooIndex(std::string name, size_t num_stripes, size_t slots_per_bucket,
+  CuckooIndex(std::string name, CuckooKeyType key_type, size_t num_stripes,
+              size_t slots_per_bucket,
               std::unique_ptr<FingerprintStore> fingerprint_store,
               Bitmap64Ptr use_prefix_bits_bitmap,
-              RleBitmapPtr global_slot_bitmap, size_t byte_size,
+              SlotBitmapStorePtr global_slot_bitmap, size_t byte_size,
               size_t compressed_byte_size)
       : name_(name),
+        key_type_(key_type),
         num_stripes_(num_stripes),
         num_buckets_(fingerprint_store->num_slots() / slots_per_bucket),
         slots_per_bucket_(slots_per_bucket),
@@ -69,11 +124,37 @@ class CuckooIndex : public IndexStructure {
     assert(fingerprint_store_->num_slots() % slots_per_bucket_ == 0);
   }
 
+  // Creates a CuckooIndex with the fast (uncompressed) layout.
+  CuckooIndex(std::string name, CuckooKeyType key_type, size_t num_stripes,
+              size_t slots_per_bucket,
+              std::unique_ptr<FastCuckooTable> fast_table,
+              size_t compressed_byte_size)
+      : name_(name),
+        key_type_(key_type),
+        num_stripes_(num_stripes),
+        num_buckets_(fast_table->num_buckets()),
+        slots_per_bucket_(slots_per_bucket),
+        fast_table_(std::move(fast_table)),
+        byte_size_(fast_table_->byte_size()),
+        compressed_byte_size_(compressed_byte_size) {}
+
+  // Exits if the index wasn't built with keys of `key_type`.
+  void CheckKeyType(CuckooKeyType key_type) const;
+
   // Returns true if the given bucket contains the fingerprint (taking only
   // the relevant bits into account). In case it does, `slot` is set to the
   // slot which contains it (one of the `slots_per_bucket_` possible ones).
   bool BucketContains(size_t bucket, uint64_t fingerprint, size_t* slot) const;
 
+  bool StripeContains(size_t stripe_id, const CuckooValue& value) const;
+  Bitmap64 GetQualifyingStripes(const CuckooValue& value,
+                                size_t num_stripes) const;
+
+  // Looks up `value` in its primary and secondary bucket (compressed layout
+  // only). In case it is found, returns true and sets `bitmap_offset` to the
+  // offset of its slot bitmap in `global_slot_bitmap_`.
+  bool LookupSlotBitmap(const CuckooValue& value, size_t* bitmap_offset) const;
+
   size_t GetNthNonEmptyBitmapSlot(size_t n) const {
     // Inactive slots are empty and their corresponding bitmaps are skipped in
     // the `global_slot_bitmap_`, so we need to compute the actual slot by
@@ -83,6 +164,7 @@ class CuckooIndex : public IndexStructure {
   }
 
   const std::string name_;
+  const CuckooKeyType key_type_;
   const size_t num_stripes_;
   const size_t num_buckets_;
   const size_t slots_per_bucket_;
@@ -92,7 +174,11 @@ class CuckooIndex : public IndexStructure {
   // fingerprints were used.
   const Bitmap64Ptr use_prefix_bits_bitmap_;
   // Concatenated slot bitmaps for *active* slots.
-  const RleBitmapPtr global_slot_bitmap_;
+  const SlotBitmapStorePtr global_slot_bitmap_;
+
+  // Only set for the fast layout, in which case the three members above are
+  // not set.
+  const std::unique_ptr<FastCuckooTable> fast_table_;
 
   // The sizes of the encoded data-structures.
   // TODO: after fine-tuning the encodings, actually store the encoded
@@ -110,24 +196,59 @@ class CuckooIndex : public IndexStructure {
 // weighted-matching algorithm (MATCHING).
 enum class CuckooAlgorithm { KICKING, SKEWED_KICKING, MATCHING };
 
+// The in-memory layout of a CuckooIndex: either optimized for size, with
+// variable-length fingerprints and RLE-compressed slot bitmaps (COMPRESSED), or
+// optimized for lookup latency, with cache-line-aligned buckets of fixed-width
+// fingerprints and uncompressed slot bitmaps (FAST, see fast_cuckoo_table.h).
+enum class CuckooIndexLayout { COMPRESSED, FAST };
+
 class CuckooIndexFactory : public IndexStructureFactory {
  public:
   explicit CuckooIndexFactory(CuckooAlgorithm cuckoo_alg,
                               double max_load_factor, double scan_rate,
                               size_t slots_per_bucket,
-                              bool prefix_bits_optimization)
+                              bool prefix_bits_optimization,
+                              CuckooIndexLayout layout =
+                                  CuckooIndexLayout::COMPRESSED,
+                              SlotBitmapBackend slot_bitmap_backend =
+                                  SlotBitmapBackend::RLE,
+                              CuckooKeyType key_type = CuckooKeyType::INT)
       : cuckoo_alg_(cuckoo_alg),
         max_load_factor_(max_load_factor),
         scan_rate_(scan_rate),
         slots_per_bucket_(slots_per_bucket),
-        prefix_bits_optimization_(prefix_bits_optimization) {}
+        prefix_bits_optimization_(prefix_bits_optimization),
+        layout_(layout),
+        slot_bitmap_backend_(slot_bitmap_backend),
+        key_type_(key_type) {}
 
+  // Indexes the ints of `column` (INT keys) or the strings of a STRING column
+  // (STRING keys).
   std::unique_ptr<IndexStructure> Create(
       const Column& column, size_t num_rows_per_stripe) const override;
 
+  // Creates a CuckooIndex over `keys` (one per row), hashing the keys natively
+  // (i.e., without dictionary-encoding them first). The factory's key type is
+  // ignored, the index uses the key type of `Key`. Look up keys with
+  // CuckooIndex::StripeContainsKey(..) / GetQualifyingStripesForKey(..).
+  template <typename Key>
+  std::unique_ptr<CuckooIndex> CreateFromKeys(absl::Span<const Key> keys,
+                                              size_t num_rows_per_stripe) const;
+
   std::string index_name() const override;
 
  private:
+  // Creates a CuckooIndex over `num_values` distinct values. `hash_values`
+  // returns the values hashed to the given number of buckets, identified by
+  // their CuckooValue::orig_value, which is the key of `value_to_bitmap`.
+  std::unique_ptr<CuckooIndex> CreateFromValues(
+      CuckooKeyType key_type, size_t num_stripes, size_t num_values,
+      const std::function<std::vector<CuckooValue>(size_t num_buckets)>&
+          hash_values,
+      absl::flat_hash_map<int, Bitmap64Ptr>* value_to_bitmap) const;
+
+  std::string IndexName(CuckooKeyType key_type) const;
+
   const CuckooAlgorithm cuckoo_alg_;
   const double max_load_factor_;
   const double scan_rate_;
@@ -136,8 +257,53 @@ class CuckooIndexFactory : public IndexStructureFactory {
   // on a bucket basis (depending on which of the two requires fewer bits to
   // make fingerprints collision free).
   const bool prefix_bits_optimization_;
+  const CuckooIndexLayout layout_;
+  // The backend storing the slot bitmaps (only used by the compressed layout).
+  const SlotBitmapBackend slot_bitmap_backend_;
+  // The key type used by Create(..): INT or STRING (requires a STRING column).
+  const CuckooKeyType key_type_;
 };
 
+template <typename Key>
+std::unique_ptr<CuckooIndex> CuckooIndexFactory::CreateFromKeys(
+    absl::Span<const Key> keys, size_t num_rows_per_stripe) const {
+  // Round down the number of rows to the next multiple of
+  // `num_rows_per_stripe`, i.e., ignore the last stripe as elsewhere.
+  const size_t num_stripes = keys.size() / num_rows_per_stripe;
+  const size_t num_rows = num_stripes * num_rows_per_stripe;
+
+  // Assign ids to the distinct keys and collect their stripe-bitmaps. Keys
+  // are canonicalized first, so that keys hashing equally (e.g., all NaNs)
+  // get the same id.
+  std::vector<Key> distinct_keys;
+  absl::flat_hash_map<int, Bitmap64Ptr> value_to_bitmap;
+  {
+    ScopedProfile profile(Counter::ValueToStripeBitmaps);
+    absl::flat_hash_map<Key, int, absl::Hash<Key>, CuckooKeyEq<Key>> key_ids;
+    for (size_t row = 0; row < num_rows; ++row) {
+      const auto& key = CanonicalizeCuckooKey(keys[row]);
+      const auto [it, inserted] =
+          key_ids.try_emplace(key, distinct_keys.size());
+      if (inserted) {
+        distinct_keys.push_back(key);
+        value_to_bitmap[it->second] =
+            absl::make_unique<Bitmap64>(/*size=*/num_stripes);
+      }
+      value_to_bitmap[it->second]->Set(row / num_rows_per_stripe, true);
+    }
+  }
+
+  const auto hash_values = [&distinct_keys](size_t num_buckets) {
+    std::vector<CuckooValue> values;
+    values.reserve(distinct_keys.size());
+    for (size_t id = 0; id < distinct_keys.size(); ++id)
+      values.emplace_back(id, distinct_keys[id], num_buckets);
+    return values;
+  };
+  return CreateFromValues(CuckooKeyHasher<Key>::kKeyType, num_stripes,
+                          distinct_keys.size(), hash_values, &value_to_bitmap);
+}
+
 }  // namespace ci
 
 #endif  // CUCKOO_INDEX_CUCKOO_INDEX_H_
@@ -18,9 +18,15 @@
 
 #include "cuckoo_index.h"
 
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <limits>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "cuckoo_utils.h"
 #include "data.h"
 #include "gmock/gmock.h"
@@ -76,8 +82,9 @@ double ScanRateNegativeLookups(const Column& column,
 
 // Helper for the PositiveLookups* tests below: checks lookups of all existing
 // values are exact.
-void PositiveLookups(const size_t num_values,
-                     const bool prefix_bits_optimization) {
+void PositiveLookups(
+    const size_t num_values, const bool prefix_bits_optimization,
+    const CuckooIndexLayout layout = CuckooIndexLayout::COMPRESSED) {
   const ColumnPtr column = FillColumn(kNumRows, num_values);
 
   for (const CuckooAlgorithm alg :
@@ -85,7 +92,8 @@ void PositiveLookups(const size_t num_values,
     const IndexStructurePtr index =
         CuckooIndexFactory(alg, kMaxLoadFactor2SlotsPerBucket,
                            /*scan_rate=*/0.05,
-                           /*slots_per_bucket=*/2, prefix_bits_optimization)
+                           /*slots_per_bucket=*/2, prefix_bits_optimization,
+                           layout)
             .Create(*column, kNumRowsPerStripe);
     CheckPositiveLookups(*column, index.get());
   }
@@ -93,8 +101,9 @@ void PositiveLookups(const size_t num_values,
 
 // Creates two different cuckoo-indexes with scan-rate 0.1 and 0.01 and checks
 // that the scan-rate is bounded as expected.
-void NegativeLookups(const size_t num_values,
-                     const bool prefix_bits_optimization) {
+void NegativeLookups(
+    const size_t num_values, const bool prefix_bits_optimization,
+    const CuckooIndexLayout layout = CuckooIndexLayout::COMPRESSED) {
   const ColumnPtr column = FillColumn(kNumRows, num_values);
 
   for (const CuckooAlgorithm alg :
@@ -102,7 +111,7 @@ void NegativeLookups(const size_t num_values,
     const IndexStructurePtr index1 =
         CuckooIndexFactory(alg, kMaxLoadFactor2SlotsPerBucket,
                            /*scan_rate=*/0.1, /*slots_per_bucket=*/2,
-                           prefix_bits_optimization)
+                           prefix_bits_optimization, layout)
             .Create(*column, kNumRowsPerStripe);
     const double scan_rate1 = ScanRateNegativeLookups(*column, index1.get());
     EXPECT_LE(scan_rate1, 0.101);
@@ -172,6 +181,283 @@ TEST(CuckooIndexTest, NegativeLookupsAllUniques) {
 // NegativeLookups([>num_values=<]kNumRows, [>prefix_bits_optimization=<]true);
 // }
 
+TEST(CuckooIndexTest, PositiveLookupsFewValuesFastLayout) {
+  PositiveLookups(/*num_values=*/30, /*prefix_bits_optimization=*/false,
+                  CuckooIndexLayout::FAST);
+}
+
+TEST(CuckooIndexTest, PositiveLookupsAllUniquesFastLayout) {
+  PositiveLookups(/*num_values=*/kNumRows, /*prefix_bits_optimization=*/false,
+                  CuckooIndexLayout::FAST);
+}
+
+TEST(CuckooIndexTest,
+     PositiveLookupsAllUniquesFastLayoutWithPrefixBitsOptimization) {
+  PositiveLookups(/*num_values=*/kNumRows, /*prefix_bits_optimization=*/true,
+                  CuckooIndexLayout::FAST);
+}
+
+TEST(CuckooIndexTest, NegativeLookupsFewValuesFastLayout) {
+  NegativeLookups(/*num_values=*/30, /*prefix_bits_optimization=*/false,
+                  CuckooIndexLayout::FAST);
+}
+
+TEST(CuckooIndexTest, FastLayoutMatchesCompressedLayout) {
+  const ColumnPtr column = FillColumn(kNumRows, /*num_values=*/30);
+  const size_t num_stripes = column->num_rows() / kNumRowsPerStripe;
+  const auto create = [&](const CuckooIndexLayout layout) {
+    return CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                              kMaxLoadFactor4SlotsPerBucket,
+                              /*scan_rate=*/0.1, /*slots_per_bucket=*/4,
+                              /*prefix_bits_optimization=*/false, layout)
+        .Create(*column, kNumRowsPerStripe);
+  };
+  const IndexStructurePtr compressed = create(CuckooIndexLayout::COMPRESSED);
+  const IndexStructurePtr fast = create(CuckooIndexLayout::FAST);
+  EXPECT_EQ(reinterpret_cast<const CuckooIndex&>(*fast).active_slots(),
+            reinterpret_cast<const CuckooIndex&>(*compressed).active_slots());
+  // Note: negative lookups may differ, since kicking is randomized.
+  for (const int value : column->distinct_values()) {
+    EXPECT_EQ(fast->GetQualifyingStripes(value, num_stripes).ToString(),
+              compressed->GetQualifyingStripes(value, num_stripes).ToString());
+  }
+}
+
+TEST(CuckooIndexTest, PositiveLookupsWithAllSlotBitmapBackends) {
+  const ColumnPtr column = FillColumn(kNumRows, /*num_values=*/30);
+  for (const SlotBitmapBackend backend :
+       {SlotBitmapBackend::RLE, SlotBitmapBackend::ROARING,
+        SlotBitmapBackend::DENSE, SlotBitmapBackend::SORTED_LIST,
+        SlotBitmapBackend::AUTO}) {
+    const IndexStructurePtr index =
+        CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                           kMaxLoadFactor2SlotsPerBucket,
+                           /*scan_rate=*/0.05, /*slots_per_bucket=*/2,
+                           /*prefix_bits_optimization=*/false,
+                           CuckooIndexLayout::COMPRESSED, backend)
+            .Create(*column, kNumRowsPerStripe);
+    CheckPositiveLookups(*column, index.get());
+  }
+}
+
+TEST(CuckooIndexTest, QualifyingStripesAmongCandidates) {
+  const ColumnPtr column = FillColumn(kNumRows, /*num_values=*/30);
+  const size_t num_stripes = column->num_rows() / kNumRowsPerStripe;
+  // Every third stripe is a candidate.
+  Bitmap64 candidates(/*size=*/num_stripes);
+  for (size_t i = 0; i < num_stripes; i += 3) candidates.Set(i, true);
+  for (const CuckooIndexLayout layout :
+       {CuckooIndexLayout::COMPRESSED, CuckooIndexLayout::FAST}) {
+    const IndexStructurePtr index =
+        CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                           kMaxLoadFactor2SlotsPerBucket,
+                           /*scan_rate=*/0.05, /*slots_per_bucket=*/2,
+                           /*prefix_bits_optimization=*/false, layout)
+            .Create(*column, kNumRowsPerStripe);
+    for (const int value : column->distinct_values()) {
+      Bitmap64 expected = index->GetQualifyingStripes(value, num_stripes);
+      const double expected_selectivity =
+          static_cast<double>(expected.GetOnesCount()) / num_stripes;
+      expected &= candidates;
+      EXPECT_EQ(index->GetQualifyingStripesAmong(value, candidates).ToString(),
+                expected.ToString());
+      EXPECT_DOUBLE_EQ(index->EstimateSelectivity(value, num_stripes),
+                       expected_selectivity);
+    }
+  }
+}
+
+TEST(CuckooIndexTest, InListLookups) {
+  const ColumnPtr column = FillColumn(kNumRows, /*num_values=*/30);
+  const size_t num_stripes = column->num_rows() / kNumRowsPerStripe;
+  // Some present values (with duplicates) and some absent ones.
+  const std::vector<int> values = {3, 17, 3, 29, 5, 1000, -1, 17};
+  for (const CuckooIndexLayout layout :
+       {CuckooIndexLayout::COMPRESSED, CuckooIndexLayout::FAST}) {
+    const IndexStructurePtr index =
+        CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                           kMaxLoadFactor2SlotsPerBucket,
+                           /*scan_rate=*/0.05, /*slots_per_bucket=*/2,
+                           /*prefix_bits_optimization=*/false, layout)
+            .Create(*column, kNumRowsPerStripe);
+    Bitmap64 expected(/*size=*/num_stripes);
+    for (const int value : values)
+      expected |= index->GetQualifyingStripes(value, num_stripes);
+    EXPECT_EQ(index->GetQualifyingStripesIn(values, num_stripes).ToString(),
+              expected.ToString());
+    EXPECT_EQ(index->GetQualifyingStripesIn({}, num_stripes).GetOnesCount(),
+              0);
+  }
+}
+
+TEST(CuckooIndexTest, StringKeyedLookups) {
+  std::vector<std::string> str_data;
+  for (size_t i = 0; i < kNumRows; ++i)
+    str_data.push_back(absl::StrCat("value-", i / 10));
+  const Column column("string-column", DataType::STRING, str_data);
+  const size_t num_stripes = column.num_rows() / kNumRowsPerStripe;
+  const std::vector<std::string> dictionary = column.dictionary();
+  for (const CuckooIndexLayout layout :
+       {CuckooIndexLayout::COMPRESSED, CuckooIndexLayout::FAST}) {
+    const IndexStructurePtr index =
+        CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                           kMaxLoadFactor2SlotsPerBucket,
+                           /*scan_rate=*/0.001, /*slots_per_bucket=*/2,
+                           /*prefix_bits_optimization=*/false, layout,
+                           SlotBitmapBackend::RLE, CuckooKeyType::STRING)
+            .Create(column, kNumRowsPerStripe);
+    const auto& cuckoo_index = reinterpret_cast<const CuckooIndex&>(*index);
+    EXPECT_EQ(cuckoo_index.key_type(), CuckooKeyType::STRING);
+    for (const int id : column.distinct_values()) {
+      const Bitmap64 result =
+          cuckoo_index.GetQualifyingStripes(dictionary[id], num_stripes);
+      for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+        EXPECT_EQ(column.StripeContains(kNumRowsPerStripe, stripe_id, id),
+                  result.Get(stripe_id));
+        EXPECT_EQ(cuckoo_index.StripeContains(stripe_id, dictionary[id]),
+                  result.Get(stripe_id));
+      }
+    }
+    // Few false positives for strings that are not in the column.
+    size_t num_false_positives = 0;
+    for (int i = 0; i < kNumNegativeLookups; ++i) {
+      num_false_positives +=
+          cuckoo_index
+              .GetQualifyingStripes(absl::StrCat("absent-", i), num_stripes)
+              .GetOnesCount();
+    }
+    EXPECT_LT(static_cast<double>(num_false_positives) /
+                  (kNumNegativeLookups * num_stripes),
+              0.01);
+  }
+}
+
+TEST(CuckooIndexDeathTest, IntLookupsFailForStringKeys) {
+  std::vector<std::string> str_data;
+  for (size_t i = 0; i < kNumRows; ++i)
+    str_data.push_back(absl::StrCat("value-", i / 10));
+  const Column column("string-column", DataType::STRING, str_data);
+  const size_t num_stripes = column.num_rows() / kNumRowsPerStripe;
+  const IndexStructurePtr index =
+      CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                         kMaxLoadFactor2SlotsPerBucket,
+                         /*scan_rate=*/0.001, /*slots_per_bucket=*/2,
+                         /*prefix_bits_optimization=*/false,
+                         CuckooIndexLayout::COMPRESSED, SlotBitmapBackend::RLE,
+                         CuckooKeyType::STRING)
+          .Create(column, kNumRowsPerStripe);
+  const char* const kMessage =
+      "Lookup of INT keys in a CuckooIndex with STRING keys";
+  EXPECT_DEATH(index->StripeContains(/*stripe_id=*/0, /*value=*/1), kMessage);
+  EXPECT_DEATH(index->GetQualifyingStripes(/*value=*/1, num_stripes),
+               kMessage);
+  EXPECT_DEATH(index->GetQualifyingStripesIn({1, 2}, num_stripes), kMessage);
+  EXPECT_DEATH(index->GetQualifyingStripesAmong(
+                   /*value=*/1, Bitmap64(num_stripes, /*fill_value=*/true)),
+               kMessage);
+  EXPECT_DEATH(index->EstimateSelectivity(/*value=*/1, num_stripes), kMessage);
+}
+
+// Checks that lookups of all `keys` in an index created from them are exact.
+template <typename Key>
+void CheckNativeKeyLookups(const std::vector<Key>& keys) {
+  const size_t num_stripes = keys.size() / kNumRowsPerStripe;
+  for (const CuckooIndexLayout layout :
+       {CuckooIndexLayout::COMPRESSED, CuckooIndexLayout::FAST}) {
+    const std::unique_ptr<CuckooIndex> index =
+        CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                           kMaxLoadFactor2SlotsPerBucket,
+                           /*scan_rate=*/0.05, /*slots_per_bucket=*/2,
+                           /*prefix_bits_optimization=*/false, layout)
+            .CreateFromKeys<Key>(keys, kNumRowsPerStripe);
+    EXPECT_EQ(index->key_type(), CuckooKeyHasher<Key>::kKeyType);
+    for (const Key& key : keys) {
+      const Bitmap64 result =
+          index->GetQualifyingStripesForKey(key, num_stripes);
+      for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+        bool expected = false;
+        for (size_t i = 0; i < kNumRowsPerStripe; ++i)
+          expected |= keys[stripe_id * kNumRowsPerStripe + i] == key;
+        EXPECT_EQ(result.Get(stripe_id), expected);
+        EXPECT_EQ(index->StripeContainsKey(stripe_id, key), expected);
+      }
+    }
+  }
+}
+
+TEST(CuckooIndexTest, NativeKeyLookups) {
+  std::vector<int64_t> int64_keys;
+  std::vector<uint64_t> uint64_keys;
+  std::vector<double> double_keys;
+  std::vector<std::array<char, 8>> binary_keys;
+  for (size_t i = 0; i < kNumRows; ++i) {
+    // Keys beyond the int range that only differ in their upper bits.
+    int64_keys.push_back(-(static_cast<int64_t>(i / 10) << 40));
+    uint64_keys.push_back(std::numeric_limits<uint64_t>::max() - i / 10);
+    double_keys.push_back(i / 10 * 0.5);
+    std::array<char, 8> binary_key = {'k', 'e', 'y'};
+    binary_key[7] = static_cast<char>(i / 10);
+    binary_keys.push_back(binary_key);
+  }
+  CheckNativeKeyLookups(int64_keys);
+  CheckNativeKeyLookups(uint64_keys);
+  CheckNativeKeyLookups(double_keys);
+  CheckNativeKeyLookups(binary_keys);
+}
+
+TEST(CuckooIndexTest, EqualDoubleKeysAreMerged) {
+  // Different NaNs and 0.0 / -0.0 are one key each.
+  const double kNaN = std::numeric_limits<double>::quiet_NaN();
+  std::vector<double> keys;
+  for (size_t i = 0; i < kNumRows; ++i) {
+    if (i % 3 == 0) {
+      keys.push_back(i % 2 == 0 ? kNaN : -kNaN);
+    } else if (i % 3 == 1) {
+      keys.push_back(i % 2 == 0 ? 0.0 : -0.0);
+    } else {
+      keys.push_back(static_cast<double>(i));
+    }
+  }
+  const size_t num_stripes = keys.size() / kNumRowsPerStripe;
+  const std::unique_ptr<CuckooIndex> index =
+      CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                         kMaxLoadFactor2SlotsPerBucket,
+                         /*scan_rate=*/0.05, /*slots_per_bucket=*/2,
+                         /*prefix_bits_optimization=*/false)
+          .CreateFromKeys<double>(keys, kNumRowsPerStripe);
+  for (const double key : {kNaN, -kNaN, 0.0, -0.0}) {
+    const Bitmap64 result =
+        index->GetQualifyingStripesForKey(key, num_stripes);
+    for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+      bool expected = false;
+      for (size_t i = 0; i < kNumRowsPerStripe; ++i) {
+        const double other = keys[stripe_id * kNumRowsPerStripe + i];
+        expected |= std::isnan(key) ? std::isnan(other) : other == key;
+      }
+      EXPECT_EQ(result.Get(stripe_id), expected);
+    }
+  }
+}
+
+TEST(CuckooIndexDeathTest, KeyLookupsFailForOtherKeyTypes) {
+  std::vector<int64_t> keys;
+  for (size_t i = 0; i < kNumRows; ++i)
+    keys.push_back(static_cast<int64_t>(i / 10) << 40);
+  const std::unique_ptr<CuckooIndex> index =
+      CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                         kMaxLoadFactor2SlotsPerBucket,
+                         /*scan_rate=*/0.05, /*slots_per_bucket=*/2,
+                         /*prefix_bits_optimization=*/false)
+          .CreateFromKeys<int64_t>(keys, kNumRowsPerStripe);
+  const char* const kMessage =
+      "Lookup of UINT64 keys in a CuckooIndex with INT64 keys";
+  EXPECT_DEATH(index->StripeContainsKey(/*stripe_id=*/0, uint64_t{1}),
+               kMessage);
+  const size_t num_stripes = keys.size() / kNumRowsPerStripe;
+  EXPECT_DEATH(index->GetQualifyingStripesForKey(uint64_t{1}, num_stripes),
+               kMessage);
+}
+
 TEST(CuckooIndexTest, LastRowDropped) {
   // The last row will be dropped, since only stripes with `kNumRowsPerStripe`
   // (= 3) rows are created.
@@ -19,6 +19,8 @@
 #ifndef CUCKOO_INDEX_CUCKOO_KICKER_H_
 #define CUCKOO_INDEX_CUCKOO_KICKER_H_
 
+#include <random>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/random/random.h"
 #include "cuckoo_utils.h"
@@ -54,7 +56,7 @@ class CuckooKicker {
   // to build failures.
   CuckooKicker(size_t slots_per_bucket, absl::Span<Bucket> buckets,
                bool skew_kicking = false, size_t max_kicks = kDefaultMaxKicks)
-      : gen_(absl::SeedSeq({42})),
+      : gen_(42),
         slots_per_bucket_(slots_per_bucket),
         buckets_(buckets),
         skew_kicking_(skew_kicking),
@@ -137,7 +139,9 @@ class CuckooKicker {
   // `kNumMaxKicks` kicks).
   bool InsertValueWithKicking(const CuckooValue& value);
 
-  absl::BitGen gen_;
+  // Not an absl::BitGen, which salts its seed per process. This way, the same
+  // values are kicked in every run.
+  std::mt19937 gen_;
   const size_t slots_per_bucket_;
   absl::Span<Bucket> buckets_;
 
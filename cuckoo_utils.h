@@ -19,9 +19,13 @@
 #ifndef CUCKOO_INDEX_CUCKOO_UTILS_H_
 #define CUCKOO_INDEX_CUCKOO_UTILS_H_
 
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "absl/hash/internal/city.h"
@@ -38,6 +42,9 @@ constexpr uint64_t kSeedPrimaryBucket = 17;
 constexpr uint64_t kSeedSecondaryBucket = 23;
 constexpr uint64_t kSeedFingerprint = 42;
 
+// Size of a cache line in bytes.
+constexpr size_t kCacheLineSize = 64;
+
 // Maximum load factors (in terms of occupied vs. all slots). Obtained from the
 // Cuckoo filter paper:
 // https://www.cs.cmu.edu/~dga/papers/cuckoo-conext2014.pdf.
@@ -109,22 +116,109 @@ bool CheckWhetherAllBucketsOnlyContainSameSizeFingerprints(
     const std::vector<Fingerprint>& fingerprints,
     const size_t slots_per_bucket);
 
+// The type of the keys hashed by a CuckooIndex.
+enum class CuckooKeyType { INT, INT64, UINT64, DOUBLE, BINARY, STRING };
+
+// Returns the canonical form of `key`. Keys that CuckooKeyHasher treats as
+// equal are identical after canonicalization. Only doubles need it: 0.0 and
+// -0.0 are equal and all NaNs are treated as one key.
+template <typename Key>
+const Key& CanonicalizeCuckooKey(const Key& key) {
+  return key;
+}
+inline double CanonicalizeCuckooKey(double key) {
+  if (key == 0.0) return 0.0;
+  if (std::isnan(key)) return std::numeric_limits<double>::quiet_NaN();
+  return key;
+}
+
+// Compares canonicalized keys. Unlike operator== for doubles, NaN equals NaN.
+template <typename Key>
+struct CuckooKeyEq {
+  bool operator()(const Key& a, const Key& b) const { return a == b; }
+};
+template <>
+struct CuckooKeyEq<double> {
+  bool operator()(double a, double b) const {
+    return a == b || (std::isnan(a) && std::isnan(b));
+  }
+};
+
+// Hashes keys of type `Key` with a given seed. Specialized at compile-time per
+// key type: fixed-width keys hash their bytes, variable-length keys hash their
+// contents.
+template <typename Key, typename Enable = void>
+struct CuckooKeyHasher;
+
+// Integral keys: int (i.e., also dictionary ids), int64_t and uint64_t.
+template <typename Key>
+struct CuckooKeyHasher<Key, std::enable_if_t<std::is_integral_v<Key>>> {
+  static_assert(std::is_same_v<Key, int> || std::is_same_v<Key, int64_t> ||
+                    std::is_same_v<Key, uint64_t>,
+                "Unsupported integral key type.");
+  static constexpr CuckooKeyType kKeyType =
+      std::is_same_v<Key, int>       ? CuckooKeyType::INT
+      : std::is_same_v<Key, int64_t> ? CuckooKeyType::INT64
+                                     : CuckooKeyType::UINT64;
+
+  static uint64_t Hash(Key key, uint64_t seed) {
+    return absl::hash_internal::CityHash64WithSeed(
+        reinterpret_cast<const char*>(&key), sizeof(key), seed);
+  }
+};
+
+template <>
+struct CuckooKeyHasher<double> {
+  static constexpr CuckooKeyType kKeyType = CuckooKeyType::DOUBLE;
+
+  static uint64_t Hash(double key, uint64_t seed) {
+    key = CanonicalizeCuckooKey(key);
+    return absl::hash_internal::CityHash64WithSeed(
+        reinterpret_cast<const char*>(&key), sizeof(key), seed);
+  }
+};
+
+// Fixed-width binary keys (e.g., UUIDs).
+template <size_t N>
+struct CuckooKeyHasher<std::array<char, N>> {
+  static constexpr CuckooKeyType kKeyType = CuckooKeyType::BINARY;
+
+  static uint64_t Hash(const std::array<char, N>& key, uint64_t seed) {
+    return absl::hash_internal::CityHash64WithSeed(key.data(), N, seed);
+  }
+};
+
+template <>
+struct CuckooKeyHasher<absl::string_view> {
+  static constexpr CuckooKeyType kKeyType = CuckooKeyType::STRING;
+
+  static uint64_t Hash(absl::string_view key, uint64_t seed) {
+    return absl::hash_internal::CityHash64WithSeed(key.data(), key.size(),
+                                                   seed);
+  }
+};
+
+template <>
+struct CuckooKeyHasher<std::string> : CuckooKeyHasher<absl::string_view> {};
+
 // Representation of a value as its two buckets and fingerprint.
 struct CuckooValue {
-  CuckooValue(int value, size_t num_buckets) {
-    orig_value = value;
-
-    // *** POSSIBLY CHOOSE ANOTHER HASHING ALGORITHM ***
-    auto value_data = reinterpret_cast<const char*>(&value);
-    primary_bucket = absl::hash_internal::CityHash64WithSeed(
-                         value_data, sizeof(value), kSeedPrimaryBucket) %
-                     num_buckets;
-    secondary_bucket = absl::hash_internal::CityHash64WithSeed(
-                           value_data, sizeof(value), kSeedSecondaryBucket) %
-                       num_buckets;
-    fingerprint = absl::hash_internal::CityHash64WithSeed(
-        value_data, sizeof(value), kSeedFingerprint);
-  }
+  CuckooValue(int value, size_t num_buckets)
+      : CuckooValue(value, /*key=*/value, num_buckets) {}
+
+  // Hashes `key` instead of `value` (e.g., the bytes of a string rather than
+  // its dictionary id). `value` is only kept to identify the value while
+  // building the index.
+  // *** POSSIBLY CHOOSE ANOTHER HASHING ALGORITHM ***
+  template <typename Key>
+  CuckooValue(int value, const Key& key, size_t num_buckets)
+      : orig_value(value),
+        primary_bucket(CuckooKeyHasher<Key>::Hash(key, kSeedPrimaryBucket) %
+                       num_buckets),
+        secondary_bucket(
+            CuckooKeyHasher<Key>::Hash(key, kSeedSecondaryBucket) %
+            num_buckets),
+        fingerprint(CuckooKeyHasher<Key>::Hash(key, kSeedFingerprint)) {}
 
   std::string ToString() const {
     return absl::StrFormat("{v=%d fp=%llx (%llu | %llu)}", orig_value,
@@ -18,8 +18,11 @@
 
 #include "cuckoo_utils.h"
 
+#include <array>
+#include <cstdint>
 #include <string>
 
+#include "absl/strings/string_view.h"
 #include "evaluation_utils.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -110,6 +113,38 @@ TEST(CuckooUtilsTest, CheckWhetherAllBucketsOnlyContainSameSizeFingerprints) {
       fingerprints, /*slots_per_bucket=*/4));
 }
 
+TEST(CuckooValueTest, HashesKeysByType) {
+  const size_t num_buckets = 1000;
+  // Int values hash the same as int keys.
+  const CuckooValue value(/*value=*/42, num_buckets);
+  const CuckooValue int_key(/*value=*/0, /*key=*/42, num_buckets);
+  EXPECT_EQ(value.fingerprint, int_key.fingerprint);
+  EXPECT_EQ(value.primary_bucket, int_key.primary_bucket);
+  EXPECT_EQ(value.secondary_bucket, int_key.secondary_bucket);
+
+  // Keys beyond the int range are distinguished.
+  const int64_t large_key = int64_t{1} << 40;
+  EXPECT_NE(CuckooValue(/*value=*/0, large_key, num_buckets).fingerprint,
+            CuckooValue(/*value=*/0, large_key + 1, num_buckets).fingerprint);
+
+  // Equal doubles hash equally.
+  EXPECT_EQ(CuckooValue(/*value=*/0, 0.0, num_buckets).fingerprint,
+            CuckooValue(/*value=*/0, -0.0, num_buckets).fingerprint);
+
+  // Strings hash the same as string views.
+  EXPECT_EQ(CuckooValue(/*value=*/0, std::string("abc"), num_buckets)
+                .fingerprint,
+            CuckooValue(/*value=*/0, absl::string_view("abc"), num_buckets)
+                .fingerprint);
+
+  EXPECT_EQ(CuckooKeyHasher<int>::kKeyType, CuckooKeyType::INT);
+  EXPECT_EQ(CuckooKeyHasher<int64_t>::kKeyType, CuckooKeyType::INT64);
+  EXPECT_EQ(CuckooKeyHasher<uint64_t>::kKeyType, CuckooKeyType::UINT64);
+  EXPECT_EQ(CuckooKeyHasher<double>::kKeyType, CuckooKeyType::DOUBLE);
+  EXPECT_EQ((CuckooKeyHasher<std::array<char, 16>>::kKeyType),
+            CuckooKeyType::BINARY);
+}
+
 TEST(BucketTest, BucketInsertValue) {
   Bucket bucket(/*num_slots=*/1);
   // Insert should succeed, since `bucket` has capacity for another slot.
@@ -16,15 +16,486 @@
 // File: data.cc
 // -----------------------------------------------------------------------------
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <limits>
 #include <random>
+#include <thread>
+#include <utility>
 
 #include "data.h"
 
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "single_include/csv.hpp"
+
 namespace ci {
 
 const int Column::kIntNullSentinel;
 const char* const Column::kStringNullSentinel;
 
+namespace {
+
+// Returns true and sets `result` if `value` consists of digits only and fits
+// into an int.
+bool ParseIntValue(const std::string& value, int* result) {
+  if (value.empty() || value.size() > 10 ||
+      !std::all_of(value.begin(), value.end(),
+                   [](unsigned char c) { return std::isdigit(c); })) {
+    return false;
+  }
+  const long long parsed = std::stoll(value);
+  if (parsed > std::numeric_limits<int>::max()) return false;
+  *result = static_cast<int>(parsed);
+  return true;
+}
+
+// Encodes the values of a CSV column on the fly.
+//
+// As long as all values are ints (or NULL), the column is assumed to be an INT
+// column and canonical ints are stored as is. Values that can't be restored
+// from their int (NULL and ints with leading zeros) are stored as negative
+// provisional IDs, so that no information is lost in case the column turns
+// out to be a STRING column. Once the first non-int value shows up, all
+// values are converted to provisional string IDs in the order of their first
+// appearance, which Finish(..) maps to the final (order-preserving) IDs.
+//
+// Note that empty values are not ints, so they turn a column into a STRING
+// column (the empty string is a regular value of the column).
+class CsvColumnEncoder {
+ public:
+  void Add(const std::vector<std::string>& values) {
+    for (const std::string& value : values) {
+      if (is_int_) {
+        int int_value;
+        if (ParseIntValue(value, &int_value)) {
+          // Leading zeros would get lost.
+          const bool is_canonical = value.size() == 1 || value[0] != '0';
+          data_.push_back(is_canonical ? int_value : -1 - GetId(value));
+          continue;
+        }
+        if (value == Column::kStringNullSentinel) {
+          data_.push_back(-1 - GetId(value));
+          continue;
+        }
+        ConvertToString();
+      }
+      data_.push_back(GetId(value));
+    }
+  }
+
+  ColumnPtr Finish(const std::string& name) {
+    if (is_int_) {
+      // Map the non-canonical values to their ints.
+      std::vector<int> ints(ids_.size());
+      for (const auto& [value, id] : ids_) {
+        ints[id] = value == Column::kStringNullSentinel
+                       ? Column::kIntNullSentinel
+                       : std::stoi(value);
+      }
+      ids_.clear();
+      for (int& value : data_) {
+        if (value < 0) value = ints[-1 - value];
+      }
+      return Column::FromEncoded(name, DataType::INT, std::move(data_),
+                                 /*dictionary=*/nullptr);
+    }
+
+    // NULL gets ID 0 and all other strings their rank + 1. Move the strings
+    // out of `ids_` instead of copying them.
+    std::vector<int> final_ids(ids_.size(), Column::kIntNullSentinel);
+    std::vector<std::pair<std::string, int>> strings;
+    strings.reserve(ids_.size());
+    for (auto it = ids_.begin(); it != ids_.end();) {
+      auto node = ids_.extract(it++);
+      if (node.key() != Column::kStringNullSentinel)
+        strings.emplace_back(std::move(node.key()), node.mapped());
+    }
+    std::sort(strings.begin(), strings.end());
+    std::vector<std::string> sorted_strings;
+    sorted_strings.reserve(strings.size());
+    for (size_t i = 0; i < strings.size(); ++i) {
+      final_ids[strings[i].second] = i + 1;
+      sorted_strings.push_back(std::move(strings[i].first));
+    }
+    strings.clear();
+    for (int& id : data_) id = final_ids[id];
+    return Column::FromEncoded(
+        name, DataType::STRING, std::move(data_),
+        absl::make_unique<StringDictionary>(sorted_strings));
+  }
+
+ private:
+  // Returns the provisional ID of `value` (assigns the next one to new
+  // values).
+  int GetId(const std::string& value) {
+    return ids_.try_emplace(value, ids_.size()).first->second;
+  }
+
+  // Converts the values added so far to provisional string IDs.
+  void ConvertToString() {
+    is_int_ = false;
+    // Provisional IDs of the non-canonical values stay the same.
+    absl::flat_hash_map<int, int> int_ids;
+    for (int& value : data_) {
+      if (value < 0) {
+        value = -1 - value;
+      } else {
+        const auto [it, inserted] = int_ids.try_emplace(value, 0);
+        if (inserted) it->second = GetId(std::to_string(value));
+        value = it->second;
+      }
+    }
+  }
+
+  bool is_int_ = true;
+  // Provisional IDs of distinct strings (only of the non-canonical values
+  // while `is_int_` is set).
+  absl::flat_hash_map<std::string, int> ids_;
+  std::vector<int> data_;
+};
+
+// Binary table format (native byte order). Every section starts at an offset
+// that is a multiple of `kBinaryTableAlignment`, so the column data can be used
+// in place once the file is mapped:
+//
+//   magic                  `kBinaryTableMagic`
+//   uint64 source length   followed by the source (see Table::LoadOrCreate)
+//   uint64 name length     followed by the table name
+//   uint64 num_columns
+//   uint64 num_rows
+//   for each column:
+//     uint64 name length   followed by the column name
+//     uint64 data type
+//     uint64 dictionary size in bytes (0 for INT columns)
+//     int32  data[num_rows]
+//     dictionary           (see StringDictionary::Encode())
+constexpr absl::string_view kBinaryTableMagic = "CITABLE2";
+constexpr size_t kBinaryTableAlignment = 8;
+
+class BinaryTableWriter {
+ public:
+  explicit BinaryTableWriter(const std::string& file_path)
+      : file_path_(file_path), out_(file_path, std::ios::binary) {
+    if (!out_) {
+      std::cerr << "Can't open " << file_path << " for writing." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  void PutUint64(uint64_t value) {
+    PutBytes(absl::string_view(reinterpret_cast<const char*>(&value),
+                               sizeof(value)));
+  }
+
+  // Writes `bytes` and pads them to the alignment.
+  void PutBytes(absl::string_view bytes) {
+    out_.write(bytes.data(), bytes.size());
+    pos_ += bytes.size();
+    static constexpr char kPadding[kBinaryTableAlignment] = {};
+    const size_t padding =
+        (kBinaryTableAlignment - pos_ % kBinaryTableAlignment) %
+        kBinaryTableAlignment;
+    out_.write(kPadding, padding);
+    pos_ += padding;
+  }
+
+  void PutString(absl::string_view str) {
+    PutUint64(str.size());
+    PutBytes(str);
+  }
+
+  void Close() {
+    out_.close();
+    if (!out_) {
+      std::cerr << "Error writing " << file_path_ << "." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+ private:
+  const std::string file_path_;
+  std::ofstream out_;
+  size_t pos_ = 0;
+};
+
+// A read-only, memory-mapped file.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& file_path) {
+    const int fd = open(file_path.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+      std::cerr << "Can't open " << file_path << "." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    size_ = file_stat.st_size;
+    if (size_ > 0) {
+      addr_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr_ == MAP_FAILED) {
+        std::cerr << "Can't map " << file_path << ": " << std::strerror(errno)
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    close(fd);
+  }
+
+  ~MappedFile() {
+    if (addr_ != nullptr) munmap(addr_, size_);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  absl::string_view data() const {
+    return absl::string_view(static_cast<const char*>(addr_), size_);
+  }
+
+ private:
+  void* addr_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Reads the sections written by BinaryTableWriter, validating that they are
+// within the bounds of the file.
+class BinaryTableReader {
+ public:
+  BinaryTableReader(const std::string& file_path, absl::string_view data)
+      : file_path_(file_path), data_(data) {}
+
+  uint64_t GetUint64() {
+    uint64_t value;
+    std::memcpy(&value, GetBytes(sizeof(value)).data(), sizeof(value));
+    return value;
+  }
+
+  absl::string_view GetBytes(size_t length) {
+    if (length > data_.size() - pos_) {
+      std::cerr << "Corrupt table file " << file_path_ << "." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    const absl::string_view bytes = data_.substr(pos_, length);
+    pos_ += length;
+    pos_ = std::min(data_.size(), (pos_ + kBinaryTableAlignment - 1) /
+                                      kBinaryTableAlignment *
+                                      kBinaryTableAlignment);
+    return bytes;
+  }
+
+  absl::string_view GetString() { return GetBytes(GetUint64()); }
+
+ private:
+  const std::string file_path_;
+  const absl::string_view data_;
+  size_t pos_ = 0;
+};
+
+// Returns true and sets `source` if `file_path` is a table file (in the
+// current format).
+bool ReadBinaryTableSource(const std::string& file_path, std::string* source) {
+  const MappedFile file(file_path);
+  if (!absl::StartsWith(file.data(), kBinaryTableMagic)) return false;
+  BinaryTableReader reader(file_path, file.data());
+  reader.GetBytes(kBinaryTableMagic.size());
+  *source = std::string(reader.GetString());
+  return true;
+}
+
+// Returns a description of the inputs of Table::LoadOrCreate(..). Includes the
+// size and modification time of the CSV file to detect changes to it.
+std::string TableSource(const std::string& input_csv_path,
+                        const std::vector<std::string>& columns,
+                        size_t generate_num_values, size_t num_unique_values) {
+  if (input_csv_path.empty() || columns.empty()) {
+    return absl::StrCat("generated,", generate_num_values, ",",
+                        num_unique_values);
+  }
+  struct stat file_stat = {};
+  stat(input_csv_path.c_str(), &file_stat);
+  return absl::StrCat("csv,", input_csv_path, ",", file_stat.st_size, ",",
+                      file_stat.st_mtime, ",", absl::StrJoin(columns, ";"));
+}
+
+}  // namespace
+
+void Table::ToBinaryFile(const std::string& file_path,
+                         absl::string_view source) const {
+  const size_t num_rows = columns_.empty() ? 0 : columns_[0]->num_rows();
+  BinaryTableWriter writer(file_path);
+  writer.PutBytes(kBinaryTableMagic);
+  writer.PutString(source);
+  writer.PutString(name_);
+  writer.PutUint64(columns_.size());
+  writer.PutUint64(num_rows);
+  for (const ColumnPtr& column : columns_) {
+    writer.PutString(column->name());
+    writer.PutUint64(static_cast<uint64_t>(column->type()));
+    const absl::string_view dictionary = column->encoded_dictionary();
+    writer.PutUint64(dictionary.size());
+    const absl::Span<const int> data = column->data();
+    writer.PutBytes(absl::string_view(reinterpret_cast<const char*>(data.data()),
+                                      data.size() * sizeof(int)));
+    writer.PutBytes(dictionary);
+  }
+  writer.Close();
+}
+
+std::unique_ptr<Table> Table::FromBinaryFile(const std::string& file_path,
+                                             std::string* source) {
+  const auto file = std::make_shared<const MappedFile>(file_path);
+  BinaryTableReader reader(file_path, file->data());
+  if (!absl::StartsWith(file->data(), kBinaryTableMagic)) {
+    std::cerr << file_path << " is not a table file." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  reader.GetBytes(kBinaryTableMagic.size());
+  const absl::string_view stored_source = reader.GetString();
+  if (source != nullptr) *source = std::string(stored_source);
+  const std::string name(reader.GetString());
+  const size_t num_columns = reader.GetUint64();
+  const size_t num_rows = reader.GetUint64();
+
+  std::vector<ColumnPtr> columns;
+  columns.reserve(num_columns);
+  for (size_t i = 0; i < num_columns; ++i) {
+    const std::string column_name(reader.GetString());
+    const auto type = static_cast<DataType>(reader.GetUint64());
+    const size_t dictionary_size = reader.GetUint64();
+    const absl::string_view data = reader.GetBytes(num_rows * sizeof(int));
+    std::unique_ptr<StringDictionary> dictionary;
+    if (type == DataType::STRING) {
+      dictionary =
+          StringDictionary::FromEncoded(reader.GetBytes(dictionary_size));
+    } else if (type != DataType::INT || dictionary_size != 0) {
+      std::cerr << "Corrupt table file " << file_path << "." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    columns.push_back(Column::FromEncodedView(
+        column_name, type,
+        absl::MakeConstSpan(reinterpret_cast<const int*>(data.data()),
+                            num_rows),
+        std::move(dictionary), file));
+  }
+  return std::unique_ptr<Table>(new Table(name, std::move(columns)));
+}
+
+std::unique_ptr<Table> Table::LoadOrCreate(
+    const std::string& table_cache_path, const std::string& input_csv_path,
+    const std::vector<std::string>& columns, size_t generate_num_values,
+    size_t num_unique_values) {
+  const std::string source = TableSource(input_csv_path, columns,
+                                         generate_num_values,
+                                         num_unique_values);
+  if (!table_cache_path.empty() && std::ifstream(table_cache_path).good()) {
+    std::string cached_source;
+    if (ReadBinaryTableSource(table_cache_path, &cached_source) &&
+        cached_source == source) {
+      std::cout << "Loading data from table cache " << table_cache_path
+                << "..." << std::endl;
+      return FromBinaryFile(table_cache_path);
+    }
+    std::cout << "Table cache " << table_cache_path
+              << " was written for other inputs, ignoring it." << std::endl;
+  }
+
+  std::unique_ptr<Table> table;
+  if (input_csv_path.empty() || columns.empty()) {
+    std::cerr
+        << "[WARNING] --input_csv_path or --columns_to_test not specified, "
+           "generating synthetic data."
+        << std::endl;
+    std::cout << "Generating " << generate_num_values << " values ("
+              << static_cast<double>(num_unique_values) / generate_num_values *
+                     100
+              << "% unique)..." << std::endl;
+    table = GenerateUniformData(generate_num_values, num_unique_values);
+  } else {
+    std::cout << "Loading data from file " << input_csv_path << "..."
+              << std::endl;
+    table = FromCsv(input_csv_path, columns);
+  }
+  if (!table_cache_path.empty()) {
+    std::cout << "Writing table cache " << table_cache_path << "..."
+              << std::endl;
+    table->ToBinaryFile(table_cache_path, source);
+  }
+  return table;
+}
+
+std::unique_ptr<Table> Table::FromCsv(
+    const std::string& file_path, const std::vector<std::string>& column_names,
+    size_t num_threads, size_t chunk_num_rows) {
+  csv::CSVReader reader(file_path);
+
+  // Make sure all the requested columns are present and map positions in
+  // `column_names` to column positions in the data.
+  const std::vector<std::string> present_column_names = reader.get_col_names();
+  std::vector<size_t> csv_indexes;
+  csv_indexes.reserve(column_names.size());
+  for (const std::string& column_name : column_names) {
+    auto pos = std::find(present_column_names.begin(),
+                         present_column_names.end(), column_name);
+
+    if (pos == present_column_names.end()) {
+      std::cerr << "Unknown column '" << column_name
+                << "'. Available columns: "
+                << absl::StrJoin(present_column_names, ",") << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    csv_indexes.push_back(std::distance(present_column_names.begin(), pos));
+  }
+
+  // While the worker threads encode `chunk`, the next chunk is parsed into
+  // `next_chunk`. Each worker encodes a fixed subset of the columns.
+  const size_t num_columns = column_names.size();
+  num_threads = std::max<size_t>(std::min(num_threads, num_columns), 1);
+  std::vector<CsvColumnEncoder> encoders(num_columns);
+  std::vector<std::vector<std::string>> chunk(num_columns);
+  std::vector<std::vector<std::string>> next_chunk(num_columns);
+  std::vector<std::thread> workers;
+  const auto join_workers = [&workers]() {
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+  };
+  const auto encode_next_chunk = [&]() {
+    join_workers();
+    chunk.swap(next_chunk);
+    for (std::vector<std::string>& values : next_chunk) values.clear();
+    for (size_t t = 0; t < num_threads; ++t) {
+      workers.emplace_back([&, t]() {
+        for (size_t i = t; i < num_columns; i += num_threads)
+          encoders[i].Add(chunk[i]);
+      });
+    }
+  };
+
+  for (csv::CSVRow& row : reader) {
+    for (size_t i = 0; i < num_columns; ++i)
+      next_chunk[i].push_back(row[csv_indexes[i]].get<std::string>());
+    if (num_columns > 0 && next_chunk[0].size() == chunk_num_rows)
+      encode_next_chunk();
+  }
+  encode_next_chunk();
+  join_workers();
+
+  // Create columns.
+  std::vector<std::unique_ptr<Column>> columns;
+  columns.reserve(num_columns);
+  for (size_t i = 0; i < num_columns; ++i)
+    columns.push_back(encoders[i].Finish(column_names[i]));
+
+  return std::unique_ptr<Table>(new Table("test_table", std::move(columns)));
+}
+
 std::unique_ptr<Table> GenerateUniformData(const size_t generate_num_values,
                                            const size_t num_unique_values) {
   std::mt19937 gen(42);
@@ -28,18 +28,21 @@
 #include <memory>
 #include <numeric>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
-#include "boost/math/tools/univariate_statistics.hpp"
+#include "absl/types/span.h"
 #include "common/byte_coding.h"
+#include "common/string_dictionary.h"
 #include "evaluation_utils.h"
-#include "single_include/csv.hpp"
 
 namespace ci {
 
@@ -69,16 +72,50 @@ class Column {
   static constexpr const char* kStringNullSentinel = "NULL";
 
   static ColumnPtr IntColumn(const std::string& name, std::vector<int> data) {
-    return ColumnPtr(new Column(name, DataType::INT, std::move(data)));
+    return ColumnPtr(new Column(name, DataType::INT, std::move(data),
+                                /*dictionary=*/nullptr));
   }
 
+  // Creates a column from already dict-encoded `data`. For STRING columns,
+  // `dictionary` holds all strings but NULL, each encoded as its ID - 1 (NULL
+  // is encoded as `kIntNullSentinel`).
+  static ColumnPtr FromEncoded(const std::string& name, const DataType type,
+                               std::vector<int> data,
+                               std::unique_ptr<StringDictionary> dictionary) {
+    assert((type == DataType::STRING) == (dictionary != nullptr));
+    return ColumnPtr(
+        new Column(name, type, std::move(data), std::move(dictionary)));
+  }
+
+  // Same as above, but doesn't copy `data` and `dictionary` (which has to be
+  // created with StringDictionary::FromEncoded(..)). Instead, the column holds
+  // on to `backing`, which has to keep their memory (e.g., a memory-mapped
+  // file) alive.
+  static ColumnPtr FromEncodedView(const std::string& name,
+                                   const DataType type,
+                                   absl::Span<const int> data,
+                                   std::unique_ptr<StringDictionary> dictionary,
+                                   std::shared_ptr<const void> backing) {
+    assert((type == DataType::STRING) == (dictionary != nullptr));
+    ColumnPtr column(
+        new Column(name, type, /*data=*/{}, std::move(dictionary)));
+    column->data_ = data;
+    column->backing_ = std::move(backing);
+    return column;
+  }
+
+  // Creates a column from the given (unencoded) strings. The strings are only
+  // retained (e.g., to measure their compressed size without decoding them) if
+  // `keep_raw_strings` is set.
   Column(const std::string& name, const DataType type,
-         const std::vector<std::string>& str_data)
-      : name_(name), type_(type), str_data_(str_data) {
+         const std::vector<std::string>& str_data,
+         bool keep_raw_strings = false)
+      : name_(name), type_(type) {
     if (type == DataType::INT) {
       // Convert string to int.
-      data_.reserve(str_data.size());
-      for (const std::string& str : str_data) data_.push_back(std::stoi(str));
+      owned_data_.reserve(str_data.size());
+      for (const std::string& str : str_data)
+        owned_data_.push_back(std::stoi(str));
     } else if (type == DataType::STRING) {
       // Dict-encode strings. Essentially, encode strings as dense integers in
       // an order-preserving way. Also called order-preserving minimal perfect
@@ -94,62 +131,57 @@ class Column {
       //
       // We make sure that NULL values get an ID of 0 – that way we can detect
       // and ignore them when building some data structures, e.g. ZoneMaps.
-      data_.reserve(str_data.size());
-      absl::flat_hash_set<std::string> distinct_strings(str_data.begin(),
-                                                        str_data.end());
+      // All other strings get their rank in the front-coded `dictionary_`
+      // plus 1 as ID.
+      owned_data_.reserve(str_data.size());
+      absl::flat_hash_set<absl::string_view> distinct_strings(
+          str_data.begin(), str_data.end());
       distinct_strings.erase(kStringNullSentinel);
       std::vector<std::string> distinct_strings_v(distinct_strings.begin(),
                                                   distinct_strings.end());
+      // Sorted and distinct, so the dictionary won't sort them again.
       std::sort(distinct_strings_v.begin(), distinct_strings_v.end());
-      distinct_strings_v.insert(distinct_strings_v.begin(),
-                                kStringNullSentinel);
-      int i = 0;
-      for (const std::string& str : distinct_strings_v) {
-        string_dict_[str] = i++;
-      }
+      // Only used for encoding the rows (faster than binary searching the
+      // dictionary for every row).
+      absl::flat_hash_map<absl::string_view, int> string_ids;
+      string_ids.reserve(distinct_strings_v.size() + 1);
+      string_ids[kStringNullSentinel] = 0;
+      for (size_t i = 0; i < distinct_strings_v.size(); ++i)
+        string_ids[distinct_strings_v[i]] = i + 1;
       // Convert strings to ints using the mapping.
       for (const std::string& str : str_data) {
-        auto it = string_dict_.find(str);
-        if (it == string_dict_.end()) {
+        auto it = string_ids.find(str);
+        if (it == string_ids.end()) {
           std::cerr << "Error during dict encoding." << std::endl;
           exit(EXIT_FAILURE);
         }
-        data_.push_back(it->second);
+        owned_data_.push_back(it->second);
       }
+      dictionary_ = absl::make_unique<StringDictionary>(distinct_strings_v);
     } else {
       std::cerr << "Unsupported data type." << std::endl;
       exit(EXIT_FAILURE);
     }
-
-    // Initialize `distinct_values_`.
-    distinct_values_ = std::unordered_set<int>(data_.begin(), data_.end());
-
-    // Set `min_` and `max_`.
-    const auto min_max = std::minmax_element(begin(data_), end(data_));
-    min_ = *min_max.first;
-    max_ = *min_max.second;
-
-    // Compute standard moments.
-    mean_ = boost::math::tools::mean(data_);
-    variance_ = boost::math::tools::variance(data_);
-    skewness_ = boost::math::tools::skewness(data_);
-    kurtosis_ = boost::math::tools::kurtosis(data_);
-
-    PrintStats();
+    data_ = owned_data_;
+    if (keep_raw_strings) str_data_ = str_data;
   }
 
+  // Computes the stats on first use.
   void PrintStats() const {
+    const Stats& stats = GetStats();
     std::cout << "column: " << name_ << " (" << DataTypeName(type_)
-              << "), min: " << min_ << ", max: " << max_
+              << "), min: " << stats.min << ", max: " << stats.max
               << ", #rows: " << num_rows()
               << ", cardinality: " << num_distinct_values()
-              << ", mean: " << mean_ << ", variance: " << variance_
-              << ", skewness: " << skewness_ << ", kurtosis: " << kurtosis_
-              << std::endl;
+              << ", mean: " << stats.mean << ", variance: " << stats.variance
+              << ", skewness: " << stats.skewness
+              << ", kurtosis: " << stats.kurtosis << std::endl;
   }
 
   bool Contains(int value) const {
-    return distinct_values_.find(value) != distinct_values_.end();
+    const std::vector<int>& distinct_values = GetDistinctValues();
+    return std::binary_search(distinct_values.begin(), distinct_values.end(),
+                              value);
   }
 
   bool StripeContains(std::size_t num_rows_per_stripe, std::size_t stripe_id,
@@ -177,33 +209,82 @@ class Column {
     for (size_t i = 0; i < data_.size(); ++i) {
       new_data[i] = data_[indexes[i]];
     }
-    data_.swap(new_data);
+    // Note that this also copies (mapped) data the column doesn't own.
+    owned_data_.swap(new_data);
+    data_ = owned_data_;
+    // The distinct values and stats don't depend on the order of the rows.
+    if (str_data_.empty()) return;
+    std::vector<std::string> new_str_data(str_data_.size());
+    for (size_t i = 0; i < str_data_.size(); ++i) {
+      new_str_data[i] = std::move(str_data_[indexes[i]]);
+    }
+    str_data_.swap(new_str_data);
   }
 
   std::string name() const { return name_; }
   DataType type() const { return type_; }
-  const std::vector<int>& data() const { return data_; }
+  absl::Span<const int> data() const { return data_; }
   int operator[](std::size_t idx) const { return data_[idx]; }
 
   // Returns the original value (not an encoded ID) at the given position.
   std::string ValueAt(std::size_t idx) const {
     // For INT column just return the value.
-    if (string_dict_.empty()) return absl::StrCat(data_[idx]);
+    if (dictionary_ == nullptr) return absl::StrCat(data_[idx]);
 
-    // For STRING column reverse the mapping.
-    return std::find_if(
-               string_dict_.begin(), string_dict_.end(),
-               [this, idx](const auto& kv) { return kv.second == data_[idx]; })
-        ->first;
+    // For STRING column decode the ID.
+    return DecodeString(data_[idx]);
   }
 
-  std::vector<int> distinct_values() const {
-    return std::vector<int>(distinct_values_.begin(), distinct_values_.end());
+  // Returns the string with the given dict-encoded `id` (STRING columns only).
+  std::string DecodeString(int id) const {
+    assert(dictionary_ != nullptr);
+    if (id == kIntNullSentinel) return kStringNullSentinel;
+    return dictionary_->GetString(id - 1);
+  }
+
+  // Returns true and sets `id` to the dict-encoded ID of `str` if it is in the
+  // column (STRING columns only).
+  bool EncodeString(absl::string_view str, int* id) const {
+    assert(dictionary_ != nullptr);
+    if (str == kStringNullSentinel) {
+      *id = kIntNullSentinel;
+      return true;
+    }
+    size_t rank;
+    if (!dictionary_->GetId(str, &rank)) return false;
+    *id = rank + 1;
+    return true;
+  }
+
+  // Returns the dict-encoded strings indexed by their IDs (empty for INT
+  // columns).
+  std::vector<std::string> dictionary() const {
+    if (dictionary_ == nullptr) return {};
+    std::vector<std::string> strings;
+    strings.reserve(dictionary_->size() + 1);
+    for (size_t id = 0; id <= dictionary_->size(); ++id)
+      strings.push_back(DecodeString(id));
+    return strings;
+  }
+
+  // Returns the distinct values in ascending order.
+  std::vector<int> distinct_values() const { return GetDistinctValues(); }
+  // Returns the encoded dictionary (see StringDictionary::Encode(); empty for
+  // INT columns).
+  absl::string_view encoded_dictionary() const {
+    if (dictionary_ == nullptr) return absl::string_view();
+    return dictionary_->Encode();
   }
   std::size_t num_rows() const { return data_.size(); }
-  std::size_t num_distinct_values() const { return distinct_values_.size(); }
-  int min() const { return min_; }
-  int max() const { return max_; }
+  std::size_t num_distinct_values() const {
+    return GetDistinctValues().size();
+  }
+  int min() const { return GetStats().min; }
+  int max() const { return GetStats().max; }
+  double mean() const { return GetStats().mean; }
+  double variance() const { return GetStats().variance; }
+  double skewness() const { return GetStats().skewness; }
+  double kurtosis() const { return GetStats().kurtosis; }
   std::size_t compressed_size_bytes(size_t num_rows_per_stripe) const {
     const size_t num_stripes = data_.size() / num_rows_per_stripe;
     size_t compressed_size = 0;
@@ -217,12 +298,18 @@ class Column {
                               sizeof(data_[0]) * num_rows_per_stripe);
         compressed_size += ci::Compress(data_view).size();
       } else {
-        assert(start_row + num_rows_per_stripe <= str_data_.size());
         // Encode the var-length strings, each as var-int32 length followed by
-        // the actual string-data.
+        // the actual string-data. Decode the strings if the original ones
+        // weren't retained.
         ByteBuffer buffer;
-        for (size_t i = 0; i < num_rows_per_stripe; ++i)
-          PutString(str_data_[start_row + i], &buffer);
+        for (size_t i = 0; i < num_rows_per_stripe; ++i) {
+          if (str_data_.empty()) {
+            PutString(DecodeString(data_[start_row + i]), &buffer);
+          } else {
+            assert(start_row + num_rows_per_stripe <= str_data_.size());
+            PutString(str_data_[start_row + i], &buffer);
+          }
+        }
         compressed_size +=
             ci::Compress(absl::string_view(buffer.data(), buffer.pos())).size();
       }
@@ -231,126 +318,134 @@ class Column {
   }
 
  private:
-  Column(const std::string& name, const DataType type, std::vector<int> data)
-      : name_(name), type_(type), data_(std::move(data)) {
+  Column(const std::string& name, const DataType type, std::vector<int> data,
+         std::unique_ptr<StringDictionary> dictionary)
+      : name_(name),
+        type_(type),
+        owned_data_(std::move(data)),
+        data_(owned_data_),
+        dictionary_(std::move(dictionary)) {
     assert(type <= DataType::INT);
-    // Initialize `distinct_values_`.
-    distinct_values_ = std::unordered_set<int>(data_.begin(), data_.end());
-
-    // Set `min_` and `max_`.
-    const auto min_max = std::minmax_element(begin(data_), end(data_));
-    min_ = *min_max.first;
-    max_ = *min_max.second;
+  }
 
-    // Compute standard moments.
-    mean_ = boost::math::tools::mean(data_);
-    variance_ = boost::math::tools::variance(data_);
-    skewness_ = boost::math::tools::skewness(data_);
-    kurtosis_ = boost::math::tools::kurtosis(data_);
+  struct Stats {
+    int min = 0;
+    int max = 0;
+    // Standard moments: mean, (population) variance, skewness, and kurtosis.
+    // https://www.gnu.org/software/gsl/doc/html/statistics.html
+    double mean = 0.0;
+    double variance = 0.0;
+    double skewness = 0.0;
+    double kurtosis = 0.0;
+  };
+
+  // Sorts and dedups the values on first use. Thread-safe.
+  const std::vector<int>& GetDistinctValues() const {
+    absl::call_once(distinct_values_once_, [this] {
+      distinct_values_.assign(data_.begin(), data_.end());
+      std::sort(distinct_values_.begin(), distinct_values_.end());
+      distinct_values_.erase(
+          std::unique(distinct_values_.begin(), distinct_values_.end()),
+          distinct_values_.end());
+      distinct_values_.shrink_to_fit();
+    });
+    return distinct_values_;
+  }
 
-    PrintStats();
+  // Computes all stats in a single pass over the data on first use, updating
+  // the central moments online (Terriberry's extension of Welford's algorithm,
+  // see https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance).
+  // Thread-safe.
+  const Stats& GetStats() const {
+    absl::call_once(stats_once_, [this] {
+      if (data_.empty()) return;
+      int min = data_[0];
+      int max = data_[0];
+      double mean = 0.0, m2 = 0.0, m3 = 0.0, m4 = 0.0;
+      double n = 0.0;
+      for (const int value : data_) {
+        min = std::min(min, value);
+        max = std::max(max, value);
+        const double n1 = n;
+        n += 1.0;
+        const double delta = value - mean;
+        const double delta_n = delta / n;
+        const double delta_n2 = delta_n * delta_n;
+        const double term1 = delta * delta_n * n1;
+        mean += delta_n;
+        m4 += term1 * delta_n2 * (n * n - 3 * n + 3) + 6 * delta_n2 * m2 -
+              4 * delta_n * m3;
+        m3 += term1 * delta_n * (n - 2) - 3 * delta_n * m2;
+        m2 += term1;
+      }
+      stats_.min = min;
+      stats_.max = max;
+      stats_.mean = mean;
+      stats_.variance = m2 / n;
+      stats_.skewness = std::sqrt(n) * m3 / std::pow(m2, 1.5);
+      stats_.kurtosis = n * m4 / (m2 * m2);
+    });
+    return stats_;
   }
 
   std::string name_;
   DataType type_;
-  std::vector<int> data_;
-  std::unordered_set<int> distinct_values_;
-  // Used to map strings to ints in an order-preserving way.
-  std::unordered_map<std::string, int> string_dict_;
-  // The original vector of strings if given to the c'tor.
-  const std::vector<std::string> str_data_;
-
-  // Stats.
-  int min_, max_;
-  // Standard moments: mean, variance, skewness, and excess kurtosis.
-  // https://www.gnu.org/software/gsl/doc/html/statistics.html
-  double mean_, variance_, skewness_, kurtosis_;
-};
-
-// Used for parsing a column from a CSV file.
-struct CsvColumnInfo {
-  CsvColumnInfo(const std::string& name, const DataType type,
-                const std::size_t index)
-      : name(name), type(type), index(index) {}
-
-  std::string name;
-  DataType type;
-  // Index (offset) in CSV.
-  std::size_t index;
+  // Only set if the column owns its data.
+  std::vector<int> owned_data_;
+  absl::Span<const int> data_;
+  // Keeps the memory of `data_` and `dictionary_` alive if not owned.
+  std::shared_ptr<const void> backing_;
+  // Used to map strings to ints in an order-preserving way (not set for INT
+  // columns).
+  std::unique_ptr<StringDictionary> dictionary_;
+  // The original vector of strings if requested in the c'tor.
+  std::vector<std::string> str_data_;
+
+  // Lazily computed (see GetDistinctValues() and GetStats()).
+  mutable absl::once_flag distinct_values_once_;
+  mutable std::vector<int> distinct_values_;
+  mutable absl::once_flag stats_once_;
+  mutable Stats stats_;
 };
 
 class Table {
  public:
+  // Number of rows parsed from the CSV file before they are encoded.
+  static constexpr size_t kCsvChunkNumRows = 64 * 1024;
+
+  // Reads the given columns from the CSV file at `file_path`. The rows are
+  // parsed in chunks of `chunk_num_rows` rows, which `num_threads` threads
+  // encode column by column (while the next chunk is parsed). Parsing itself
+  // is sequential. Columns with only digit-strings that fit into an int (or
+  // NULLs) become INT columns, all others (including columns with empty
+  // values) STRING columns.
   static std::unique_ptr<Table> FromCsv(
       const std::string& file_path,
-      const std::vector<std::string> column_names) {
-    csv::CSVReader reader(file_path);
-
-    // Make sure all the requested columns are present and map positions in
-    // `column_names` to column positions in the data.
-    std::vector<std::string> present_column_names = reader.get_col_names();
-    std::vector<CsvColumnInfo> column_infos;
-    column_infos.reserve(column_names.size());
-    for (const std::string& column_name : column_names) {
-      auto pos = std::find(present_column_names.begin(),
-                           present_column_names.end(), column_name);
-
-      if (pos == present_column_names.end()) {
-        std::cerr << "Unknown column '" << column_name
-                  << "'. Available columns: "
-                  << absl::StrJoin(present_column_names, ",") << std::endl;
-        std::exit(EXIT_FAILURE);
-      }
-
-      // Create ColumnInfo`
-      column_infos.push_back(
-          CsvColumnInfo{.name = column_name,
-                        .type = DataType::STRING,
-                        .index = static_cast<size_t>(
-                            std::distance(present_column_names.begin(), pos))});
-    }
-
-    std::vector<std::vector<std::string>> csv_data(column_names.size());
-    for (csv::CSVRow& row : reader) {
-      for (size_t i = 0; i < column_names.size(); ++i) {
-        csv_data[i].push_back(row[column_infos[i].index].get<std::string>());
-      }
-    }
-
-    for (size_t i = 0; i < csv_data.size(); ++i) {
-      bool is_column_int = true;
-      for (const std::string& value : csv_data[i]) {
-        if (value != Column::kStringNullSentinel &&
-            !std::all_of(value.begin(), value.end(),
-                         [](unsigned char c) { return std::isdigit(c); })) {
-          is_column_int = false;
-          break;
-        }
-      }
-
-      if (is_column_int) {
-        // If the column is an integer column, change its type to
-        // DataType::INT and convert all sentinel values.
-        column_infos[i].type = DataType::INT;
-        for (std::string& value : csv_data[i]) {
-          if (value == Column::kStringNullSentinel) {
-            value = absl::StrCat(Column::kIntNullSentinel);
-          }
-        }
-      }
-    }
-
-    // Create columns.
-    std::vector<std::unique_ptr<Column>> columns;
-    columns.reserve(column_infos.size());
-    for (size_t i = 0; i < column_infos.size(); ++i) {
-      const CsvColumnInfo& info = column_infos[i];
-      columns.push_back(
-          absl::make_unique<Column>(info.name, info.type, csv_data[i]));
-    }
-
-    return std::unique_ptr<Table>(new Table("test_table", std::move(columns)));
-  }
+      const std::vector<std::string>& column_names,
+      size_t num_threads = std::thread::hardware_concurrency(),
+      size_t chunk_num_rows = kCsvChunkNumRows);
+
+  // Writes the table to `file_path` in a binary, columnar format (see data.cc)
+  // that holds the encoded column data and dictionaries. `source` describes
+  // the inputs the table was created from and is stored in the header.
+  void ToBinaryFile(const std::string& file_path,
+                    absl::string_view source = "") const;
+
+  // Loads a table written by ToBinaryFile(..) without parsing or re-encoding
+  // it: the file is memory-mapped and the columns use the mapped data and
+  // dictionaries in place. Sets `source` (if given) to the stored source.
+  static std::unique_ptr<Table> FromBinaryFile(const std::string& file_path,
+                                               std::string* source = nullptr);
+
+  // Reads the given `columns` of the CSV file at `input_csv_path` or, if
+  // either is empty, generates a table (see GenerateUniformData(..)). If
+  // `table_cache_path` is set, the table is loaded from that file instead,
+  // provided it was written for the same inputs (CSV file, columns or
+  // generation parameters). Otherwise, the table is (re-)written to it.
+  static std::unique_ptr<Table> LoadOrCreate(
+      const std::string& table_cache_path, const std::string& input_csv_path,
+      const std::vector<std::string>& columns, size_t generate_num_values,
+      size_t num_unique_values);
 
   static std::unique_ptr<Table> Create(
       const std::string& name, std::vector<std::unique_ptr<Column>> columns) {
@@ -18,6 +18,10 @@
 
 #include "data.h"
 
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -62,6 +66,117 @@ TEST(ColumnTest, ValueAtReturnsValuesForStringColumns) {
   EXPECT_THAT(actual_values, ElementsAreArray(expected_values));
 }
 
+TEST(ColumnTest, EncodesStringsOrderPreserving) {
+  const Column column("column_name", DataType::STRING,
+                      std::vector<std::string>{"US", "NULL", "CH", "DE"});
+  // NULL is encoded as 0, all other strings in sorted order.
+  EXPECT_THAT(column.data(), ElementsAreArray({3, 0, 1, 2}));
+  int id;
+  ASSERT_TRUE(column.EncodeString("DE", &id));
+  EXPECT_EQ(id, 2);
+  ASSERT_TRUE(column.EncodeString("NULL", &id));
+  EXPECT_EQ(id, Column::kIntNullSentinel);
+  EXPECT_FALSE(column.EncodeString("FR", &id));
+  EXPECT_EQ(column.DecodeString(3), "US");
+  EXPECT_THAT(column.dictionary(),
+              ElementsAreArray({"NULL", "CH", "DE", "US"}));
+}
+
+TEST(TableTest, FromCsv) {
+  const std::string file_path = testing::TempDir() + "/from_csv_test.csv";
+  std::ofstream file(file_path);
+  file << "id,country,ignored,year\n"
+          "1,US,x,2020\n"
+          "2,NULL,x,NULL\n"
+          "3,CH,x,-1\n"
+          "4,DE,x,2019\n"
+          "5,US,x,2020\n";
+  file.close();
+
+  for (const size_t num_threads : {1, 2, 4}) {
+    for (const size_t chunk_num_rows : {1, 2, 1000}) {
+      const std::unique_ptr<Table> table =
+          Table::FromCsv(file_path, {"country", "id", "year"}, num_threads,
+                         chunk_num_rows);
+      const std::vector<std::unique_ptr<Column>>& columns =
+          table->GetColumns();
+      ASSERT_EQ(columns.size(), 3);
+      EXPECT_EQ(columns[0]->type(), DataType::STRING);
+      EXPECT_THAT(columns[0]->data(), ElementsAreArray({3, 0, 1, 2, 3}));
+      EXPECT_EQ(columns[1]->type(), DataType::INT);
+      EXPECT_THAT(columns[1]->data(), ElementsAreArray({1, 2, 3, 4, 5}));
+      // Negative numbers aren't detected as ints.
+      EXPECT_EQ(columns[2]->type(), DataType::STRING);
+      EXPECT_EQ(table->ToCsvString(),
+                "US,1,2020\nNULL,2,NULL\nCH,3,-1\nDE,4,2019\nUS,5,2020\n");
+    }
+  }
+}
+
+TEST(TableTest, FromCsvDetectsIntColumns) {
+  const std::string file_path =
+      testing::TempDir() + "/from_csv_int_columns_test.csv";
+  std::ofstream file(file_path);
+  file << "a,b,c,d\n"
+          "7,007,1,99999999999\n"
+          "007,7,,1\n"
+          "NULL,x,2,2\n";
+  file.close();
+
+  for (const size_t chunk_num_rows : {1, 2, 1000}) {
+    const std::unique_ptr<Table> table = Table::FromCsv(
+        file_path, {"a", "b", "c", "d"}, /*num_threads=*/2, chunk_num_rows);
+    const std::vector<std::unique_ptr<Column>>& columns = table->GetColumns();
+    ASSERT_EQ(columns.size(), 4);
+    // Leading zeros are dropped in INT columns.
+    EXPECT_EQ(columns[0]->type(), DataType::INT);
+    EXPECT_THAT(columns[0]->data(),
+                ElementsAreArray({7, 7, Column::kIntNullSentinel}));
+    // ... but kept if the column turns out to be a STRING column.
+    EXPECT_EQ(columns[1]->type(), DataType::STRING);
+    EXPECT_THAT(columns[1]->dictionary(),
+                ElementsAreArray({"NULL", "007", "7", "x"}));
+    EXPECT_THAT(columns[1]->data(), ElementsAreArray({1, 2, 3}));
+    // Empty values make a STRING column.
+    EXPECT_EQ(columns[2]->type(), DataType::STRING);
+    EXPECT_THAT(columns[2]->dictionary(),
+                ElementsAreArray({"NULL", "", "1", "2"}));
+    EXPECT_THAT(columns[2]->data(), ElementsAreArray({2, 1, 3}));
+    // So do values that don't fit into an int.
+    EXPECT_EQ(columns[3]->type(), DataType::STRING);
+    EXPECT_THAT(columns[3]->data(), ElementsAreArray({3, 1, 2}));
+  }
+}
+
+TEST(TableTest, BinaryFileRoundTrip) {
+  std::vector<ColumnPtr> columns;
+  columns.push_back(absl::make_unique<Column>(
+      "country", DataType::STRING,
+      std::vector<std::string>{"US", "NULL", "CH", "DE", "US"}));
+  columns.push_back(Column::IntColumn("id", {5, 4, 3, 2, 1}));
+  const std::unique_ptr<Table> table =
+      Table::Create("table", std::move(columns));
+  const std::string file_path = testing::TempDir() + "/binary_file_test.bin";
+  table->ToBinaryFile(file_path);
+
+  const std::unique_ptr<Table> loaded_table = Table::FromBinaryFile(file_path);
+  EXPECT_EQ(loaded_table->ToCsvString(), table->ToCsvString());
+  const Column& country = loaded_table->GetColumn("country");
+  EXPECT_EQ(country.type(), DataType::STRING);
+  EXPECT_THAT(country.data(), ElementsAreArray({3, 0, 1, 2, 3}));
+  int id;
+  ASSERT_TRUE(country.EncodeString("DE", &id));
+  EXPECT_EQ(id, 2);
+  const Column& ids = loaded_table->GetColumn("id");
+  EXPECT_EQ(ids.type(), DataType::INT);
+  EXPECT_EQ(ids.num_distinct_values(), 5);
+
+  // Reordering copies the mapped data.
+  loaded_table->SortWithCardinalityKey();
+  EXPECT_THAT(ids.data(), ElementsAreArray({4, 3, 2, 1, 5}));
+  EXPECT_THAT(country.data(), ElementsAreArray({0, 1, 2, 3, 3}));
+}
+
 TEST(ColumnTest, CompressInts) {
   auto column =
       absl::make_unique<Column>("column_name", DataType::INT,
@@ -106,6 +221,82 @@ TEST(ColumnTest, Reorder) {
   }
 }
 
+TEST(ColumnTest, ReorderKeepsRawStringsAligned) {
+  const std::vector<std::string> values = {"DE", "US", "IT", "FR"};
+  Column column("column_name", DataType::STRING, values);
+  Column raw_column("column_name", DataType::STRING, values,
+                    /*keep_raw_strings=*/true);
+
+  const std::vector<size_t> indexes = {2, 1, 3, 0};
+  column.Reorder(indexes);
+  raw_column.Reorder(indexes);
+  for (size_t i = 0; i < raw_column.num_rows(); ++i) {
+    EXPECT_EQ(raw_column.ValueAt(i), values[indexes[i]]);
+  }
+  // The retained strings are compressed instead of the decoded ones.
+  EXPECT_EQ(raw_column.compressed_size_bytes(/*num_rows_per_stripe=*/2),
+            column.compressed_size_bytes(/*num_rows_per_stripe=*/2));
+}
+
+TEST(ColumnTest, DistinctValues) {
+  const ColumnPtr column = Column::IntColumn("column_name", {7, -3, 7, 0, 5});
+
+  EXPECT_THAT(column->distinct_values(), ElementsAreArray({-3, 0, 5, 7}));
+  EXPECT_EQ(column->num_distinct_values(), 4);
+  EXPECT_TRUE(column->Contains(-3));
+  EXPECT_TRUE(column->Contains(7));
+  EXPECT_FALSE(column->Contains(1));
+  EXPECT_FALSE(column->Contains(8));
+}
+
+TEST(ColumnTest, Stats) {
+  const std::vector<int> data = {1, 2, 2, 3, 10, -4};
+  const ColumnPtr column = Column::IntColumn("column_name", data);
+
+  // Compare against the textbook (two-pass) population moments.
+  double mean = 0.0;
+  for (const int value : data) mean += value;
+  mean /= data.size();
+  double m2 = 0.0, m3 = 0.0, m4 = 0.0;
+  for (const int value : data) {
+    const double delta = value - mean;
+    m2 += delta * delta / data.size();
+    m3 += delta * delta * delta / data.size();
+    m4 += delta * delta * delta * delta / data.size();
+  }
+
+  EXPECT_EQ(column->min(), -4);
+  EXPECT_EQ(column->max(), 10);
+  EXPECT_NEAR(column->mean(), mean, 1e-12);
+  EXPECT_NEAR(column->variance(), m2, 1e-12);
+  EXPECT_NEAR(column->skewness(), m3 / std::pow(m2, 1.5), 1e-12);
+  EXPECT_NEAR(column->kurtosis(), m4 / (m2 * m2), 1e-12);
+}
+
+TEST(TableTest, LoadOrCreateInvalidatesCache) {
+  const std::string cache_path = testing::TempDir() + "/table_cache_test.bin";
+  std::remove(cache_path.c_str());
+  const std::unique_ptr<Table> table = Table::LoadOrCreate(
+      cache_path, /*input_csv_path=*/"", /*columns=*/{},
+      /*generate_num_values=*/100, /*num_unique_values=*/10);
+  std::string source;
+  const std::unique_ptr<Table> cached =
+      Table::FromBinaryFile(cache_path, &source);
+  EXPECT_EQ(cached->ToCsvString(), table->ToCsvString());
+
+  // Same inputs: the cache is used as is.
+  EXPECT_EQ(Table::LoadOrCreate(cache_path, "", {}, 100, 10)->ToCsvString(),
+            table->ToCsvString());
+  // Other inputs: the cache is rebuilt.
+  const std::unique_ptr<Table> other_table =
+      Table::LoadOrCreate(cache_path, "", {}, 200, 10);
+  EXPECT_EQ(other_table->GetColumns()[0]->num_rows(), 200);
+  std::string other_source;
+  EXPECT_EQ(Table::FromBinaryFile(cache_path, &other_source)->ToCsvString(),
+            other_table->ToCsvString());
+  EXPECT_NE(other_source, source);
+}
+
 TEST(DataTest, SortWithCardinalityKey) {
   std::vector<std::unique_ptr<Column>> columns;
   columns.push_back(absl::make_unique<Column>(
@@ -17,7 +17,9 @@
 // -----------------------------------------------------------------------------
 
 #include <cstddef>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <ostream>
 #include <random>
 
@@ -27,6 +29,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "common/profiling.h"
 #include "cuckoo_index.h"
 #include "cuckoo_utils.h"
 #include "data.h"
@@ -34,23 +37,38 @@
 #include "evaluation_utils.h"
 #include "evaluator.h"
 #include "index_structure.h"
+#include "inverted_stripe_index.h"
+#include "per_stripe_binary_fuse.h"
 #include "per_stripe_bloom.h"
 #include "per_stripe_xor.h"
+#include "table_flags.h"
 #include "zone_map.h"
+#include "zone_map_cuckoo_index.h"
 
-ABSL_FLAG(int, generate_num_values, 100000,
-          "Number of values to generate (number of rows).");
-ABSL_FLAG(int, num_unique_values, 1000,
-          "Number of unique values to generate (cardinality).");
-ABSL_FLAG(std::string, input_csv_path, "", "Path to the input CSV file.");
 ABSL_FLAG(std::string, output_csv_path, "",
           "Path to write the output CSV file to.");
-ABSL_FLAG(std::vector<std::string>, columns_to_test, {"company_name"},
-          "Comma-separated list of columns to tests, e.g. "
-          "'company_name,country_code'.");
 ABSL_FLAG(std::vector<std::string>, num_rows_per_stripe_to_test, {"10000"},
           "Number of rows per stripe. Defaults to 10,000.");
 ABSL_FLAG(int, num_lookups, 1000, "Number of lookups. Defaults to 1,000.");
+ABSL_FLAG(int, num_threads, 1,
+          "Number of threads to run the experiments on. Defaults to 1.");
+ABSL_FLAG(int, max_num_live_indexes, 0,
+          "If > 0, limits the number of index structures kept in memory at "
+          "once (which is at most --num_threads anyway).");
+ABSL_FLAG(bool, measure_latencies, false,
+          "If set, measures the latency of every lookup and reports latency "
+          "percentiles per test case (implies --measure_throughput). Should "
+          "be used with --num_threads=1.");
+ABSL_FLAG(bool, measure_throughput, false,
+          "If set, repeats the lookups of every test case in a single timed "
+          "loop and reports their throughput. Should be used with "
+          "--num_threads=1.");
+ABSL_FLAG(bool, profile_lookups, false,
+          "If set, also profiles lookups in CuckooIndexes (adds overhead to "
+          "every lookup).");
+ABSL_FLAG(std::string, profile_trace_path, "",
+          "If set, records every profiled scope and writes them to this path "
+          "in the Chrome trace event format.");
 ABSL_FLAG(std::vector<std::string>, test_cases, {"positive_uniform"},
           "Comma-separated list of test cases, e.g. "
           "'positive_uniform,positive_distinct'.");
@@ -74,16 +92,11 @@ static bool IsValidSorting(absl::string_view sorting) {
 int main(int argc, char* argv[]) {
   absl::ParseCommandLine(argc, argv);
 
-  const size_t generate_num_values = absl::GetFlag(FLAGS_generate_num_values);
-  const size_t num_unique_values = absl::GetFlag(FLAGS_num_unique_values);
-  const std::string input_csv_path = absl::GetFlag(FLAGS_input_csv_path);
   const std::string output_csv_path = absl::GetFlag(FLAGS_output_csv_path);
   if (output_csv_path.empty()) {
     std::cerr << "You must specify --output_csv_path" << std::endl;
     std::exit(EXIT_FAILURE);
   }
-  const std::vector<std::string> columns_to_test =
-      absl::GetFlag(FLAGS_columns_to_test);
   std::vector<size_t> num_rows_per_stripe_to_test;
   for (const std::string num_rows :
        absl::GetFlag(FLAGS_num_rows_per_stripe_to_test)) {
@@ -94,22 +107,8 @@ int main(int argc, char* argv[]) {
   const std::string sorting = absl::GetFlag(FLAGS_sorting);
 
   // Define data.
-  std::unique_ptr<ci::Table> table;
-  if (input_csv_path.empty() || columns_to_test.empty()) {
-    std::cerr
-        << "[WARNING] --input_csv_path or --columns_to_test not specified, "
-           "generating synthetic data."
-        << std::endl;
-    std::cout << "Generating " << generate_num_values << " values ("
-              << static_cast<double>(num_unique_values) / generate_num_values *
-                     100
-              << "% unique)..." << std::endl;
-    table = ci::GenerateUniformData(generate_num_values, num_unique_values);
-  } else {
-    std::cout << "Loading data from file " << input_csv_path << "..."
-              << std::endl;
-    table = ci::Table::FromCsv(input_csv_path, columns_to_test);
-  }
+  std::unique_ptr<ci::Table> table = ci::LoadTableFromFlags();
+  table->PrintColumns();
 
   // Potentially sort the data.
   if (!IsValidSorting(sorting)) {
@@ -150,16 +149,52 @@ int main(int argc, char* argv[]) {
               /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
               /*prefix_bits_optimization=*/false)));
   index_factories.push_back(absl::make_unique<ci::PerStripeXorFactory>());
+  index_factories.push_back(
+      absl::make_unique<ci::PerStripeBinaryFuse8Factory>());
+  index_factories.push_back(
+      absl::make_unique<ci::PerStripeBinaryFuse16Factory>());
   index_factories.push_back(absl::make_unique<ci::ZoneMapFactory>());
+  index_factories.push_back(
+      absl::make_unique<ci::InvertedStripeIndexFactory>());
+  index_factories.push_back(absl::make_unique<ci::ZoneMapCuckooIndexFactory>(
+      absl::make_unique<ci::CuckooIndexFactory>(
+          ci::CuckooAlgorithm::SKEWED_KICKING,
+          ci::kMaxLoadFactor1SlotsPerBucket,
+          /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+          /*prefix_bits_optimization=*/false)));
+
+  const std::string profile_trace_path =
+      absl::GetFlag(FLAGS_profile_trace_path);
+  ci::Profiler::SetLookupProfilingEnabled(absl::GetFlag(FLAGS_profile_lookups));
+  ci::Profiler::SetTracingEnabled(!profile_trace_path.empty());
 
   // Evaluate competitors.
-  ci::Evaluator evaluator;
+  const int max_num_live_indexes = absl::GetFlag(FLAGS_max_num_live_indexes);
+  ci::Evaluator evaluator(
+      std::max(absl::GetFlag(FLAGS_num_threads), 1),
+      max_num_live_indexes > 0 ? max_num_live_indexes
+                               : std::numeric_limits<size_t>::max(),
+      absl::GetFlag(FLAGS_measure_latencies),
+      absl::GetFlag(FLAGS_measure_throughput));
   std::vector<ci::EvaluationResults> results = evaluator.RunExperiments(
       std::move(index_factories), table, num_rows_per_stripe_to_test,
       num_lookups, test_cases);
 
   ci::WriteToCsv(output_csv_path, results);
 
+  std::cout << std::endl
+            << "** Profile (all threads) **" << std::endl
+            << ci::Profiler::GetAggregatedStats().ToTextSummary();
+  if (!profile_trace_path.empty()) {
+    std::ofstream trace_file(profile_trace_path);
+    trace_file << ci::Profiler::ToChromeTraceJson();
+    if (!trace_file) {
+      std::cerr << "Failed to write trace to " << profile_trace_path
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
   std::cout << std::endl
             << "** Result summary **" << std::endl
             << absl::StrFormat("%-50s %10s %10s %11s %11s",
@@ -61,11 +61,27 @@ const std::vector<std::string> GetResultsHeader() {
        "bitmap_roaring_individual_compressed_size:long",  //
        "bitmap_rle_size:long",                            //
        "bitmap_rle_compressed_size:long",                 //
+       // Build stats.
+       "build_time_ns:long",                       //
+       "build_value_to_stripe_bitmaps_ns:long",    //
+       "build_distribute_values_ns:long",          //
+       "build_create_slots_ns:long",               //
+       "build_create_fingerprint_store_ns:long",   //
+       "build_get_global_bitmap_ns:long",          //
+       "build_encode_index_ns:long",               //
+       "build_peak_rss_delta_bytes:long",          //
+       "build_num_allocations:long",               //
+       "build_peak_allocated_bytes:long",          //
        // Test cases.
        "test_case_name:string",     //
        "num_lookups:long",          //
        "num_false_positives:long",  //
-       "num_true_negatives:long"});
+       "num_true_negatives:long",   //
+       "latency_p50_ns:long",       //
+       "latency_p90_ns:long",       //
+       "latency_p99_ns:long",       //
+       "latency_p999_ns:long",      //
+       "lookups_per_second:double"});
 
   return *header;
 }
@@ -125,6 +141,23 @@ void WriteToCsv(const std::string path,
             result.bitmap_stats().roaring_individual_compressed_size()),
         absl::StrCat(result.bitmap_stats().rle_size()),
         absl::StrCat(result.bitmap_stats().rle_compressed_size()),
+        // Build stats.
+        absl::StrCat(result.build_stats().build_time_ns()),
+        absl::StrCat(result.build_stats().value_to_stripe_bitmaps_ns()),
+        absl::StrCat(result.build_stats().distribute_values_ns()),
+        absl::StrCat(result.build_stats().create_slots_ns()),
+        absl::StrCat(result.build_stats().create_fingerprint_store_ns()),
+        absl::StrCat(result.build_stats().get_global_bitmap_ns()),
+        absl::StrCat(result.build_stats().encode_index_ns()),
+        result.build_stats().has_peak_rss_delta_bytes()
+            ? absl::StrCat(result.build_stats().peak_rss_delta_bytes())
+            : "",
+        result.build_stats().has_num_allocations()
+            ? absl::StrCat(result.build_stats().num_allocations())
+            : "",
+        result.build_stats().has_peak_allocated_bytes()
+            ? absl::StrCat(result.build_stats().peak_allocated_bytes())
+            : "",
     };
 
     for (const TestCase& test_case : result.test_cases()) {
@@ -135,6 +168,21 @@ void WriteToCsv(const std::string path,
                                absl::StrCat(test_case.num_lookups()),
                                absl::StrCat(test_case.num_false_positives()),
                                absl::StrCat(test_case.num_true_negatives()),
+                               test_case.has_latency_p50_ns()
+                                   ? absl::StrCat(test_case.latency_p50_ns())
+                                   : "",
+                               test_case.has_latency_p90_ns()
+                                   ? absl::StrCat(test_case.latency_p90_ns())
+                                   : "",
+                               test_case.has_latency_p99_ns()
+                                   ? absl::StrCat(test_case.latency_p99_ns())
+                                   : "",
+                               test_case.has_latency_p999_ns()
+                                   ? absl::StrCat(test_case.latency_p999_ns())
+                                   : "",
+                               test_case.has_lookups_per_second()
+                                   ? absl::StrCat(test_case.lookups_per_second())
+                                   : "",
                            });
 
       file << absl::StrJoin(test_case_row, ",") << std::endl;
@@ -18,95 +18,294 @@
 
 #include "evaluator.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 #include <limits>
+#include <numeric>
 #include <ostream>
+#include <thread>
 
+#include "absl/base/call_once.h"
+#include "absl/memory/memory.h"
 #include "absl/random/distributions.h"
-#include "absl/random/random.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/strip.h"
+#include "common/allocation_counter.h"
+#include "common/profiling.h"
 #include "data.h"
 #include "evaluation.pb.h"
 #include "index_structure.h"
 
 namespace ci {
 
+StripeGroundTruth::StripeGroundTruth(const Column& column,
+                                     size_t num_rows_per_stripe)
+    : num_stripes_(column.num_rows() / num_rows_per_stripe),
+      values_(column.distinct_values()),
+      offsets_(values_.size() + 1, 0) {
+  // Collect the (indexes of the) distinct values of each stripe and count the
+  // stripes per value.
+  std::vector<uint32_t> stripe_values;
+  std::vector<size_t> stripe_ends;
+  stripe_ends.reserve(num_stripes_);
+  std::vector<int> rows;
+  for (size_t stripe_id = 0; stripe_id < num_stripes_; ++stripe_id) {
+    const absl::Span<const int> stripe = column.data().subspan(
+        stripe_id * num_rows_per_stripe, num_rows_per_stripe);
+    rows.assign(stripe.begin(), stripe.end());
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    for (const int value : rows) {
+      const uint32_t value_index =
+          std::lower_bound(values_.begin(), values_.end(), value) -
+          values_.begin();
+      stripe_values.push_back(value_index);
+      ++offsets_[value_index + 1];
+    }
+    stripe_ends.push_back(stripe_values.size());
+  }
+  std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+
+  // Scatter the stripe ids (in ascending order) to their values.
+  stripe_ids_.resize(stripe_values.size());
+  std::vector<size_t> next(offsets_.begin(), offsets_.end() - 1);
+  size_t pos = 0;
+  for (size_t stripe_id = 0; stripe_id < num_stripes_; ++stripe_id) {
+    for (; pos < stripe_ends[stripe_id]; ++pos)
+      stripe_ids_[next[stripe_values[pos]]++] = stripe_id;
+  }
+}
+
+absl::Span<const uint32_t> StripeGroundTruth::StripesContaining(
+    int value) const {
+  const auto it = std::lower_bound(values_.begin(), values_.end(), value);
+  if (it == values_.end() || *it != value) return {};
+  const size_t value_index = it - values_.begin();
+  return absl::MakeConstSpan(stripe_ids_)
+      .subspan(offsets_[value_index],
+               offsets_[value_index + 1] - offsets_[value_index]);
+}
+
+using ci::BuildStats;
 using ci::EvaluationResults;
 using TestCase = ci::EvaluationResults::TestCase;
 
+namespace {
+
+// Resets the peak resident set size of the process to the current one (see
+// proc(5)). Returns false if not supported.
+bool ResetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return !clear_refs.fail();
+}
+
+// Returns the peak resident set size of the process since the last
+// ResetPeakRss() (or since its start), or -1 if not supported.
+int64_t GetPeakRssBytes() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    absl::string_view value = line;
+    if (!absl::ConsumePrefix(&value, "VmHWM:")) continue;
+    value = absl::StripAsciiWhitespace(value);
+    int64_t kilobytes;
+    if (!absl::ConsumeSuffix(&value, "kB") ||
+        !absl::SimpleAtoi(absl::StripAsciiWhitespace(value), &kilobytes)) {
+      return -1;
+    }
+    return kilobytes * 1024;
+  }
+  return -1;
+}
+
+// State shared by the experiments of a pair of (column, num_rows_per_stripe),
+// i.e., by all index structures built for it.
+struct ExperimentGroup {
+  const Column* column;
+  size_t num_rows_per_stripe;
+  // Initialized by the first experiment of the group.
+  absl::once_flag init_once;
+  EvaluationResults base_result;
+  std::unique_ptr<StripeGroundTruth> ground_truth;
+  // Number of experiments that haven't finished yet. The last one frees the
+  // `ground_truth`.
+  std::atomic<size_t> num_pending_experiments;
+};
+
+}  // namespace
+
+Evaluator::Evaluator(size_t num_threads, size_t max_num_live_indexes,
+                     bool measure_latencies, bool measure_throughput)
+    : num_threads_(
+          std::max<size_t>(std::min(num_threads, max_num_live_indexes), 1)),
+      measure_latencies_(measure_latencies),
+      measure_throughput_(measure_throughput || measure_latencies) {}
+
 std::vector<EvaluationResults> Evaluator::RunExperiments(
     std::vector<std::unique_ptr<IndexStructureFactory>>
         index_structure_factories,
     const std::unique_ptr<Table>& table,
     const std::vector<size_t>& num_rows_per_stripe_to_test, size_t num_lookups,
     const std::vector<std::string>& test_cases) {
-  std::vector<EvaluationResults> results;
-
-  for (const std::unique_ptr<Column>& column : table->GetColumns()) {
-    std::cout << "Column: " << column->name() << std::endl;
-    EvaluationResults base_result;
-    base_result.set_column_name(column->name());
-    base_result.set_column_type(DataTypeName(column->type()));
-    base_result.set_column_cardinality(column->num_distinct_values());
-
-    for (size_t num_rows_per_stripe : num_rows_per_stripe_to_test) {
-      base_result.set_num_rows_per_stripe(num_rows_per_stripe);
-      base_result.set_num_stripes(column->num_rows() / num_rows_per_stripe);
-      base_result.set_column_compressed_size_bytes(
-          column->compressed_size_bytes(num_rows_per_stripe));
-
-      for (const std::unique_ptr<IndexStructureFactory>& factory :
-           index_structure_factories) {
-        std::unique_ptr<IndexStructure> index =
-            factory->Create(*column, num_rows_per_stripe);
-        EvaluationResults result = base_result;
-        result.set_index_structure(index->name());
-        result.set_index_size_bytes(index->byte_size());
-        result.set_index_compressed_size_bytes(index->compressed_byte_size());
-        *result.mutable_bitmap_stats() = index->bitmap_stats();
-
-        for (const std::string& test_case : test_cases) {
-          if (test_case == "positive_uniform") {
-            *result.add_test_cases() = DoPositiveUniformLookups(
-                *column, *index, num_rows_per_stripe, num_lookups);
-          } else if (test_case == "positive_distinct") {
-            *result.add_test_cases() = DoPositiveDistinctLookups(
-                *column, *index, num_rows_per_stripe, num_lookups);
-          } else if (test_case == "positive_zipf") {
-            *result.add_test_cases() = DoPositiveZipfLookups(
-                *column, *index, num_rows_per_stripe, num_lookups);
-          } else if (test_case == "negative") {
-            *result.add_test_cases() = DoNegativeLookups(
-                *column, *index, num_rows_per_stripe, num_lookups);
-          } else if (test_case == "mixed") {
-            for (double hit_rate = 0.0; hit_rate <= 1.0; hit_rate += 0.1) {
-              *result.add_test_cases() = DoMixedLookups(
-                  *column, *index, num_rows_per_stripe, num_lookups, hit_rate);
-            }
-          } else {
-            std::cerr << "Test case " << test_case << " does not exist."
-                      << std::endl;
-            exit(EXIT_FAILURE);
-          }
-        }
-
-        results.push_back(std::move(result));
-      }
+  for (const std::string& test_case : test_cases) {
+    if (!IsValidTestCase(test_case)) {
+      std::cerr << "Test case " << test_case << " does not exist."
+                << std::endl;
+      exit(EXIT_FAILURE);
     }
   }
 
+  // Experiments are numbered in the (serial) order of their results: by
+  // column, then by stripe size, then by index structure.
+  const size_t num_factories = index_structure_factories.size();
+  std::vector<ExperimentGroup> groups(table->GetColumns().size() *
+                                      num_rows_per_stripe_to_test.size());
+  for (size_t i = 0; i < groups.size(); ++i) {
+    groups[i].column =
+        table->GetColumns()[i / num_rows_per_stripe_to_test.size()].get();
+    groups[i].num_rows_per_stripe =
+        num_rows_per_stripe_to_test[i % num_rows_per_stripe_to_test.size()];
+    groups[i].num_pending_experiments = num_factories;
+  }
+  std::vector<EvaluationResults> results(groups.size() * num_factories);
+
+  // Each worker runs one experiment at a time, so at most `num_threads_`
+  // index structures (and the ground truths of their groups) are alive. All
+  // lookups draw their keys from RNGs with fixed seeds, so the results don't
+  // depend on the number of threads.
+  std::atomic<size_t> next_experiment(0);
+  const auto run_experiments = [&]() {
+    for (size_t i = next_experiment++; i < results.size();
+         i = next_experiment++) {
+      ExperimentGroup& group = groups[i / num_factories];
+      const Column& column = *group.column;
+      absl::call_once(group.init_once, [&group, &column]() {
+        std::cout << "Column: " << column.name() << ", "
+                  << group.num_rows_per_stripe << " rows per stripe"
+                  << std::endl;
+        EvaluationResults& base_result = group.base_result;
+        base_result.set_column_name(column.name());
+        base_result.set_column_type(DataTypeName(column.type()));
+        base_result.set_column_cardinality(column.num_distinct_values());
+        base_result.set_num_rows_per_stripe(group.num_rows_per_stripe);
+        base_result.set_num_stripes(column.num_rows() /
+                                    group.num_rows_per_stripe);
+        base_result.set_column_compressed_size_bytes(
+            column.compressed_size_bytes(group.num_rows_per_stripe));
+        group.ground_truth = absl::make_unique<StripeGroundTruth>(
+            column, group.num_rows_per_stripe);
+      });
+      results[i] = RunExperiment(
+          column, *group.ground_truth, group.base_result,
+          *index_structure_factories[i % num_factories],
+          group.num_rows_per_stripe, num_lookups, test_cases);
+      if (--group.num_pending_experiments == 0) group.ground_truth.reset();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < num_threads_; ++t)
+    workers.emplace_back(run_experiments);
+  run_experiments();
+  for (std::thread& worker : workers) worker.join();
+
   return results;
 }
 
-TestCase Evaluator::DoPositiveUniformLookups(const Column& column,
-                                             const IndexStructure& index,
-                                             std::size_t num_rows_per_stripe,
-                                             std::size_t num_lookups) {
+bool Evaluator::IsValidTestCase(const std::string& test_case) {
+  return test_case == "positive_uniform" || test_case == "positive_distinct" ||
+         test_case == "positive_zipf" || test_case == "negative" ||
+         test_case == "mixed";
+}
+
+EvaluationResults Evaluator::RunExperiment(
+    const Column& column, const StripeGroundTruth& ground_truth,
+    const EvaluationResults& base_result,
+    const IndexStructureFactory& factory, size_t num_rows_per_stripe,
+    size_t num_lookups, const std::vector<std::string>& test_cases) {
+  BuildStats build_stats;
+  std::unique_ptr<IndexStructure> index;
+  {
+    // Don't reset the profiler, its stats are aggregated across experiments.
+    const ProfileStats profile_start = Profiler::GetThreadInstance().GetStats();
+    // The peak RSS is per process, so it's only attributable to this build if
+    // no other experiments run concurrently.
+    const int64_t peak_rss_start =
+        num_threads_ == 1 && ResetPeakRss() ? GetPeakRssBytes() : -1;
+    ScopedAllocationCounter allocation_counter;
+    const auto start = std::chrono::steady_clock::now();
+    index = factory.Create(column, num_rows_per_stripe);
+    const auto build_time = std::chrono::steady_clock::now() - start;
+    build_stats.set_build_time_ns(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_time)
+            .count());
+    if (ScopedAllocationCounter::IsEnabled()) {
+      build_stats.set_num_allocations(allocation_counter.num_allocations());
+      build_stats.set_peak_allocated_bytes(
+          allocation_counter.peak_allocated_bytes());
+    }
+    const int64_t peak_rss_end = GetPeakRssBytes();
+    if (peak_rss_start >= 0 && peak_rss_end >= 0) {
+      build_stats.set_peak_rss_delta_bytes(peak_rss_end - peak_rss_start);
+    }
+    const ProfileStats profile =
+        Profiler::GetThreadInstance().GetStats() - profile_start;
+    build_stats.set_value_to_stripe_bitmaps_ns(
+        profile[Counter::ValueToStripeBitmaps].total_ns);
+    build_stats.set_distribute_values_ns(
+        profile[Counter::DistributeValues].total_ns);
+    build_stats.set_create_slots_ns(profile[Counter::CreateSlots].total_ns);
+    build_stats.set_create_fingerprint_store_ns(
+        profile[Counter::CreateFingerprintStore].total_ns);
+    build_stats.set_get_global_bitmap_ns(
+        profile[Counter::GetGlobalBitmap].total_ns);
+    build_stats.set_encode_index_ns(profile[Counter::EncodeIndex].total_ns);
+  }
+  EvaluationResults result = base_result;
+  *result.mutable_build_stats() = build_stats;
+  result.set_index_structure(index->name());
+  result.set_index_size_bytes(index->byte_size());
+  result.set_index_compressed_size_bytes(index->compressed_byte_size());
+  *result.mutable_bitmap_stats() = index->bitmap_stats();
+
+  for (const std::string& test_case : test_cases) {
+    if (test_case == "positive_uniform") {
+      *result.add_test_cases() =
+          DoPositiveUniformLookups(column, ground_truth, *index, num_lookups);
+    } else if (test_case == "positive_distinct") {
+      *result.add_test_cases() =
+          DoPositiveDistinctLookups(column, ground_truth, *index, num_lookups);
+    } else if (test_case == "positive_zipf") {
+      *result.add_test_cases() =
+          DoPositiveZipfLookups(column, ground_truth, *index, num_lookups);
+    } else if (test_case == "negative") {
+      *result.add_test_cases() =
+          DoNegativeLookups(column, ground_truth, *index, num_lookups);
+    } else if (test_case == "mixed") {
+      for (double hit_rate = 0.0; hit_rate <= 1.0; hit_rate += 0.1) {
+        *result.add_test_cases() = DoMixedLookups(column, ground_truth, *index,
+                                                  num_lookups, hit_rate);
+      }
+    }
+  }
+  return result;
+}
+
+TestCase Evaluator::DoPositiveUniformLookups(
+    const Column& column, const StripeGroundTruth& ground_truth,
+    const IndexStructure& index, std::size_t num_lookups) {
   std::mt19937 gen(42);
-  const std::size_t num_stripes = column.num_rows() / num_rows_per_stripe;
-  std::size_t num_false_positive_stripes = 0;
-  std::size_t num_true_negative_stripes = 0;
+  std::vector<int> values;
+  values.reserve(num_lookups);
   // Remove NULLs from the possible lookup values.
-  std::vector<int> column_data = column.data();
+  std::vector<int> column_data(column.data().begin(), column.data().end());
   column_data.erase(std::remove(column_data.begin(), column_data.end(),
                                 Column::kIntNullSentinel),
                     column_data.end());
@@ -115,28 +314,18 @@ TestCase Evaluator::DoPositiveUniformLookups(const Column& column,
       0, column_data.size() - 1);
   for (size_t i = 0; i < num_lookups; ++i) {
     // Draw value from random row offset.
-    const int value = column_data[row_offset_d(gen)];
-    ProbeAllStripes(column, index, value, num_rows_per_stripe, num_stripes,
-                    &num_true_negative_stripes, &num_false_positive_stripes);
+    values.push_back(column_data[row_offset_d(gen)]);
   }
 
-  TestCase test_case;
-  test_case.set_name("positive_uniform");
-  test_case.set_num_lookups(num_lookups);
-  test_case.set_num_false_positives(num_false_positive_stripes);
-  test_case.set_num_true_negatives(num_true_negative_stripes);
-
-  return test_case;
+  return RunLookups("positive_uniform", ground_truth, index, values);
 }
 
-TestCase Evaluator::DoPositiveDistinctLookups(const Column& column,
-                                              const IndexStructure& index,
-                                              std::size_t num_rows_per_stripe,
-                                              std::size_t num_lookups) {
+TestCase Evaluator::DoPositiveDistinctLookups(
+    const Column& column, const StripeGroundTruth& ground_truth,
+    const IndexStructure& index, std::size_t num_lookups) {
   std::mt19937 gen(42);
-  const std::size_t num_stripes = column.num_rows() / num_rows_per_stripe;
-  std::size_t num_false_positive_stripes = 0;
-  std::size_t num_true_negative_stripes = 0;
+  std::vector<int> values;
+  values.reserve(num_lookups);
   std::vector<int> distinct_values = column.distinct_values();
   // Remove NULLs from the lookup.
   distinct_values.erase(
@@ -147,28 +336,18 @@ TestCase Evaluator::DoPositiveDistinctLookups(const Column& column,
       0, distinct_values.size() - 1);
   for (size_t i = 0; i < num_lookups; ++i) {
     // Draw value from random offset.
-    const int value = distinct_values[distinct_values_offset_d(gen)];
-    ProbeAllStripes(column, index, value, num_rows_per_stripe, num_stripes,
-                    &num_true_negative_stripes, &num_false_positive_stripes);
+    values.push_back(distinct_values[distinct_values_offset_d(gen)]);
   }
 
-  TestCase test_case;
-  test_case.set_name("positive_distinct");
-  test_case.set_num_lookups(num_lookups);
-  test_case.set_num_false_positives(num_false_positive_stripes);
-  test_case.set_num_true_negatives(num_true_negative_stripes);
-
-  return test_case;
+  return RunLookups("positive_distinct", ground_truth, index, values);
 }
 
-TestCase Evaluator::DoPositiveZipfLookups(const Column& column,
-                                          const IndexStructure& index,
-                                          std::size_t num_rows_per_stripe,
-                                          std::size_t num_lookups) {
+TestCase Evaluator::DoPositiveZipfLookups(
+    const Column& column, const StripeGroundTruth& ground_truth,
+    const IndexStructure& index, std::size_t num_lookups) {
   std::mt19937 gen(42);
-  const std::size_t num_stripes = column.num_rows() / num_rows_per_stripe;
-  std::size_t num_false_positive_stripes = 0;
-  std::size_t num_true_negative_stripes = 0;
+  std::vector<int> values;
+  values.reserve(num_lookups);
   std::vector<int> distinct_values = column.distinct_values();
   // Remove NULLs from the lookup.
   distinct_values.erase(
@@ -182,28 +361,18 @@ TestCase Evaluator::DoPositiveZipfLookups(const Column& column,
     // implementations (e.g., numpy.random.zipf).
     const size_t offset =
         absl::Zipf(gen, distinct_values.size() - 1, /*q=*/2.0);
-    const int value = distinct_values[offset];
-    ProbeAllStripes(column, index, value, num_rows_per_stripe, num_stripes,
-                    &num_true_negative_stripes, &num_false_positive_stripes);
+    values.push_back(distinct_values[offset]);
   }
 
-  TestCase test_case;
-  test_case.set_name("positive_zipf");
-  test_case.set_num_lookups(num_lookups);
-  test_case.set_num_false_positives(num_false_positive_stripes);
-  test_case.set_num_true_negatives(num_true_negative_stripes);
-
-  return test_case;
+  return RunLookups("positive_zipf", ground_truth, index, values);
 }
 
-TestCase Evaluator::DoNegativeLookups(const Column& column,
-                                      const IndexStructure& index,
-                                      std::size_t num_rows_per_stripe,
-                                      std::size_t num_lookups) {
+TestCase Evaluator::DoNegativeLookups(
+    const Column& column, const StripeGroundTruth& ground_truth,
+    const IndexStructure& index, std::size_t num_lookups) {
   std::mt19937 gen(42);
-  const std::size_t num_stripes = column.num_rows() / num_rows_per_stripe;
-  std::size_t num_false_positive_stripes = 0;
-  std::size_t num_true_negative_stripes = 0;
+  std::vector<int> values;
+  values.reserve(num_lookups);
   std::uniform_int_distribution<int> value_d(std::numeric_limits<int>::min(),
                                              std::numeric_limits<int>::max());
   for (size_t i = 0; i < num_lookups; ++i) {
@@ -212,28 +381,19 @@ TestCase Evaluator::DoNegativeLookups(const Column& column,
     while (column.Contains(value)) {
       value = value_d(gen);
     }
-    ProbeAllStripes(column, index, value, num_rows_per_stripe, num_stripes,
-                    &num_true_negative_stripes, &num_false_positive_stripes);
+    values.push_back(value);
   }
 
-  TestCase test_case;
-  test_case.set_name("negative");
-  test_case.set_num_lookups(num_lookups);
-  test_case.set_num_false_positives(num_false_positive_stripes);
-  test_case.set_num_true_negatives(num_true_negative_stripes);
-
-  return test_case;
+  return RunLookups("negative", ground_truth, index, values);
 }
 
-TestCase Evaluator::DoMixedLookups(const Column& column,
-                                   const IndexStructure& index,
-                                   std::size_t num_rows_per_stripe,
-                                   std::size_t num_lookups, double hit_rate) {
-  absl::BitGen bitgen;
+TestCase Evaluator::DoMixedLookups(
+    const Column& column, const StripeGroundTruth& ground_truth,
+    const IndexStructure& index, std::size_t num_lookups, double hit_rate) {
   std::mt19937 gen(42);
-  const std::size_t num_stripes = column.num_rows() / num_rows_per_stripe;
-  std::size_t num_false_positive_stripes = 0;
-  std::size_t num_true_negative_stripes = 0;
+  std::bernoulli_distribution positive_d(hit_rate);
+  std::vector<int> values;
+  values.reserve(num_lookups);
   std::vector<int> distinct_values = column.distinct_values();
   // Remove NULLs from the lookup.
   distinct_values.erase(
@@ -247,7 +407,7 @@ TestCase Evaluator::DoMixedLookups(const Column& column,
   for (size_t i = 0; i < num_lookups; ++i) {
     int value;
     // Positive or negative lookup?
-    if (absl::Bernoulli(bitgen, hit_rate)) {
+    if (positive_d(gen)) {
       // Positive case.
       // Draw value from random offset.
       value = distinct_values[distinct_values_offset_d(gen)];
@@ -258,38 +418,105 @@ TestCase Evaluator::DoMixedLookups(const Column& column,
         value = value_d(gen);
       }
     }
-    ProbeAllStripes(column, index, value, num_rows_per_stripe, num_stripes,
-                    &num_true_negative_stripes, &num_false_positive_stripes);
+    values.push_back(value);
   }
 
+  return RunLookups(absl::StrFormat("mixed/%.1f", hit_rate), ground_truth,
+                    index, values);
+}
+
+TestCase Evaluator::RunLookups(const std::string& name,
+                               const StripeGroundTruth& ground_truth,
+                               const IndexStructure& index,
+                               const std::vector<int>& values) {
   TestCase test_case;
-  test_case.set_name(absl::StrFormat("mixed/%.1f", hit_rate));
-  test_case.set_num_lookups(num_lookups);
+  test_case.set_name(name);
+  test_case.set_num_lookups(values.size());
+
+  const size_t num_stripes = ground_truth.num_stripes();
+  std::size_t num_false_positive_stripes = 0;
+  std::size_t num_true_negative_stripes = 0;
+  std::vector<int64_t> latencies_ns;
+  if (measure_latencies_) latencies_ns.reserve(values.size());
+  for (const int value : values) {
+    if (measure_latencies_) {
+      const auto start = std::chrono::steady_clock::now();
+      const Bitmap64 result = index.GetQualifyingStripes(value, num_stripes);
+      const auto latency = std::chrono::steady_clock::now() - start;
+      latencies_ns.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(latency)
+              .count());
+      CheckResult(ground_truth, index, value, result,
+                  &num_true_negative_stripes, &num_false_positive_stripes);
+    } else {
+      CheckResult(ground_truth, index, value,
+                  index.GetQualifyingStripes(value, num_stripes),
+                  &num_true_negative_stripes, &num_false_positive_stripes);
+    }
+  }
   test_case.set_num_false_positives(num_false_positive_stripes);
   test_case.set_num_true_negatives(num_true_negative_stripes);
+  if (measure_latencies_) SetLatencyPercentiles(&latencies_ns, &test_case);
+
+  if (measure_throughput_ && !values.empty()) {
+    // Time the lookups as a whole (after the above checked them), so neither
+    // the ground-truth checks nor per-lookup timers are included.
+    size_t num_qualifying_stripes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const int value : values) {
+      num_qualifying_stripes +=
+          index.GetQualifyingStripes(value, num_stripes).bits();
+    }
+    const int64_t total_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    // Uses the results, so the lookups can't be optimized away.
+    if (num_qualifying_stripes != values.size() * num_stripes) {
+      std::cerr << index.name() << " returned a bitmap of the wrong size."
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    test_case.set_lookups_per_second(
+        total_ns == 0 ? 0.0 : values.size() * 1e9 / total_ns);
+  }
 
   return test_case;
 }
 
-void Evaluator::ProbeAllStripes(const Column& column,
-                                const IndexStructure& index, int value,
-                                std::size_t num_rows_per_stripe,
-                                std::size_t num_stripes,
-                                std::size_t* num_true_negative_stripes,
-                                std::size_t* num_false_positive_stripes) {
-  for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
-    // Get expected result (ground truth).
-    const bool expected =
-        column.StripeContains(num_rows_per_stripe, stripe_id, value);
-    if (!expected) ++(*num_true_negative_stripes);
-    if (index.StripeContains(stripe_id, value) != expected) {
-      if (expected) {
-        std::cerr << index.name() << " returned a false negative." << std::endl;
-        exit(EXIT_FAILURE);
-      }
-      ++(*num_false_positive_stripes);
+void Evaluator::CheckResult(const StripeGroundTruth& ground_truth,
+                            const IndexStructure& index, int value,
+                            const Bitmap64& result,
+                            std::size_t* num_true_negative_stripes,
+                            std::size_t* num_false_positive_stripes) {
+  const size_t num_stripes = ground_truth.num_stripes();
+  const absl::Span<const uint32_t> expected =
+      ground_truth.StripesContaining(value);
+  for (const uint32_t stripe_id : expected) {
+    if (!result.Get(stripe_id)) {
+      std::cerr << index.name() << " returned a false negative." << std::endl;
+      exit(EXIT_FAILURE);
     }
   }
+  // All `expected` stripes are set in `result`, so the remaining ones are
+  // false positives.
+  *num_true_negative_stripes += num_stripes - expected.size();
+  *num_false_positive_stripes += result.GetOnesCount() - expected.size();
+}
+
+void Evaluator::SetLatencyPercentiles(std::vector<int64_t>* latencies_ns,
+                                      TestCase* test_case) {
+  if (latencies_ns->empty()) return;
+  std::sort(latencies_ns->begin(), latencies_ns->end());
+  // Nearest-rank percentiles.
+  const auto percentile = [latencies_ns](double p) {
+    const size_t rank = std::ceil(p * latencies_ns->size());
+    return (*latencies_ns)[std::max<size_t>(rank, 1) - 1];
+  };
+  test_case->set_latency_p50_ns(percentile(0.5));
+  test_case->set_latency_p90_ns(percentile(0.9));
+  test_case->set_latency_p99_ns(percentile(0.99));
+  test_case->set_latency_p999_ns(percentile(0.999));
 }
 
 }  // namespace ci
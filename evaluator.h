@@ -19,21 +19,66 @@
 #ifndef CUCKOO_INDEX_EVALUATOR_H
 #define CUCKOO_INDEX_EVALUATOR_H
 
+#include <cstdint>
+#include <limits>
 #include <random>
+#include <string>
+#include <vector>
 
+#include "absl/types/span.h"
 #include "data.h"
 #include "evaluation.pb.h"
 #include "index_structure.h"
 
 namespace ci {
 
+// Ground truth of which stripes of a column contain which values. Stores the
+// sorted ids of the stripes containing each distinct value (i.e., an inverted
+// index), which takes at most one entry per row.
+class StripeGroundTruth {
+ public:
+  StripeGroundTruth(const Column& column, size_t num_rows_per_stripe);
+
+  // Returns the ids of the stripes containing `value` in ascending order.
+  absl::Span<const uint32_t> StripesContaining(int value) const;
+
+  size_t num_stripes() const { return num_stripes_; }
+
+ private:
+  size_t num_stripes_;
+  // The sorted distinct values of the column.
+  std::vector<int> values_;
+  // The stripes containing `values_[i]` are stored in `stripe_ids_` in the
+  // range [offsets_[i], offsets_[i + 1]).
+  std::vector<size_t> offsets_;
+  std::vector<uint32_t> stripe_ids_;
+};
+
 class Evaluator {
  public:
+  // Runs the experiments on `num_threads` threads. Since every thread builds
+  // one index structure at a time, this also bounds the number of index
+  // structures alive at once, which can be restricted further by
+  // `max_num_live_indexes`.
+  //
+  // If `measure_latencies` is set, the latency of every lookup (i.e., of every
+  // IndexStructure::GetQualifyingStripes(..) call) is measured and the test
+  // cases report latency percentiles. If `measure_throughput` (or
+  // `measure_latencies`) is set, the lookups of every test case are repeated
+  // in a single timed loop and the test cases report their throughput. Use a
+  // single thread to avoid interference between the experiments.
+  explicit Evaluator(
+      size_t num_threads = 1,
+      size_t max_num_live_indexes = std::numeric_limits<size_t>::max(),
+      bool measure_latencies = false, bool measure_throughput = false);
+
   // Runs experiments for the given parameters and returns their results.
   //
   // Selected experiments `test_cases` (e.g. positive uniform look-ups) are run
   // for a pair of (column, num_rows_per_stripe). `index_structure_factories`
-  // are used to create an index structure per experiment.
+  // are used to create an index structure per experiment. The results are
+  // ordered by column, num_rows_per_stripe, and factory, and don't depend on
+  // the number of threads.
   std::vector<ci::EvaluationResults> RunExperiments(
       std::vector<std::unique_ptr<IndexStructureFactory>>
           index_structure_factories,
@@ -42,12 +87,21 @@ class Evaluator {
       size_t num_lookups, const std::vector<std::string>& test_cases);
 
  private:
+  static bool IsValidTestCase(const std::string& test_case);
+
+  // Builds an index structure with `factory` and runs the `test_cases` on it.
+  ci::EvaluationResults RunExperiment(
+      const Column& column, const StripeGroundTruth& ground_truth,
+      const ci::EvaluationResults& base_result,
+      const IndexStructureFactory& factory, size_t num_rows_per_stripe,
+      size_t num_lookups, const std::vector<std::string>& test_cases);
+
   // Performs positive lookups with values drawn from random row offsets. This
   // assumes that positive lookup values follow the same distribution than
   // stored values, i.e., frequent values are queried frequently.
   ci::EvaluationResults::TestCase DoPositiveUniformLookups(
-      const Column& column, const IndexStructure& index_structure,
-      std::size_t num_rows_per_stripe, std::size_t num_lookups);
+      const Column& column, const StripeGroundTruth& ground_truth,
+      const IndexStructure& index_structure, std::size_t num_lookups);
 
   // Performs positive lookups with a subset of all distinct values (chosen
   // uniformly at random). This means, e.g., that lookup values that only occur
@@ -55,14 +109,14 @@ class Evaluator {
   // occur in all stripes, on the other hand, cannot cause any false positive
   // stripes.
   ci::EvaluationResults::TestCase DoPositiveDistinctLookups(
-      const Column& column, const IndexStructure& index,
-      std::size_t num_rows_per_stripe, std::size_t num_lookups);
+      const Column& column, const StripeGroundTruth& ground_truth,
+      const IndexStructure& index, std::size_t num_lookups);
 
   // Performs positive lookups with a subset of all distinct values (chosen
   // based on a Zipf distribution).
   ci::EvaluationResults::TestCase DoPositiveZipfLookups(
-      const Column& column, const IndexStructure& index,
-      std::size_t num_rows_per_stripe, std::size_t num_lookups);
+      const Column& column, const StripeGroundTruth& ground_truth,
+      const IndexStructure& index, std::size_t num_lookups);
 
   // Performs negative lookups with random values not present the `column`.
   // Note that in this test case, ZoneMaps will be 100% effective for
@@ -78,8 +132,8 @@ class Evaluator {
   // generation here that only ensures that a lookup key doesn't occur in any
   // stripe.
   ci::EvaluationResults::TestCase DoNegativeLookups(
-      const Column& column, const IndexStructure& index,
-      std::size_t num_rows_per_stripe, std::size_t num_lookups);
+      const Column& column, const StripeGroundTruth& ground_truth,
+      const IndexStructure& index, std::size_t num_lookups);
 
   // Performs lookups with a mix between positive (chosen from distinct
   // values like in DoPositiveDistinctLookups) and negative lookup keys.
@@ -87,19 +141,37 @@ class Evaluator {
   // 10% of the lookup keys are positive, i.e., are at least present in one
   // stripe).
   ci::EvaluationResults::TestCase DoMixedLookups(
-      const Column& column, const IndexStructure& index,
-      std::size_t num_rows_per_stripe, std::size_t num_lookups,
+      const Column& column, const StripeGroundTruth& ground_truth,
+      const IndexStructure& index, std::size_t num_lookups,
       double hit_rate);
 
-  // Probes all stripes for the given `column` and `index`, and updates
-  // `num_true_negative_stripes` (ground truth true negatives) and
-  // `num_false_positive_stripes` (number of times the `index` did not prune
-  // a stripe even though it could have).
-  void ProbeAllStripes(const Column& column, const IndexStructure& index,
-                       int value, std::size_t num_rows_per_stripe,
-                       std::size_t num_stripes,
-                       std::size_t* num_true_negative_stripes,
-                       std::size_t* num_false_positive_stripes);
+  // Looks up all `values` in `index` (probing all stripes at once, see
+  // IndexStructure::GetQualifyingStripes(..)), compares the results to the
+  // `ground_truth`, and returns the test case `name` with the number of true
+  // negative and false positive stripes (number of times the `index` did not
+  // prune a stripe even though it could have) and, if measured, the latency
+  // percentiles and throughput.
+  ci::EvaluationResults::TestCase RunLookups(
+      const std::string& name, const StripeGroundTruth& ground_truth,
+      const IndexStructure& index, const std::vector<int>& values);
+
+  // Compares the `result` of looking up `value` in `index` to the
+  // `ground_truth` and updates `num_true_negative_stripes` and
+  // `num_false_positive_stripes`. Exits on false negatives.
+  static void CheckResult(const StripeGroundTruth& ground_truth,
+                          const IndexStructure& index, int value,
+                          const Bitmap64& result,
+                          std::size_t* num_true_negative_stripes,
+                          std::size_t* num_false_positive_stripes);
+
+  // Sets the latency percentiles of `test_case` to the ones of the lookups
+  // with the given (unsorted) `latencies_ns`.
+  static void SetLatencyPercentiles(std::vector<int64_t>* latencies_ns,
+                                    ci::EvaluationResults::TestCase* test_case);
+
+  const size_t num_threads_;
+  const bool measure_latencies_;
+  const bool measure_throughput_;
 };
 
 }  // namespace ci
@@ -0,0 +1,204 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: evaluator_test.cc
+// -----------------------------------------------------------------------------
+
+#include "evaluator.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "cuckoo_index.h"
+#include "cuckoo_utils.h"
+#include "data.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "per_stripe_xor.h"
+#include "zone_map.h"
+
+namespace ci {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(StripeGroundTruthTest, StripesContaining) {
+  // The last (incomplete) stripe is ignored.
+  const ColumnPtr column =
+      Column::IntColumn("column", {1, 2, 2, 2, 3, 1, 1, 1, 4});
+  const StripeGroundTruth ground_truth(*column, /*num_rows_per_stripe=*/2);
+
+  EXPECT_EQ(ground_truth.num_stripes(), 4);
+  EXPECT_THAT(ground_truth.StripesContaining(1), ElementsAre(0, 2, 3));
+  EXPECT_THAT(ground_truth.StripesContaining(2), ElementsAre(0, 1));
+  EXPECT_THAT(ground_truth.StripesContaining(3), ElementsAre(2));
+  EXPECT_THAT(ground_truth.StripesContaining(4), IsEmpty());
+  EXPECT_THAT(ground_truth.StripesContaining(5), IsEmpty());
+}
+
+TEST(StripeGroundTruthTest, MatchesColumnScan) {
+  constexpr size_t kNumRows = 10000;
+  constexpr size_t kNumRowsPerStripe = 100;
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> value_d(-500, 500);
+  std::vector<int> data(kNumRows);
+  for (int& value : data) value = value_d(gen);
+  const ColumnPtr column = Column::IntColumn("column", std::move(data));
+  const StripeGroundTruth ground_truth(*column, kNumRowsPerStripe);
+
+  for (int value = -501; value <= 501; ++value) {
+    std::vector<uint32_t> expected;
+    for (size_t stripe_id = 0; stripe_id < ground_truth.num_stripes();
+         ++stripe_id) {
+      if (column->StripeContains(kNumRowsPerStripe, stripe_id, value))
+        expected.push_back(stripe_id);
+    }
+    EXPECT_THAT(ground_truth.StripesContaining(value),
+                ::testing::ElementsAreArray(expected));
+  }
+}
+
+std::vector<std::unique_ptr<IndexStructureFactory>> CreateFactories() {
+  std::vector<std::unique_ptr<IndexStructureFactory>> factories;
+  factories.push_back(absl::make_unique<PerStripeXorFactory>());
+  factories.push_back(absl::make_unique<ZoneMapFactory>());
+  factories.push_back(absl::make_unique<CuckooIndexFactory>(
+      CuckooAlgorithm::SKEWED_KICKING, kMaxLoadFactor1SlotsPerBucket,
+      /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+      /*prefix_bits_optimization=*/false));
+  return factories;
+}
+
+TEST(EvaluatorTest, ResultsDontDependOnNumThreads) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> value_d(0, 1000);
+  std::vector<ColumnPtr> columns;
+  for (const char* name : {"a", "b", "c"}) {
+    std::vector<int> data(10000);
+    for (int& value : data) value = value_d(gen);
+    columns.push_back(Column::IntColumn(name, std::move(data)));
+  }
+  const std::unique_ptr<Table> table =
+      Table::Create("table", std::move(columns));
+  const std::vector<std::string> test_cases = {
+      "positive_uniform", "positive_distinct", "positive_zipf", "negative",
+      "mixed"};
+
+  const std::vector<EvaluationResults> expected_results =
+      Evaluator(/*num_threads=*/1)
+          .RunExperiments(CreateFactories(), table, {100, 1000},
+                          /*num_lookups=*/100, test_cases);
+  ASSERT_EQ(expected_results.size(), 3 * 2 * 3);
+  EXPECT_EQ(expected_results[0].column_name(), "a");
+  EXPECT_EQ(expected_results[0].num_rows_per_stripe(), 100);
+  EXPECT_EQ(expected_results[1].index_structure(), "ZoneMap");
+  EXPECT_EQ(expected_results[3].num_rows_per_stripe(), 1000);
+
+  for (const size_t num_threads : {2, 4, 16}) {
+    const std::vector<EvaluationResults> results =
+        Evaluator(num_threads, /*max_num_live_indexes=*/3)
+            .RunExperiments(CreateFactories(), table, {100, 1000},
+                            /*num_lookups=*/100, test_cases);
+    ASSERT_EQ(results.size(), expected_results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      // Build costs are measured and hence vary between runs.
+      EvaluationResults result = results[i];
+      EvaluationResults expected_result = expected_results[i];
+      result.clear_build_stats();
+      expected_result.clear_build_stats();
+      EXPECT_EQ(result.SerializeAsString(),
+                expected_result.SerializeAsString());
+    }
+  }
+}
+
+TEST(EvaluatorTest, MeasuresLatencies) {
+  std::vector<ColumnPtr> columns;
+  std::vector<int> data(10000);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = i % 1000;
+  columns.push_back(Column::IntColumn("column", std::move(data)));
+  const std::unique_ptr<Table> table =
+      Table::Create("table", std::move(columns));
+
+  for (const bool measure_latencies : {false, true}) {
+    const std::vector<EvaluationResults> results =
+        Evaluator(/*num_threads=*/1, /*max_num_live_indexes=*/1,
+                  measure_latencies)
+            .RunExperiments(CreateFactories(), table, {100},
+                            /*num_lookups=*/1000, {"positive_uniform"});
+    for (const EvaluationResults& result : results) {
+      ASSERT_EQ(result.test_cases_size(), 1);
+      const EvaluationResults::TestCase& test_case = result.test_cases(0);
+      EXPECT_EQ(test_case.has_latency_p50_ns(), measure_latencies);
+      EXPECT_EQ(test_case.has_lookups_per_second(), measure_latencies);
+      if (!measure_latencies) continue;
+      EXPECT_LE(test_case.latency_p50_ns(), test_case.latency_p90_ns());
+      EXPECT_LE(test_case.latency_p90_ns(), test_case.latency_p99_ns());
+      EXPECT_LE(test_case.latency_p99_ns(), test_case.latency_p999_ns());
+      EXPECT_GT(test_case.lookups_per_second(), 0.0);
+    }
+  }
+}
+
+TEST(EvaluatorTest, MeasuresThroughputWithoutLatencies) {
+  std::vector<ColumnPtr> columns;
+  std::vector<int> data(10000);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = i % 1000;
+  columns.push_back(Column::IntColumn("column", std::move(data)));
+  const std::unique_ptr<Table> table =
+      Table::Create("table", std::move(columns));
+
+  const std::vector<EvaluationResults> results =
+      Evaluator(/*num_threads=*/1, /*max_num_live_indexes=*/1,
+                /*measure_latencies=*/false, /*measure_throughput=*/true)
+          .RunExperiments(CreateFactories(), table, {100},
+                          /*num_lookups=*/1000, {"positive_uniform"});
+  for (const EvaluationResults& result : results) {
+    ASSERT_EQ(result.test_cases_size(), 1);
+    const EvaluationResults::TestCase& test_case = result.test_cases(0);
+    EXPECT_FALSE(test_case.has_latency_p50_ns());
+    EXPECT_GT(test_case.lookups_per_second(), 0.0);
+  }
+}
+
+TEST(EvaluatorTest, RecordsBuildStats) {
+  std::vector<ColumnPtr> columns;
+  std::vector<int> data(10000);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = i % 1000;
+  columns.push_back(Column::IntColumn("column", std::move(data)));
+  const std::unique_ptr<Table> table =
+      Table::Create("table", std::move(columns));
+
+  const std::vector<EvaluationResults> results =
+      Evaluator().RunExperiments(CreateFactories(), table, {100},
+                                 /*num_lookups=*/100, {"positive_uniform"});
+  for (const EvaluationResults& result : results) {
+    ASSERT_TRUE(result.has_build_stats());
+    EXPECT_GT(result.build_stats().build_time_ns(), 0);
+    EXPECT_GT(result.build_stats().num_allocations(), 0);
+    EXPECT_GT(result.build_stats().peak_allocated_bytes(), 0);
+    if (result.build_stats().has_peak_rss_delta_bytes()) {
+      EXPECT_GE(result.build_stats().peak_rss_delta_bytes(), 0);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace ci
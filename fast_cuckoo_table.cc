@@ -0,0 +1,89 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: fast_cuckoo_table.cc
+// -----------------------------------------------------------------------------
+
+#include "fast_cuckoo_table.h"
+
+#include <iostream>
+#include <limits>
+
+namespace ci {
+
+FastCuckooTable::FastCuckooTable(
+    const std::vector<Fingerprint>& slot_fingerprints,
+    const size_t slots_per_bucket, const Bitmap64* use_prefix_bits_bitmap,
+    const std::vector<Bitmap64Ptr>& slot_bitmaps, const size_t num_stripes)
+    : num_stripes_(num_stripes), num_active_slots_(0) {
+  if (slots_per_bucket > kMaxSlotsPerBucket) {
+    std::cerr << "The fast layout supports at most " << kMaxSlotsPerBucket
+              << " slots per bucket, got " << slots_per_bucket << "."
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  assert(slot_fingerprints.size() % slots_per_bucket == 0);
+  assert(slot_fingerprints.size() == slot_bitmaps.size());
+
+  for (const Fingerprint& fp : slot_fingerprints) num_active_slots_ += fp.active;
+  const size_t words_per_bitmap = (num_stripes_ + 63) / 64;
+  if (num_active_slots_ * words_per_bitmap >
+      std::numeric_limits<uint32_t>::max()) {
+    std::cerr << "Too many stripe bitmap words for the fast layout: "
+              << num_active_slots_ * words_per_bitmap << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  bitmaps_.resize(num_active_slots_ * words_per_bitmap, 0);
+
+  // Value-initialize all buckets (i.e., zero all fields).
+  const size_t num_buckets = slot_fingerprints.size() / slots_per_bucket;
+  buckets_.resize(num_buckets, FastBucket());
+
+  size_t bitmap_offset = 0;
+  for (size_t bucket_id = 0; bucket_id < num_buckets; ++bucket_id) {
+    FastBucket& bucket = buckets_[bucket_id];
+    bucket.use_prefix_bits = use_prefix_bits_bitmap != nullptr &&
+                             use_prefix_bits_bitmap->Get(bucket_id);
+    for (size_t i = 0; i < slots_per_bucket; ++i) {
+      const size_t slot = bucket_id * slots_per_bucket + i;
+      const Fingerprint& fp = slot_fingerprints[slot];
+      if (!fp.active) continue;
+      // All fingerprints in a bucket share the same length.
+      bucket.num_bits = fp.num_bits;
+      bucket.fingerprints[bucket.num_slots] = fp.fingerprint;
+      bucket.bitmap_offsets[bucket.num_slots] = bitmap_offset;
+      ++bucket.num_slots;
+
+      const Bitmap64Ptr& bitmap = slot_bitmaps[slot];
+      assert(bitmap != nullptr && bitmap->bits() == num_stripes_);
+      for (const size_t stripe_id : bitmap->TrueBitIndices()) {
+        bitmaps_[bitmap_offset + stripe_id / 64] |= uint64_t{1}
+                                                    << (stripe_id % 64);
+      }
+      bitmap_offset += words_per_bitmap;
+    }
+  }
+}
+
+std::string FastCuckooTable::Encode() const {
+  std::string result;
+  result.append(reinterpret_cast<const char*>(buckets_.data()),
+                buckets_.size() * sizeof(FastBucket));
+  result.append(reinterpret_cast<const char*>(bitmaps_.data()),
+                bitmaps_.size() * sizeof(uint64_t));
+  return result;
+}
+
+}  // namespace ci
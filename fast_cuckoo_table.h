@@ -0,0 +1,149 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: fast_cuckoo_table.h
+// -----------------------------------------------------------------------------
+//
+// An uncompressed, latency-optimized layout of a Cuckoo table: each bucket is a
+// cache-line-aligned record of fixed-width fingerprints together with direct
+// offsets into a word-aligned arena holding the stripe bitmaps of all active
+// slots. A lookup therefore touches at most two cache lines (the primary and
+// the secondary bucket) before reading the bitmap.
+//
+// Compared to the compressed layout (FingerprintStore + RLE bitmaps), this
+// layout typically needs several times more memory.
+
+#ifndef CUCKOO_INDEX_FAST_CUCKOO_TABLE_H_
+#define CUCKOO_INDEX_FAST_CUCKOO_TABLE_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "common/bitmap.h"
+#include "cuckoo_utils.h"
+
+namespace ci {
+
+class FastCuckooTable {
+ public:
+  // Maximum number of slots per bucket such that a bucket fits into a single
+  // cache line.
+  static constexpr size_t kMaxSlotsPerBucket = 4;
+
+  // The `slot_fingerprints` and `slot_bitmaps` have a 1:1 correspondence to the
+  // slots in the Cuckoo table (bitmaps of inactive slots are ignored).
+  // `use_prefix_bits_bitmap` may be null, in which case suffix bits of
+  // fingerprints are used for all buckets.
+  FastCuckooTable(const std::vector<Fingerprint>& slot_fingerprints,
+                  size_t slots_per_bucket,
+                  const Bitmap64* use_prefix_bits_bitmap,
+                  const std::vector<Bitmap64Ptr>& slot_bitmaps,
+                  size_t num_stripes);
+
+  // Looks up `value` in its primary and secondary bucket. In case it is found,
+  // returns true and sets `bitmap_offset` to the offset of the corresponding
+  // stripe bitmap.
+  bool Lookup(const CuckooValue& value, size_t* bitmap_offset) const {
+    return BucketContains(buckets_[value.primary_bucket], value.fingerprint,
+                          bitmap_offset) ||
+           BucketContains(buckets_[value.secondary_bucket], value.fingerprint,
+                          bitmap_offset);
+  }
+
+  // Returns bit `stripe_id` of the stripe bitmap at `bitmap_offset`.
+  bool StripeContains(size_t bitmap_offset, size_t stripe_id) const {
+    assert(stripe_id < num_stripes_);
+    return (bitmaps_[bitmap_offset + stripe_id / 64] >> (stripe_id % 64)) & 1;
+  }
+
+  // Returns the stripe bitmap at `bitmap_offset`.
+  Bitmap64 GetStripeBitmap(size_t bitmap_offset) const {
+    return Bitmap64::FromWords(bitmaps_.data() + bitmap_offset, num_stripes_);
+  }
+
+  // Returns the union of the stripe bitmaps at `bitmap_offsets`.
+  Bitmap64 GetStripeBitmapUnion(absl::Span<const size_t> bitmap_offsets) const {
+    std::vector<uint64_t> words((num_stripes_ + 63) / 64, 0);
+    for (const size_t bitmap_offset : bitmap_offsets) {
+      for (size_t i = 0; i < words.size(); ++i)
+        words[i] |= bitmaps_[bitmap_offset + i];
+    }
+    return Bitmap64::FromWords(words.data(), num_stripes_);
+  }
+
+  // Returns the number of set bits in the stripe bitmap at `bitmap_offset`.
+  size_t GetOnesCount(size_t bitmap_offset) const {
+    size_t count = 0;
+    for (size_t i = 0; i < (num_stripes_ + 63) / 64; ++i)
+      count += __builtin_popcountll(bitmaps_[bitmap_offset + i]);
+    return count;
+  }
+
+  size_t num_buckets() const { return buckets_.size(); }
+
+  size_t active_slots() const { return num_active_slots_; }
+
+  // Returns the in-memory size of the table in bytes.
+  size_t byte_size() const {
+    return buckets_.size() * sizeof(FastBucket) +
+           bitmaps_.size() * sizeof(uint64_t);
+  }
+
+  // Returns the buckets followed by the bitmap arena, as laid out in memory.
+  std::string Encode() const;
+
+ private:
+  // A single bucket. Only the first `num_slots` slots are occupied.
+  struct alignas(kCacheLineSize) FastBucket {
+    uint64_t fingerprints[kMaxSlotsPerBucket];
+    // Offsets (in 64-bit words) of the stripe bitmaps in `bitmaps_`.
+    uint32_t bitmap_offsets[kMaxSlotsPerBucket];
+    uint8_t num_bits;
+    uint8_t num_slots;
+    bool use_prefix_bits;
+  };
+  static_assert(sizeof(FastBucket) == kCacheLineSize,
+                "A bucket has to fit into a single cache line.");
+
+  static bool BucketContains(const FastBucket& bucket, uint64_t fingerprint,
+                             size_t* bitmap_offset) {
+    const uint64_t fingerprint_bits =
+        bucket.use_prefix_bits
+            ? GetFingerprintPrefix(fingerprint, bucket.num_bits)
+            : GetFingerprintSuffix(fingerprint, bucket.num_bits);
+    for (size_t i = 0; i < bucket.num_slots; ++i) {
+      if (bucket.fingerprints[i] == fingerprint_bits) {
+        *bitmap_offset = bucket.bitmap_offsets[i];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const size_t num_stripes_;
+  size_t num_active_slots_;
+
+  std::vector<FastBucket> buckets_;
+  // Stripe bitmaps of all active slots, each starting at a word boundary.
+  std::vector<uint64_t> bitmaps_;
+};
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_FAST_CUCKOO_TABLE_H_
@@ -18,9 +18,9 @@
 
 #include "fingerprint_store.h"
 
+#include <cstring>
 #include <iostream>
 
-#include "absl/strings/str_cat.h"
 #include "common/bitmap.h"
 #include "common/rle_bitmap.h"
 #include "cuckoo_utils.h"
@@ -29,41 +29,29 @@ namespace ci {
 
 constexpr size_t kEmptyBucketsBlockMarker = 999;
 
-Block::Block(const size_t num_bits, const std::vector<uint64_t>& fingerprints)
-    : num_bits_(num_bits), num_fingerprints_(fingerprints.size()) {
-  // Write to a ByteBuffer.
-  ByteBuffer result;
-
-  // Needed to re-construct original fingerprints since the bit width in
-  // bitpacked format could be smaller.
-  PutVarint32(num_bits, &result);
-
-  // No need to encode `num_fingerprints`. Can be reconstructed from
-  // `block_bitmap` in FingerprintStore.
+namespace {
 
-  const uint32_t bit_width =
-      MaxBitWidth<uint64_t>(absl::MakeConstSpan(fingerprints));
-  if (bit_width > num_bits) {
-    std::cerr << "Maximum bit width is " << bit_width
-              << ", but expected at most " << num_bits << " bits.";
-    std::exit(-1);
+// Maps `bucket_idx` to its corresponding index (bit) in the compacted block
+// bitmap `block_bitmap_idx` of `block_bitmaps`.
+size_t MapBucketIndexToBitInBlockBitmap(
+    const std::vector<Bitmap64Ptr>& block_bitmaps, const size_t bucket_idx,
+    const size_t block_bitmap_idx) {
+  assert(block_bitmap_idx <= block_bitmaps.size());
+  size_t curr_idx = bucket_idx;
+  // Keep subtracting curr_bitmap.Rank(curr_idx) from `curr_idx`. In one
+  // iteration, we map `curr_idx` (which corresponds to a bit in the current
+  // bitmap) to its index (bit) in the next bitmap. We continue this procedure
+  // up to (exclusive) the bitmap at `block_bitmap_idx`.
+  for (size_t i = 0; i < block_bitmap_idx; ++i) {
+    const size_t rank = GetRank(*block_bitmaps[i], curr_idx);
+    assert(curr_idx >= rank);
+    curr_idx -= rank;
   }
-
-  PutVarint32(bit_width, &result);
-  const size_t fingerprints_pos = result.pos();
-  StoreBitPacked<uint64_t>(fingerprints, bit_width, &result);
-  // Note: We could avoid multiple slop bytes by storing all blocks
-  // consecutively.
-  PutSlopBytes(&result);
-
-  // Copy the serialized encoding to the string `data_`.
-  data_ = std::string(result.data(), result.pos());
-
-  // Set BitPackedReader.
-  fingerprints_ =
-      BitPackedReader<uint64_t>(bit_width, data_.data() + fingerprints_pos);
+  return curr_idx;
 }
 
+}  // namespace
+
 void FingerprintStore::Decode(const std::string& data) {
   // TODO: Make method return FingerprintStore + implement decode.
 }
@@ -71,7 +59,8 @@ void FingerprintStore::Decode(const std::string& data) {
 FingerprintStore::FingerprintStore(const std::vector<Fingerprint>& fingerprints,
                                    const size_t slots_per_bucket,
                                    const bool use_rle_to_encode_block_bitmaps)
-    : num_slots_(fingerprints.size()),
+    : arena_size_(0),
+      num_slots_(fingerprints.size()),
       slots_per_bucket_(slots_per_bucket),
       use_rle_to_encode_block_bitmaps_(use_rle_to_encode_block_bitmaps) {
   assert((fingerprints.size() % slots_per_bucket_) == 0);
@@ -138,10 +127,7 @@ FingerprintStore::FingerprintStore(const std::vector<Fingerprint>& fingerprints,
   std::sort(lengths.begin(), lengths.end(), comparator);
 
   // Allocate one block per fingerprint length.
-  for (const size_t length : lengths) {
-    blocks_.push_back(
-        absl::make_unique<Block>(length, blocks[length].fingerprints));
-  }
+  CreateBlocks(lengths, blocks);
 
   CreateAndCompactBlockBitmaps(lengths, &blocks);
 
@@ -161,29 +147,28 @@ Fingerprint FingerprintStore::GetFingerprint(const size_t slot_idx) const {
   // Search blocks for fingerprint.
   size_t idx_in_compacted_bitmap = bucket_idx;
   for (size_t block_idx = 0; block_idx < blocks_.size(); ++block_idx) {
-    const Bitmap64Ptr& block_bitmap = block_bitmaps_[block_idx];
-    const BlockPtr& block = blocks_[block_idx];
+    const Block& block = blocks_[block_idx];
 
     if (block_idx > 0) {
       // Map `bucket_idx` to index in compacted block bitmap. Re-use
       // `idx_in_compacted_bitmap` across loop iterations, i.e., only map it
       // from one block bitmap to the next.
       idx_in_compacted_bitmap -=
-          GetRank(*(block_bitmaps_[block_idx - 1]), idx_in_compacted_bitmap);
+          BlockBitmapRank(block_idx - 1, idx_in_compacted_bitmap);
     }
 
     // Fingerprint can't be part of "empty buckets block" (this case is already
     // taken care of by checking `empty_slots_bitmap_` above).
-    if (block->num_bits() == kEmptyBucketsBlockMarker) continue;
+    if (block.num_bits() == kEmptyBucketsBlockMarker) continue;
 
-    if (block_bitmap->Get(idx_in_compacted_bitmap)) {
+    if (BlockBitmapGet(block_idx, idx_in_compacted_bitmap)) {
       // Block `block_idx` contains fingerprints of bucket `bucket_idx`.
 
       const size_t idx_in_block = GetIndexOfFingerprintInBlock(
           block_idx, idx_in_compacted_bitmap, slot_idx);
 
-      return Fingerprint{/*active=*/true, block->num_bits(),
-                         /*fingerprint=*/block->Get(idx_in_block)};
+      return Fingerprint{/*active=*/true, block.num_bits(),
+                         /*fingerprint=*/block.Get(idx_in_block)};
     }
   }
 
@@ -216,23 +201,25 @@ std::string FingerprintStore::Encode(bool bitmaps_only) const {
   // Encode block bitmaps, except "empty buckets block" which can be
   // re-constructed from `empty_slots_bitmap_` using
   // cuckoo_utils.h:GetEmptyBucketsBitmap(..).
-  std::vector<Bitmap64Ptr> block_bitmaps_without_empty_block;
-  for (size_t i = 0; i < block_bitmaps_.size(); ++i) {
-    if (blocks_[i]->num_bits() == kEmptyBucketsBlockMarker) continue;
-    const Bitmap64Ptr& curr_bitmap = block_bitmaps_[i];
-    Bitmap64Ptr new_bitmap = absl::make_unique<Bitmap64>(curr_bitmap->bits());
-    for (const size_t bit : curr_bitmap->TrueBitIndices())
-      new_bitmap->Set(bit, true);
-    block_bitmaps_without_empty_block.push_back(std::move(new_bitmap));
+  size_t num_bits_without_empty_block = 0;
+  for (size_t i = 0; i < blocks_.size(); ++i) {
+    if (blocks_[i].num_bits() == kEmptyBucketsBlockMarker) continue;
+    num_bits_without_empty_block += BlockBitmapBits(i);
+  }
+  Bitmap64 global_bitmap(/*size=*/num_bits_without_empty_block);
+  size_t base_index = 0;
+  for (size_t i = 0; i < blocks_.size(); ++i) {
+    if (blocks_[i].num_bits() == kEmptyBucketsBlockMarker) continue;
+    const size_t num_bits = BlockBitmapBits(i);
+    // Encode num bits of block bitmap.
+    PutVarint32(num_bits, &result);
+    for (size_t bit = 0; bit < num_bits; ++bit) {
+      if (BlockBitmapGet(i, bit)) global_bitmap.Set(base_index + bit, true);
+    }
+    base_index += num_bits;
   }
-
-  // Encode num bits of block bitmaps.
-  for (size_t i = 0; i < block_bitmaps_without_empty_block.size(); ++i)
-    PutVarint32(block_bitmaps_without_empty_block[i]->bits(), &result);
 
   // Encode block bitmaps.
-  const Bitmap64 global_bitmap =
-      Bitmap64::GetGlobalBitmap(block_bitmaps_without_empty_block);
   if (use_rle_to_encode_block_bitmaps_) {
     const RleBitmap rle_bitmap(global_bitmap);
     PutString(rle_bitmap.data(), &result);
@@ -242,19 +229,26 @@ std::string FingerprintStore::Encode(bool bitmaps_only) const {
     PutString(bitmap_encoded, &result);
   }
 
-  std::string encoded(result.data(), result.pos());
   if (!bitmaps_only) {
-    // Encode blocks.
-    for (const BlockPtr& block : blocks_)
-      absl::StrAppend(&encoded, block->GetData());
+    // Encode block headers. The "empty buckets block" has no fingerprints and
+    // is skipped. No need to encode `num_fingerprints` or offsets, they can be
+    // reconstructed from the block bitmaps.
+    for (const Block& block : blocks_) {
+      if (block.num_bits() == kEmptyBucketsBlockMarker) continue;
+      PutVarint32(block.num_bits(), &result);
+      PutVarint32(block.bit_width(), &result);
+    }
+    // Encode the arena (including its slop bytes) as-is.
+    const absl::string_view arena = GetArena();
+    PutBytes(arena.data(), arena.size(), &result);
   }
-  return encoded;
+  return std::string(result.data(), result.pos());
 }
 
 void FingerprintStore::PrintStats() const {
   for (size_t i = 0; i < blocks_.size(); ++i) {
-    std::cout << "block " << i << ": bits: " << blocks_[i]->num_bits()
-              << ", buckets: " << block_bitmaps_[i]->GetOnesCount()
+    std::cout << "block " << i << ": bits: " << blocks_[i].num_bits()
+              << ", buckets: " << BlockBitmapOnesCount(i)
               << std::endl;
   }
   std::cout << "GetSizeInBytes(bitmaps_only = false): "
@@ -283,7 +277,7 @@ size_t FingerprintStore::GetBucketIndex(const size_t block_idx,
                                         const size_t bit_idx) const {
   size_t pos = bit_idx;
   for (int i = block_idx - 1; i >= 0; --i) {
-    if (!SelectZero(*(block_bitmaps_[i]), pos, &pos)) {
+    if (!BlockBitmapSelectZero(i, pos, &pos)) {
       std::cerr << "Insufficient number of zeros in block bitmap " << i
                 << std::endl;
       exit(EXIT_FAILURE);
@@ -304,14 +298,13 @@ size_t FingerprintStore::GetNumItemsInBucket(const size_t bucket_idx) const {
 size_t FingerprintStore::GetIndexOfFingerprintInBlock(
     const size_t block_idx, const size_t idx_in_compacted_bitmap,
     const size_t slot_idx) const {
-  assert(block_idx < block_bitmaps_.size());
-  const Bitmap64Ptr& block_bitmap = block_bitmaps_[block_idx];
-  assert(idx_in_compacted_bitmap < block_bitmap->bits());
+  assert(block_idx < blocks_.size());
+  assert(idx_in_compacted_bitmap < BlockBitmapBits(block_idx));
 
   // For one slot per bucket, the index is simply the rank of
   // `idx_in_compacted_bitmap` in the block bitmap `block_idx`.
   if (slots_per_bucket_ == 1)
-    return GetRank(*block_bitmap, idx_in_compacted_bitmap);
+    return BlockBitmapRank(block_idx, idx_in_compacted_bitmap);
 
   // For multiple slots per bucket, we need to perform a few extra steps (these
   // are required since we only maintain one bit per bucket in the block bitmaps
@@ -325,8 +318,8 @@ size_t FingerprintStore::GetIndexOfFingerprintInBlock(
   // (2) We count the number occupied slots in these buckets (=> `count`).
 
   size_t count = 0;
-  for (const size_t bit_idx : block_bitmap->TrueBitIndices()) {
-    if (bit_idx >= idx_in_compacted_bitmap) break;
+  for (size_t bit_idx = 0; bit_idx < idx_in_compacted_bitmap; ++bit_idx) {
+    if (!BlockBitmapGet(block_idx, bit_idx)) continue;
     const size_t corr_bucket_idx = GetBucketIndex(block_idx, bit_idx);  // (1)
     count += GetNumItemsInBucket(corr_bucket_idx);                      // (2)
   }
@@ -346,31 +339,32 @@ size_t FingerprintStore::GetIndexOfFingerprintInBlock(
   return count - num_empty_slots + (slot_idx % slots_per_bucket_);  // (4)
 }
 
-size_t FingerprintStore::MapBucketIndexToBitInBlockBitmap(
-    const size_t bucket_idx, const size_t block_bitmap_idx) const {
-  assert(block_bitmap_idx <= block_bitmaps_.size());
-  size_t curr_idx = bucket_idx;
-  // Keep subtracting curr_bitmap.Rank(curr_idx) from `curr_idx`. In one
-  // iteration, we map `curr_idx` (which corresponds to a bit in the current
-  // bitmap) to its index (bit) in the next bitmap. We continue this procedure
-  // up to (exclusive) the bitmap at `block_bitmap_idx`.
-  for (size_t i = 0; i < block_bitmap_idx; ++i) {
-    const Bitmap64Ptr& curr_bitmap = block_bitmaps_[i];
-    const size_t rank = GetRank(*curr_bitmap, curr_idx);
-    assert(curr_idx >= rank);
-    curr_idx -= rank;
+bool FingerprintStore::BlockBitmapSelectZero(const size_t block_idx,
+                                             const size_t ith,
+                                             size_t* pos) const {
+  size_t count = 0;
+  for (size_t i = 0; i < BlockBitmapBits(block_idx); ++i) {
+    if (!BlockBitmapGet(block_idx, i)) {
+      if (count == ith) {
+        *pos = i;
+        return true;
+      }
+      ++count;
+    }
   }
-  return curr_idx;
+  return false;
 }
 
 void FingerprintStore::CreateAndCompactBlockBitmaps(
     const std::vector<size_t>& lengths,
     absl::flat_hash_map<size_t, BlockContent>* blocks) {
+  std::vector<Bitmap64Ptr> compacted_bitmaps;
+
   // Create block bitmap for first block (which cannot be compacted).
   if (!lengths.empty()) {
     Bitmap64Ptr& first_block_bitmap = (*blocks)[lengths[0]].block_bitmap;
     first_block_bitmap->InitRankLookupTable();
-    block_bitmaps_.push_back(std::move(first_block_bitmap));
+    compacted_bitmaps.push_back(std::move(first_block_bitmap));
   }
 
   // Create and compact block bitmaps for all remaining blocks.
@@ -378,18 +372,67 @@ void FingerprintStore::CreateAndCompactBlockBitmaps(
     const size_t length = lengths[i];
     const Bitmap64Ptr& curr_bitmap = (*blocks)[length].block_bitmap;
     const size_t num_bits_compacted_bitmap =
-        block_bitmaps_.back()->GetZeroesCount();
+        compacted_bitmaps.back()->GetZeroesCount();
     Bitmap64Ptr compacted_bitmap =
         absl::make_unique<Bitmap64>(/*size=*/num_bits_compacted_bitmap);
     for (const size_t bucket_idx : curr_bitmap->TrueBitIndices()) {
       // Map `bucket_idx` to index in compacted block bitmap.
-      const size_t idx_in_compacted_bitmap =
-          MapBucketIndexToBitInBlockBitmap(bucket_idx, block_bitmaps_.size());
+      const size_t idx_in_compacted_bitmap = MapBucketIndexToBitInBlockBitmap(
+          compacted_bitmaps, bucket_idx, compacted_bitmaps.size());
       compacted_bitmap->Set(idx_in_compacted_bitmap, true);
     }
     compacted_bitmap->InitRankLookupTable();
-    block_bitmaps_.push_back(std::move(compacted_bitmap));
+    compacted_bitmaps.push_back(std::move(compacted_bitmap));
+  }
+
+  // Concatenate the compacted bitmaps and build a single rank directory.
+  block_bitmap_offsets_.push_back(0);
+  block_bitmap_ranks_.push_back(0);
+  for (const Bitmap64Ptr& bitmap : compacted_bitmaps) {
+    block_bitmap_offsets_.push_back(block_bitmap_offsets_.back() +
+                                    bitmap->bits());
+    block_bitmap_ranks_.push_back(block_bitmap_ranks_.back() +
+                                  bitmap->GetOnesCount());
+  }
+  block_bitmaps_ =
+      absl::make_unique<Bitmap64>(Bitmap64::GetGlobalBitmap(compacted_bitmaps));
+  block_bitmaps_->InitRankLookupTable();
+}
+
+void FingerprintStore::CreateBlocks(
+    const std::vector<size_t>& lengths,
+    const absl::flat_hash_map<size_t, BlockContent>& blocks) {
+  ByteBuffer buffer;
+  blocks_.reserve(lengths.size());
+  for (const size_t length : lengths) {
+    const std::vector<uint64_t>& fingerprints = blocks.at(length).fingerprints;
+
+    // No need to encode `num_fingerprints`. Can be reconstructed from the
+    // block bitmap.
+    const uint32_t bit_width =
+        MaxBitWidth<uint64_t>(absl::MakeConstSpan(fingerprints));
+    if (bit_width > length) {
+      std::cerr << "Maximum bit width is " << bit_width
+                << ", but expected at most " << length << " bits.";
+      std::exit(-1);
+    }
+
+    blocks_.emplace_back(length, bit_width, /*offset=*/buffer.pos(),
+                         fingerprints.size());
+    StoreBitPacked<uint64_t>(fingerprints, bit_width, &buffer);
   }
+  // Since all blocks are stored consecutively, a single set of slop bytes
+  // suffices.
+  PutSlopBytes(&buffer);
+
+  // Copy the blocks to the cache-line-aligned arena.
+  arena_size_ = buffer.pos();
+  arena_.resize((arena_size_ + kCacheLineSize - 1) / kCacheLineSize);
+  std::memcpy(arena_.data(), buffer.data(), arena_size_);
+
+  // Set BitPackedReaders.
+  const char* arena = reinterpret_cast<const char*>(arena_.data());
+  for (Block& block : blocks_) block.SetArena(arena);
 }
 
 }  // namespace ci
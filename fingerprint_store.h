@@ -23,27 +23,36 @@
 #include <climits>
 #include <cstdlib>
 #include <memory>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "cuckoo_utils.h"
 #include "evaluation_utils.h"
 
 namespace ci {
 
-// Stores fingerprints with a fixed number of bits (`num_bits`). The maximum bit
-// width of `fingerprints` has to be at most `num_bits` bits.
+// Describes a block of fingerprints with a fixed number of bits (`num_bits`).
+// The bit-packed fingerprints themselves are not owned by the block, they live
+// in the contiguous arena of the enclosing FingerprintStore at byte `offset`.
 class Block {
  public:
-  explicit Block(const size_t num_bits,
-                 const std::vector<uint64_t>& fingerprints);
-
-  // Forbid copying and moving.
-  Block(const Block&) = delete;
-  Block& operator=(const Block&) = delete;
-  Block(Block&&) = delete;
-  Block& operator=(Block&&) = delete;
+  Block(const size_t num_bits, const int bit_width, const size_t offset,
+        const size_t num_fingerprints)
+      : num_bits_(num_bits),
+        bit_width_(bit_width),
+        offset_(offset),
+        num_fingerprints_(num_fingerprints) {}
+
+  // Points the reader of this block to its fingerprints in `arena`.
+  void SetArena(const char* arena) {
+    fingerprints_ = BitPackedReader<uint64_t>(bit_width_, arena + offset_);
+  }
 
   size_t num_bits() const { return num_bits_; }
+  int bit_width() const { return bit_width_; }
+  size_t offset() const { return offset_; }
+  size_t num_fingerprints() const { return num_fingerprints_; }
 
   // Returns the fingerprint bits stored at `idx`.
   uint64_t Get(const size_t idx) const {
@@ -51,14 +60,16 @@ class Block {
     return fingerprints_.Get(idx);
   }
 
-  const std::string& GetData() const { return data_; }
-
  private:
   // The number of bits of fingerprints stored in this block.
-  const size_t num_bits_;
-  const size_t num_fingerprints_;
+  size_t num_bits_;
+  // The actual bit width of the bit-packed fingerprints (could theoretically be
+  // lower than `num_bits_`).
+  int bit_width_;
+  // Byte offset of the bit-packed fingerprints in the arena.
+  size_t offset_;
+  size_t num_fingerprints_;
 
-  std::string data_;
   BitPackedReader<uint64_t> fingerprints_;
 };
 
@@ -87,20 +98,28 @@ class Block {
 // Block bitmap 1: 101   -- of the 3 remaining fingerprints no. 0 and 2 are here
 // Block bitmap 2: 1     -- only one remaining fingerprint
 //
-// Specifically, we encode all block bitmaps back-to-back as a single RLE
-// bitmap.
+// At runtime, all block bitmaps are kept back-to-back in a single bitmap with
+// one rank directory, and lookups rank directly into it. When serializing, we
+// encode this bitmap (without the "empty buckets block") as a single RLE or
+// dense bitmap.
 //
-// Individual blocks are stored as follows:
+// The bit-packed fingerprints of all blocks are stored back-to-back in a
+// single cache-line-aligned arena, which is serialized as-is. Blocks are
+// encoded as follows:
 //
-// uint32_t num_bits       -- number of bits of fingerprints in this block
-// uint32_t bit_width      -- actual bit width of fingerprints in this block
-// (could theoretically be lower)
-// .. bitpacked fingerprints ..
+// For each block:
+//   uint32_t num_bits     -- number of bits of fingerprints in this block
+//   uint32_t bit_width    -- actual bit width of fingerprints in this block
+//   (could theoretically be lower)
+// .. bitpacked fingerprints of all blocks ..
 // 8 'slop' bytes        -- to be able to read bit-packed 64-bit values, we need
 // to ensure that a whole uword_t can be read from the position of the last
 // encoded diff, hence we need to be able to read at most 7 bytes past it
 class FingerprintStore {
-  using BlockPtr = std::unique_ptr<Block>;
+  // A cache line of the fingerprint arena.
+  struct alignas(kCacheLineSize) CacheLine {
+    char bytes[kCacheLineSize];
+  };
 
   // A helper struct used during block creation.
   struct BlockContent {
@@ -119,6 +138,12 @@ class FingerprintStore {
                             const size_t slots_per_bucket,
                             const bool use_rle_to_encode_block_bitmaps);
 
+  // Forbid copying and moving (blocks point into `arena_`).
+  FingerprintStore(const FingerprintStore&) = delete;
+  FingerprintStore& operator=(const FingerprintStore&) = delete;
+  FingerprintStore(FingerprintStore&&) = delete;
+  FingerprintStore& operator=(FingerprintStore&&) = delete;
+
   // Returns fingerprint stored in slot `slot_idx`.
   Fingerprint GetFingerprint(const size_t slot_idx) const;
 
@@ -152,6 +177,13 @@ class FingerprintStore {
 
   size_t GetNumBlocks() const { return blocks_.size(); }
 
+  // Returns the arena holding the bit-packed fingerprints of all blocks
+  // (including the trailing slop bytes).
+  absl::string_view GetArena() const {
+    return absl::string_view(reinterpret_cast<const char*>(arena_.data()),
+                             arena_size_);
+  }
+
   void PrintStats() const;
 
  private:
@@ -170,26 +202,70 @@ class FingerprintStore {
                                       const size_t idx_in_compacted_bitmap,
                                       const size_t slot_idx) const;
 
-  // Maps `bucket_idx` to its corresponding index (bit) in the block bitmap
-  // `block_bitmap_idx`.
-  size_t MapBucketIndexToBitInBlockBitmap(const size_t bucket_idx,
-                                          const size_t block_bitmap_idx) const;
+  // Returns the number of bits of block bitmap `block_idx`.
+  size_t BlockBitmapBits(const size_t block_idx) const {
+    return block_bitmap_offsets_[block_idx + 1] -
+           block_bitmap_offsets_[block_idx];
+  }
+
+  // Returns the number of set bits of block bitmap `block_idx`.
+  size_t BlockBitmapOnesCount(const size_t block_idx) const {
+    return block_bitmap_ranks_[block_idx + 1] - block_bitmap_ranks_[block_idx];
+  }
+
+  // Returns bit `bit_idx` of block bitmap `block_idx`.
+  bool BlockBitmapGet(const size_t block_idx, const size_t bit_idx) const {
+    assert(bit_idx < BlockBitmapBits(block_idx));
+    return block_bitmaps_->Get(block_bitmap_offsets_[block_idx] + bit_idx);
+  }
+
+  // Returns the rank of `bit_idx` in block bitmap `block_idx`, i.e., the number
+  // of set bits in [0, bit_idx).
+  size_t BlockBitmapRank(const size_t block_idx, const size_t bit_idx) const {
+    assert(bit_idx <= BlockBitmapBits(block_idx));
+    return block_bitmaps_->GetOnesCountBeforeLimit(
+               block_bitmap_offsets_[block_idx] + bit_idx) -
+           block_bitmap_ranks_[block_idx];
+  }
+
+  // Sets `pos` to the position of the `ith` zero-bit in block bitmap
+  // `block_idx`. Returns false if there are not enough zero-bits.
+  bool BlockBitmapSelectZero(const size_t block_idx, const size_t ith,
+                             size_t* pos) const;
 
   // Creates and compacts block bitmaps in `lengths` order. The idea is to
   // "leave out" bits in subsequent block bitmaps, specifically those that are
-  // set in the previous (already compacted) block bitmap.
+  // set in the previous (already compacted) block bitmap. The compacted
+  // bitmaps are concatenated into `block_bitmaps_`.
   void CreateAndCompactBlockBitmaps(
       const std::vector<size_t>& lengths,
       absl::flat_hash_map<size_t, BlockContent>* blocks);
 
+  // Bit-packs the fingerprints of all blocks back-to-back (in `lengths` order)
+  // into `arena_` and creates the corresponding `blocks_`.
+  void CreateBlocks(const std::vector<size_t>& lengths,
+                    const absl::flat_hash_map<size_t, BlockContent>& blocks);
+
   // A bitmap indicating empty slots.
   Bitmap64Ptr empty_slots_bitmap_;
 
-  // Bitmaps indicating which slot is stored in which block. A subsequent bitmap
-  // has `prev.GetOnesCount()` fewer bits than its predecessor.
-  // TODO: Replace with a single RLE bitmap.
-  std::vector<Bitmap64Ptr> block_bitmaps_;
-  std::vector<BlockPtr> blocks_;
+  // Bitmaps indicating which slot is stored in which block, concatenated into
+  // a single bitmap with one rank directory. A subsequent bitmap has
+  // `prev.GetOnesCount()` fewer bits than its predecessor.
+  Bitmap64Ptr block_bitmaps_;
+  // Bit offset of each block bitmap in `block_bitmaps_`, followed by the total
+  // number of bits.
+  std::vector<size_t> block_bitmap_offsets_;
+  // Number of set bits in `block_bitmaps_` before each entry of
+  // `block_bitmap_offsets_`.
+  std::vector<size_t> block_bitmap_ranks_;
+
+  std::vector<Block> blocks_;
+  // Bit-packed fingerprints of all blocks, stored back-to-back and followed by
+  // a single set of slop bytes.
+  std::vector<CacheLine> arena_;
+  // Number of used bytes in `arena_`.
+  size_t arena_size_;
 
   const size_t num_slots_;
   size_t num_stored_fingerprints_;
@@ -128,4 +128,30 @@ TEST(FingerprintStore,
                                 /*use_rle_to_encode_block_bitmaps=*/false);
 }
 
+TEST(FingerprintStore,
+     GetFingerprintReturnsCorrectFingerprintManyBlocksFourSlotsPerBucket) {
+  CreateStoreAndGetFingerprints(/*lengths=*/{1, 3, 5, 7, 9, 11, 13, 17, 23, 30},
+                                /*slots_per_bucket=*/4,
+                                /*use_rle_to_encode_block_bitmaps=*/true);
+}
+
+TEST(FingerprintStore, BlocksAreStoredInSingleAlignedArena) {
+  const std::vector<Fingerprint> fingerprints = CreateRandomFingerprints(
+      kNumFingerprints, /*slots_per_bucket=*/1, /*lengths=*/{1, 2, 4, 8, 16});
+  const FingerprintStore store(fingerprints, /*slots_per_bucket=*/1,
+                               /*use_rle_to_encode_block_bitmaps=*/false);
+  const absl::string_view arena = store.GetArena();
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(arena.data()) % kCacheLineSize, 0);
+
+  // The arena holds the bit-packed fingerprints of all blocks followed by a
+  // single set of slop bytes.
+  size_t num_fingerprint_bits = 0;
+  for (const Fingerprint& fp : fingerprints) {
+    if (fp.active) num_fingerprint_bits += fp.num_bits;
+  }
+  EXPECT_GE(arena.size(), num_fingerprint_bits / CHAR_BIT + sizeof(uint64_t));
+  EXPECT_LE(arena.size(), num_fingerprint_bits / CHAR_BIT +
+                              store.GetNumBlocks() + sizeof(uint64_t));
+}
+
 }  // namespace ci
@@ -22,13 +22,25 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/types/span.h"
 #include "data.h"
 #include "evaluation.pb.h"
 
 namespace ci {
 
 // Class representing an index structure, e.g. based on a Bloom filter.
+//
+// Index structures are immutable once created. All const lookup methods (e.g.,
+// StripeContains(..) and GetQualifyingStripes(..)) have to be safe to call
+// concurrently from multiple threads without external locking. In particular,
+// they must not modify (lazily initialized) members. They may only profile
+// with ScopedProfiles of lookup counters (e.g., Counter::Lookup), which are
+// no-ops unless enabled with Profiler::SetLookupProfilingEnabled(..). This is
+// thread-safe since every thread only writes to its own Profiler instance
+// (see Profiler), but adds overhead to every lookup. Implementations that do
+// keep mutable state (e.g., CachingIndex) have to synchronize it internally.
 class IndexStructure {
  public:
   IndexStructure() {}
@@ -52,6 +64,52 @@ class IndexStructure {
     return result;
   }
 
+  // Returns a bitmap indicating possibly qualifying stripes for any of the
+  // given `values` (i.e., for an IN-list predicate). Probes up to
+  // `num_stripes` stripes.
+  virtual Bitmap64 GetQualifyingStripesIn(absl::Span<const int> values,
+                                          size_t num_stripes) const {
+    Bitmap64 result(/*size=*/num_stripes);
+    for (const int value : values)
+      result |= GetQualifyingStripes(value, num_stripes);
+    return result;
+  }
+
+  // Returns one bitmap of possibly qualifying stripes per value in `values`
+  // (i.e., for a batch of point lookups). Probes up to `num_stripes` stripes.
+  // Note: classes extending IndexStructure can override this method when they
+  // can share work across the values (see ZoneMap for an example).
+  virtual std::vector<Bitmap64> GetQualifyingStripesBatch(
+      absl::Span<const int> values, size_t num_stripes) const {
+    std::vector<Bitmap64> result;
+    result.reserve(values.size());
+    for (const int value : values)
+      result.push_back(GetQualifyingStripes(value, num_stripes));
+    return result;
+  }
+
+  // Returns the subset of `candidate_stripes` that possibly qualifies for the
+  // given `value` (i.e., `candidate_stripes` AND the qualifying stripes). Only
+  // needs to probe stripes set in `candidate_stripes`.
+  virtual Bitmap64 GetQualifyingStripesAmong(
+      int value, const Bitmap64& candidate_stripes) const {
+    // Default implementation for per-stripe index structures.
+    Bitmap64 result(/*size=*/candidate_stripes.bits());
+    for (const size_t stripe_id : candidate_stripes.TrueBitIndices()) {
+      if (StripeContains(stripe_id, value)) result.Set(stripe_id, true);
+    }
+    return result;
+  }
+
+  // Returns an estimate of the share of the `num_stripes` stripes that
+  // qualify for the given `value` (1.0 if unknown). Used to order probes by
+  // selectivity, so implementations should be cheap compared to
+  // GetQualifyingStripes(..).
+  virtual double EstimateSelectivity(int /*value*/,
+                                     size_t /*num_stripes*/) const {
+    return 1.0;
+  }
+
   // Returns the name of the index structure.
   virtual std::string name() const = 0;
 
@@ -0,0 +1,184 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: inverted_stripe_index.cc
+// -----------------------------------------------------------------------------
+
+#include "inverted_stripe_index.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <utility>
+
+#include "evaluation_utils.h"
+
+namespace ci {
+
+InvertedStripeIndex::InvertedStripeIndex(absl::Span<const int> data,
+                                         std::size_t num_rows_per_stripe) {
+  num_stripes_ = data.size() / num_rows_per_stripe;
+
+  // Collect the distinct (value, stripe) pairs, grouped by value. Values are
+  // deduplicated per stripe first, so that only distinct pairs are kept in
+  // memory. NULLs are not indexed.
+  std::vector<std::pair<int, uint32_t>> pairs;
+  std::vector<int> values;
+  for (size_t stripe_id = 0; stripe_id < num_stripes_; ++stripe_id) {
+    const absl::Span<const int> stripe =
+        data.subspan(num_rows_per_stripe * stripe_id, num_rows_per_stripe);
+    values.assign(stripe.begin(), stripe.end());
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    for (const int value : values) {
+      if (value == Column::kIntNullSentinel) continue;
+      pairs.emplace_back(value, static_cast<uint32_t>(stripe_id));
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  std::vector<uint32_t> stripes;
+  for (size_t begin = 0; begin < pairs.size();) {
+    const int value = pairs[begin].first;
+    stripes.clear();
+    size_t end = begin;
+    for (; end < pairs.size() && pairs[end].first == value; ++end)
+      stripes.push_back(pairs[end].second);
+
+    values_.push_back(value);
+    bitmaps_.emplace_back(stripes.size(), stripes.data());
+    bitmaps_.back().runOptimize();
+    bitmaps_.back().shrinkToFit();
+    begin = end;
+  }
+}
+
+int64_t InvertedStripeIndex::Find(int value) const {
+  const auto it = std::lower_bound(values_.begin(), values_.end(), value);
+  if (it == values_.end() || *it != value) return -1;
+  return it - values_.begin();
+}
+
+Bitmap64 InvertedStripeIndex::ToBitmap64(const Roaring& bitmap,
+                                         std::size_t num_stripes) {
+  std::vector<uint64_t> words((num_stripes + 63) / 64, 0);
+  // Stripe ids are visited in increasing order.
+  for (const uint32_t stripe_id : bitmap) {
+    if (stripe_id >= num_stripes) break;
+    words[stripe_id / 64] |= uint64_t{1} << (stripe_id % 64);
+  }
+  return Bitmap64::FromWords(words.data(), num_stripes);
+}
+
+bool InvertedStripeIndex::StripeContains(std::size_t stripe_id,
+                                         int value) const {
+  if (stripe_id >= num_stripes_) {
+    std::cerr << "`stripe_id` is out of bounds." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const int64_t index = Find(value);
+  return index != -1 &&
+         bitmaps_[index].contains(static_cast<uint32_t>(stripe_id));
+}
+
+Bitmap64 InvertedStripeIndex::GetQualifyingStripes(
+    int value, std::size_t num_stripes) const {
+  const int64_t index = Find(value);
+  if (index == -1) return Bitmap64(/*size=*/num_stripes);
+  return ToBitmap64(bitmaps_[index], num_stripes);
+}
+
+Bitmap64 InvertedStripeIndex::GetQualifyingStripesIn(
+    absl::Span<const int> values, std::size_t num_stripes) const {
+  Roaring result;
+  for (const int value : values) {
+    const int64_t index = Find(value);
+    if (index != -1) result |= bitmaps_[index];
+  }
+  return ToBitmap64(result, num_stripes);
+}
+
+Bitmap64 InvertedStripeIndex::GetQualifyingStripesAmong(
+    int value, const Bitmap64& candidate_stripes) const {
+  Bitmap64 result(/*size=*/candidate_stripes.bits());
+  const int64_t index = Find(value);
+  if (index == -1) return result;
+  for (const uint32_t stripe_id : bitmaps_[index]) {
+    if (stripe_id >= candidate_stripes.bits()) break;
+    if (candidate_stripes.Get(stripe_id)) result.Set(stripe_id, true);
+  }
+  return result;
+}
+
+double InvertedStripeIndex::EstimateSelectivity(int value,
+                                                std::size_t num_stripes) const {
+  if (num_stripes == 0) return 0.0;
+  const int64_t index = Find(value);
+  if (index == -1) return 0.0;
+  return std::min(1.0, static_cast<double>(bitmaps_[index].cardinality()) /
+                           num_stripes);
+}
+
+std::vector<Bitmap64> InvertedStripeIndex::GetQualifyingStripesBatch(
+    absl::Span<const int> values, std::size_t num_stripes) const {
+  std::vector<size_t> order(values.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return values[a] < values[b]; });
+
+  // Index of each value in `values_` (or -1).
+  std::vector<int64_t> indices(values.size(), -1);
+  auto it = values_.begin();
+  for (const size_t i : order) {
+    // Values are probed in increasing order, so the search can continue from
+    // the previous position.
+    it = std::lower_bound(it, values_.end(), values[i]);
+    if (it == values_.end()) break;
+    if (*it == values[i]) indices[i] = it - values_.begin();
+  }
+
+  std::vector<Bitmap64> result;
+  result.reserve(values.size());
+  for (const int64_t index : indices) {
+    result.push_back(index == -1 ? Bitmap64(/*size=*/num_stripes)
+                                 : ToBitmap64(bitmaps_[index], num_stripes));
+  }
+  return result;
+}
+
+std::string InvertedStripeIndex::Serialize() const {
+  std::string data(reinterpret_cast<const char*>(values_.data()),
+                   values_.size() * sizeof(values_[0]));
+  for (const Roaring& bitmap : bitmaps_) {
+    const size_t offset = data.size();
+    data.resize(offset + bitmap.getSizeInBytes(/*portable=*/true));
+    bitmap.write(&data[offset], /*portable=*/true);
+  }
+  return data;
+}
+
+size_t InvertedStripeIndex::byte_size() const {
+  size_t result = values_.size() * sizeof(values_[0]);
+  for (const Roaring& bitmap : bitmaps_)
+    result += bitmap.getSizeInBytes(/*portable=*/true);
+  return result;
+}
+
+size_t InvertedStripeIndex::compressed_byte_size() const {
+  return Compress(Serialize()).size();
+}
+
+}  // namespace ci
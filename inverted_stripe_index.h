@@ -0,0 +1,110 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: inverted_stripe_index.h
+// -----------------------------------------------------------------------------
+//
+// An exact index mapping each distinct value of a column to the Roaring bitmap
+// of stripes containing it. Has no false positive stripes, so its scan rate is
+// a lower bound for the other (probabilistic or range-based) index structures.
+// For low- to mid-cardinality columns it's often also smaller than them.
+//
+// The distinct values are stored as a sorted array (looked up by binary
+// search), next to one run-optimized Roaring bitmap per value.
+
+#ifndef CUCKOO_INDEX_INVERTED_STRIPE_INDEX_H_
+#define CUCKOO_INDEX_INVERTED_STRIPE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "common/bitmap.h"
+#include "data.h"
+#include "index_structure.h"
+#include "roaring.hh"
+
+namespace ci {
+
+class InvertedStripeIndex : public IndexStructure {
+ public:
+  InvertedStripeIndex(absl::Span<const int> data,
+                      std::size_t num_rows_per_stripe);
+
+  bool StripeContains(std::size_t stripe_id, int value) const override;
+
+  Bitmap64 GetQualifyingStripes(int value,
+                                std::size_t num_stripes) const override;
+
+  Bitmap64 GetQualifyingStripesIn(absl::Span<const int> values,
+                                  std::size_t num_stripes) const override;
+
+  Bitmap64 GetQualifyingStripesAmong(
+      int value, const Bitmap64& candidate_stripes) const override;
+
+  // Sorts the values and looks them up in a single merge pass over the value
+  // array.
+  std::vector<Bitmap64> GetQualifyingStripesBatch(
+      absl::Span<const int> values, std::size_t num_stripes) const override;
+
+  // Exact share of stripes containing `value`.
+  double EstimateSelectivity(int value, std::size_t num_stripes) const override;
+
+  std::string name() const override { return "InvertedStripeIndex"; }
+
+  // Size of the value array and the serialized bitmaps.
+  size_t byte_size() const override;
+
+  size_t compressed_byte_size() const override;
+
+  std::size_t num_stripes() const { return num_stripes_; }
+
+  std::size_t num_values() const { return values_.size(); }
+
+ private:
+  // Returns the index of `value` in `values_`, or -1 if not present.
+  int64_t Find(int value) const;
+
+  // Returns the stripes of `bitmap` among the first `num_stripes` ones.
+  static Bitmap64 ToBitmap64(const Roaring& bitmap, std::size_t num_stripes);
+
+  // Serializes `values_` and `bitmaps_`.
+  std::string Serialize() const;
+
+  std::size_t num_stripes_;
+  // Sorted distinct values.
+  std::vector<int> values_;
+  // Stripes containing `values_[i]`.
+  std::vector<Roaring> bitmaps_;
+};
+
+class InvertedStripeIndexFactory : public IndexStructureFactory {
+ public:
+  IndexStructurePtr Create(const Column& column,
+                           size_t num_rows_per_stripe) const override {
+    return absl::make_unique<InvertedStripeIndex>(column.data(),
+                                                  num_rows_per_stripe);
+  }
+
+  std::string index_name() const override { return "InvertedStripeIndex"; }
+};
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_INVERTED_STRIPE_INDEX_H_
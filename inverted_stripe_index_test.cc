@@ -0,0 +1,106 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: inverted_stripe_index_test.cc
+// -----------------------------------------------------------------------------
+
+#include "inverted_stripe_index.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ci {
+namespace {
+
+TEST(InvertedStripeIndexTest, StripeContainsIsExact) {
+  InvertedStripeIndex index(/*data=*/{1, 2, 3, 4, 1, 5},
+                            /*num_rows_per_stripe=*/2);
+  EXPECT_EQ(index.num_stripes(), 3);
+  EXPECT_EQ(index.num_values(), 5);
+
+  EXPECT_TRUE(index.StripeContains(/*stripe_id=*/0, /*value=*/1));
+  EXPECT_TRUE(index.StripeContains(/*stripe_id=*/0, /*value=*/2));
+  EXPECT_FALSE(index.StripeContains(/*stripe_id=*/0, /*value=*/3));
+  EXPECT_FALSE(index.StripeContains(/*stripe_id=*/1, /*value=*/1));
+  EXPECT_TRUE(index.StripeContains(/*stripe_id=*/2, /*value=*/1));
+  EXPECT_FALSE(index.StripeContains(/*stripe_id=*/2, /*value=*/6));
+}
+
+TEST(InvertedStripeIndexTest, NullValuesAreIgnored) {
+  InvertedStripeIndex index(
+      /*data=*/{1, Column::kIntNullSentinel, 3, 4, Column::kIntNullSentinel, 6},
+      /*num_rows_per_stripe=*/3);
+  EXPECT_EQ(index.num_values(), 4);
+  EXPECT_FALSE(index.StripeContains(/*stripe_id=*/0, Column::kIntNullSentinel));
+  EXPECT_FALSE(index.StripeContains(/*stripe_id=*/1, Column::kIntNullSentinel));
+  EXPECT_EQ(index.GetQualifyingStripes(Column::kIntNullSentinel,
+                                       /*num_stripes=*/2)
+                .GetOnesCount(),
+            0);
+}
+
+TEST(InvertedStripeIndexTest, LookupsMatchStripeContains) {
+  std::vector<int> data;
+  for (int i = 0; i < 3000; ++i) data.push_back((i * 37) % 101);
+  InvertedStripeIndex index(data, /*num_rows_per_stripe=*/20);
+  const size_t num_stripes = index.num_stripes();
+
+  std::vector<int> values;
+  for (int value = -5; value < 110; ++value) values.push_back(value);
+  const std::vector<Bitmap64> batch =
+      index.GetQualifyingStripesBatch(values, num_stripes);
+  ASSERT_EQ(batch.size(), values.size());
+
+  Bitmap64 candidates(/*size=*/num_stripes);
+  for (size_t stripe_id = 0; stripe_id < num_stripes; stripe_id += 3)
+    candidates.Set(stripe_id, true);
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    const int value = values[i];
+    const Bitmap64 stripes = index.GetQualifyingStripes(value, num_stripes);
+    const Bitmap64 among = index.GetQualifyingStripesAmong(value, candidates);
+    size_t count = 0;
+    for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+      const bool contains = index.StripeContains(stripe_id, value);
+      count += contains;
+      ASSERT_EQ(stripes.Get(stripe_id), contains);
+      ASSERT_EQ(batch[i].Get(stripe_id), contains);
+      ASSERT_EQ(among.Get(stripe_id), contains && candidates.Get(stripe_id));
+    }
+    EXPECT_DOUBLE_EQ(index.EstimateSelectivity(value, num_stripes),
+                     static_cast<double>(count) / num_stripes);
+  }
+
+  Bitmap64 expected_in(/*size=*/num_stripes);
+  for (const int value : {3, 50, 200}) {
+    expected_in |= index.GetQualifyingStripes(value, num_stripes);
+  }
+  EXPECT_EQ(index.GetQualifyingStripesIn({3, 50, 200}, num_stripes)
+                .TrueBitIndices(),
+            expected_in.TrueBitIndices());
+}
+
+TEST(InvertedStripeIndexTest, ProbesPrefixOfStripes) {
+  InvertedStripeIndex index(/*data=*/{1, 2, 1, 2, 1, 2},
+                            /*num_rows_per_stripe=*/2);
+  const Bitmap64 stripes = index.GetQualifyingStripes(/*value=*/1,
+                                                      /*num_stripes=*/2);
+  EXPECT_EQ(stripes.bits(), 2);
+  EXPECT_EQ(stripes.TrueBitIndices(), (std::vector<size_t>{0, 1}));
+}
+
+}  // namespace
+}  // namespace ci
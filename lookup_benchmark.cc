@@ -60,25 +60,30 @@
 // NegativeLookup/Color/65536/PerStripeXor                           895 ns
 
 #include <cstdlib>
+#include <fstream>
 #include <random>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/random/distributions.h"
+#include "absl/time/clock.h"
 #include "benchmark/benchmark.h"
+#include "caching_index.h"
+#include "common/perf_counters.h"
 #include "cuckoo_index.h"
 #include "cuckoo_utils.h"
 #include "index_structure.h"
+#include "inverted_stripe_index.h"
+#include "per_stripe_binary_fuse.h"
 #include "per_stripe_bloom.h"
 #include "per_stripe_xor.h"
+#include "table_flags.h"
+#include "zone_map.h"
+#include "zone_map_cuckoo_index.h"
 
-ABSL_FLAG(int, generate_num_values, 100000,
-"Number of values to generate (number of rows).");
-ABSL_FLAG(int, num_unique_values, 1000,
-"Number of unique values to generate (cardinality).");
-ABSL_FLAG(std::string, input_csv_path, "", "Path to the input CSV file.");
-ABSL_FLAG(std::vector<std::string>, columns_to_test, {},
-          "Comma-separated list of columns to tests, e.g. "
-          "'company_name,country_code'.");
+ABSL_FLAG(int, max_threads, 1,
+          "If > 1, additionally runs multi-threaded lookup benchmarks with "
+          "1, 2, 4, .. up to `max_threads` threads.");
 ABSL_FLAG(std::string, sorting, "NONE",
           "Sorting to apply to the data. Supported values: 'NONE', "
           "'BY_CARDINALITY' (sorts lexicographically, starting with columns "
@@ -118,6 +123,7 @@ void BM_PositiveDistinctLookup(const ci::Column& column,
     values.push_back(distinct_values[distinct_values_offset_d(gen)]);
   }
 
+  ci::ScopedPerfCounters perf_counters(state);
   while (state.KeepRunningBatch(values.size())) {
     for (size_t i = 0; i < values.size(); ++i) {
       ::benchmark::DoNotOptimize(index->GetQualifyingStripes(values[i],
@@ -143,6 +149,7 @@ void BM_NegativeLookup(const ci::Column& column,
     values.push_back(value);
   }
 
+  ci::ScopedPerfCounters perf_counters(state);
   while (state.KeepRunningBatch(values.size())) {
     for (size_t i = 0; i < values.size(); ++i) {
       ::benchmark::DoNotOptimize(index->GetQualifyingStripes(values[i],
@@ -151,30 +158,195 @@ void BM_NegativeLookup(const ci::Column& column,
   }
 }
 
+void BM_PositiveZipfLookup(const ci::Column& column,
+                           std::shared_ptr<ci::IndexStructure> index,
+                           const int num_stripes, benchmark::State& state) {
+  std::mt19937 gen(42);
+  std::vector<int> distinct_values = column.distinct_values();
+  // Remove NULLs from the lookup.
+  distinct_values.erase(
+      std::remove(distinct_values.begin(), distinct_values.end(),
+                  ci::Column::kIntNullSentinel),
+      distinct_values.end());
+  // Shuffle the values, so that hot values are not clustered in the domain.
+  std::shuffle(distinct_values.begin(), distinct_values.end(), gen);
+
+  std::vector<int> values;
+  values.reserve(kLookupBatchSize);
+  for (size_t i = 0; i < kLookupBatchSize; ++i) {
+    // Same distribution as Evaluator::DoPositiveZipfLookups(..).
+    const size_t offset =
+        absl::Zipf(gen, distinct_values.size() - 1, /*q=*/2.0);
+    values.push_back(distinct_values[offset]);
+  }
+
+  // The index is shared by all runs of the benchmark. Start each run with an
+  // empty cache, so that the hit rate only covers this run's lookups.
+  auto* caching_index = dynamic_cast<ci::CachingIndex*>(index.get());
+  if (caching_index != nullptr) caching_index->Clear();
+
+  {
+    ci::ScopedPerfCounters perf_counters(state);
+    while (state.KeepRunningBatch(values.size())) {
+      for (size_t i = 0; i < values.size(); ++i) {
+        ::benchmark::DoNotOptimize(index->GetQualifyingStripes(values[i],
+                                                               num_stripes));
+      }
+    }
+  }
+
+  // Report the hit rate for cached indexes.
+  if (caching_index != nullptr) {
+    const size_t num_lookups =
+        caching_index->num_hits() + caching_index->num_misses();
+    state.counters["hit_rate"] =
+        num_lookups == 0
+            ? 0.0
+            : static_cast<double>(caching_index->num_hits()) / num_lookups;
+  }
+}
+
+// Minimum duration of measuring the single-threaded throughput.
+constexpr int64_t kMinBaselineNanos = 200'000'000;
+
+// Returns the throughput (lookups per second) of looking up `values` (in a
+// loop) from a single thread. Serves as the baseline of the scaling efficiency
+// of multi-threaded lookups, measured once before running any benchmark.
+double MeasureSingleThreadThroughput(const ci::IndexStructure& index,
+                                     const std::vector<int>& values,
+                                     const int num_stripes) {
+  size_t i = 0;
+  size_t num_lookups = 0;
+  const int64_t start = absl::GetCurrentTimeNanos();
+  int64_t end = start;
+  while (end - start < kMinBaselineNanos) {
+    // Only check the time every 1024 lookups.
+    for (size_t j = 0; j < 1024; ++j) {
+      ::benchmark::DoNotOptimize(
+          index.GetQualifyingStripes(values[i], num_stripes));
+      if (++i == values.size()) i = 0;
+    }
+    num_lookups += 1024;
+    end = absl::GetCurrentTimeNanos();
+  }
+  return 1e9 * num_lookups / (end - start);
+}
+
+// Returns the index of the calling benchmark thread. Newer versions of the
+// benchmark library turned `State::thread_index` into a method.
+template <typename State>
+auto GetThreadIndex(const State& state) -> decltype(state.thread_index()) {
+  return state.thread_index();
+}
+template <typename State>
+auto GetThreadIndex(const State& state) -> decltype(state.thread_index + 0) {
+  return state.thread_index;
+}
+
+// Positive lookups of distinct values from multiple threads on the same
+// `index`. Reports the aggregate throughput (items_per_second) and the scaling
+// efficiency, i.e., the average per-thread throughput relative to
+// `single_thread_throughput`.
+void BM_MultiThreadedPositiveDistinctLookup(
+    std::shared_ptr<ci::IndexStructure> index,
+    std::shared_ptr<const std::vector<int>> values, const int num_stripes,
+    const double single_thread_throughput, benchmark::State& state) {
+  // Each thread starts at a different offset, fixed across runs.
+  size_t i = (GetThreadIndex(state) * 7919) % values->size();
+
+  int64_t start;
+  int64_t end;
+  {
+    // Counters are per thread and summed up across threads by the benchmark
+    // library.
+    ci::ScopedPerfCounters perf_counters(state);
+    start = absl::GetCurrentTimeNanos();
+    for (auto _ : state) {
+      ::benchmark::DoNotOptimize(
+          index->GetQualifyingStripes((*values)[i], num_stripes));
+      if (++i == values->size()) i = 0;
+    }
+    end = absl::GetCurrentTimeNanos();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  const double throughput =
+      end > start ? 1e9 * state.iterations() / (end - start) : 0.0;
+  // Averaged over all threads.
+  state.counters["scaling_efficiency"] = benchmark::Counter(
+      throughput / single_thread_throughput, benchmark::Counter::kAvgThreads);
+}
+
+// Number of IN-lists to look up per batch.
+constexpr size_t kNumInLists = 1000;
+
+void BM_InListLookup(const ci::Column& column,
+                     std::shared_ptr<ci::IndexStructure> index,
+                     const int num_stripes, const size_t in_list_size,
+                     benchmark::State& state) {
+  std::mt19937 gen(42);
+  const std::vector<int> distinct_values = column.distinct_values();
+  std::uniform_int_distribution<std::size_t> distinct_values_offset_d(
+      0, distinct_values.size() - 1);
+
+  // Each IN-list contains (mostly) positive values.
+  std::vector<std::vector<int>> in_lists(kNumInLists);
+  for (std::vector<int>& in_list : in_lists) {
+    in_list.reserve(in_list_size);
+    for (size_t i = 0; i < in_list_size; ++i)
+      in_list.push_back(distinct_values[distinct_values_offset_d(gen)]);
+  }
+
+  ci::ScopedPerfCounters perf_counters(state);
+  while (state.KeepRunningBatch(in_lists.size())) {
+    for (const std::vector<int>& in_list : in_lists) {
+      ::benchmark::DoNotOptimize(
+          index->GetQualifyingStripesIn(in_list, num_stripes));
+    }
+  }
+}
+
+// Number of batches of point lookups per run.
+constexpr size_t kNumLookupBatches = 1000;
+
+// Positive lookups of distinct values in batches of `batch_size` values (see
+// IndexStructure::GetQualifyingStripesBatch(..)).
+void BM_BatchLookup(const ci::Column& column,
+                    std::shared_ptr<ci::IndexStructure> index,
+                    const int num_stripes, const size_t batch_size,
+                    benchmark::State& state) {
+  std::mt19937 gen(42);
+  std::vector<int> distinct_values = column.distinct_values();
+  // Remove NULLs from the lookup.
+  distinct_values.erase(
+      std::remove(distinct_values.begin(), distinct_values.end(),
+                  ci::Column::kIntNullSentinel),
+      distinct_values.end());
+  std::uniform_int_distribution<std::size_t> distinct_values_offset_d(
+      0, distinct_values.size() - 1);
+
+  std::vector<std::vector<int>> batches(kNumLookupBatches);
+  for (std::vector<int>& batch : batches) {
+    batch.reserve(batch_size);
+    for (size_t i = 0; i < batch_size; ++i)
+      batch.push_back(distinct_values[distinct_values_offset_d(gen)]);
+  }
+
+  ci::ScopedPerfCounters perf_counters(state);
+  // Counts single lookups, so that the results compare to the other benchmarks.
+  while (state.KeepRunningBatch(batches.size() * batch_size)) {
+    for (const std::vector<int>& batch : batches) {
+      ::benchmark::DoNotOptimize(
+          index->GetQualifyingStripesBatch(batch, num_stripes));
+    }
+  }
+}
+
 int main(int argc, char* argv[]) {
   absl::ParseCommandLine(argc, argv);
 
-  const size_t generate_num_values = absl::GetFlag(FLAGS_generate_num_values);
-  const size_t num_unique_values = absl::GetFlag(FLAGS_num_unique_values);
-  const std::string input_csv_path = absl::GetFlag(FLAGS_input_csv_path);
-  const std::vector<std::string>
-      columns_to_test = absl::GetFlag(FLAGS_columns_to_test);
-
   // Define data.
-  std::unique_ptr<ci::Table> table;
-  if (input_csv_path.empty() || columns_to_test.empty()) {
-    std::cerr
-        << "[WARNING] --input_csv_path or --columns_to_test not specified, "
-           "generating synthetic data." << std::endl;
-    std::cout << "Generating " << generate_num_values << " values ("
-              << static_cast<double>(num_unique_values) / generate_num_values
-                  * 100 << "% unique)..." << std::endl;
-    table = ci::GenerateUniformData(generate_num_values, num_unique_values);
-  } else {
-    std::cout << "Loading data from file " << input_csv_path << "..."
-              << std::endl;
-    table = ci::Table::FromCsv(input_csv_path, columns_to_test);
-  }
+  std::unique_ptr<ci::Table> table = ci::LoadTableFromFlags();
 
   // Potentially sort the data.
   const std::string sorting = absl::GetFlag(FLAGS_sorting);
@@ -196,9 +368,40 @@ int main(int argc, char* argv[]) {
       ci::CuckooAlgorithm::SKEWED_KICKING, ci::kMaxLoadFactor1SlotsPerBucket,
       /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
       /*prefix_bits_optimization=*/false));
+  index_factories.push_back(absl::make_unique<ci::CuckooIndexFactory>(
+      ci::CuckooAlgorithm::SKEWED_KICKING, ci::kMaxLoadFactor1SlotsPerBucket,
+      /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+      /*prefix_bits_optimization=*/false, ci::CuckooIndexLayout::FAST));
+  index_factories.push_back(absl::make_unique<ci::CuckooIndexFactory>(
+      ci::CuckooAlgorithm::SKEWED_KICKING, ci::kMaxLoadFactor1SlotsPerBucket,
+      /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+      /*prefix_bits_optimization=*/false, ci::CuckooIndexLayout::COMPRESSED,
+      ci::SlotBitmapBackend::AUTO));
+  index_factories.push_back(absl::make_unique<ci::CachingIndexFactory>(
+      absl::make_unique<ci::CuckooIndexFactory>(
+          ci::CuckooAlgorithm::SKEWED_KICKING,
+          ci::kMaxLoadFactor1SlotsPerBucket,
+          /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+          /*prefix_bits_optimization=*/false),
+      /*max_cache_bytes=*/1 << 20));
   index_factories.push_back(
       absl::make_unique<ci::PerStripeBloomFactory>(/*num_bits_per_key=*/10));
   index_factories.push_back(absl::make_unique<ci::PerStripeXorFactory>());
+  index_factories.push_back(
+      absl::make_unique<ci::PerStripeBinaryFuse8Factory>());
+  index_factories.push_back(
+      absl::make_unique<ci::PerStripeBinaryFuse16Factory>());
+  index_factories.push_back(absl::make_unique<ci::ZoneMapFactory>());
+  index_factories.push_back(
+      absl::make_unique<ci::ZoneMapFactory>(/*fan_out=*/16));
+  index_factories.push_back(
+      absl::make_unique<ci::InvertedStripeIndexFactory>());
+  index_factories.push_back(absl::make_unique<ci::ZoneMapCuckooIndexFactory>(
+      absl::make_unique<ci::CuckooIndexFactory>(
+          ci::CuckooAlgorithm::SKEWED_KICKING,
+          ci::kMaxLoadFactor1SlotsPerBucket,
+          /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+          /*prefix_bits_optimization=*/false)));
 
   // Set up the benchmarks.
   for (const std::unique_ptr<ci::Column>& column : table->GetColumns()) {
@@ -218,6 +421,15 @@ int main(int argc, char* argv[]) {
               BM_PositiveDistinctLookup(*column, index, num_stripes, st);
             });
 
+        const std::string positive_zipf_lookup_benchmark_name =
+            absl::StrFormat(/*format=*/"PositiveZipfLookup/%s/%d/%s",
+                            column->name(), num_rows_per_stripe, index->name());
+        ::benchmark::RegisterBenchmark(
+            positive_zipf_lookup_benchmark_name.c_str(),
+            [&column, index, num_stripes](::benchmark::State& st) -> void {
+              BM_PositiveZipfLookup(*column, index, num_stripes, st);
+            });
+
         const std::string negative_lookup_benchmark_name =
             absl::StrFormat(/*format=*/"NegativeLookup/%s/%d/%s",
                             column->name(), num_rows_per_stripe, index->name());
@@ -226,6 +438,57 @@ int main(int argc, char* argv[]) {
             [&column, index, num_stripes](::benchmark::State& st) -> void {
               BM_NegativeLookup(*column, index, num_stripes, st);
             });
+
+        const int max_threads = absl::GetFlag(FLAGS_max_threads);
+        if (max_threads > 1) {
+          std::vector<int> distinct_values = column->distinct_values();
+          distinct_values.erase(
+              std::remove(distinct_values.begin(), distinct_values.end(),
+                          ci::Column::kIntNullSentinel),
+              distinct_values.end());
+          std::shuffle(distinct_values.begin(), distinct_values.end(),
+                       std::mt19937(42));
+          const auto values = std::make_shared<const std::vector<int>>(
+              std::move(distinct_values));
+          const double single_thread_throughput =
+              MeasureSingleThreadThroughput(*index, *values, num_stripes);
+          const std::string mt_lookup_benchmark_name = absl::StrFormat(
+              /*format=*/"MultiThreadedPositiveDistinctLookup/%s/%d/%s",
+              column->name(), num_rows_per_stripe, index->name());
+          ::benchmark::RegisterBenchmark(
+              mt_lookup_benchmark_name.c_str(),
+              [index, values, num_stripes,
+               single_thread_throughput](::benchmark::State& st) -> void {
+                BM_MultiThreadedPositiveDistinctLookup(
+                    index, values, num_stripes, single_thread_throughput, st);
+              })
+              ->ThreadRange(1, max_threads)
+              ->UseRealTime();
+        }
+
+        for (const size_t in_list_size : {10, 1000}) {
+          const std::string in_list_lookup_benchmark_name = absl::StrFormat(
+              /*format=*/"InListLookup/%s/%d/%s/%d", column->name(),
+              num_rows_per_stripe, index->name(), in_list_size);
+          ::benchmark::RegisterBenchmark(
+              in_list_lookup_benchmark_name.c_str(),
+              [&column, index, num_stripes,
+               in_list_size](::benchmark::State& st) -> void {
+                BM_InListLookup(*column, index, num_stripes, in_list_size, st);
+              });
+        }
+
+        for (const size_t batch_size : {10, 1000}) {
+          const std::string batch_lookup_benchmark_name = absl::StrFormat(
+              /*format=*/"BatchLookup/%s/%d/%s/%d", column->name(),
+              num_rows_per_stripe, index->name(), batch_size);
+          ::benchmark::RegisterBenchmark(
+              batch_lookup_benchmark_name.c_str(),
+              [&column, index, num_stripes,
+               batch_size](::benchmark::State& st) -> void {
+                BM_BatchLookup(*column, index, num_stripes, batch_size, st);
+              });
+        }
       }
     }
   }
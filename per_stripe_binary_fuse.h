@@ -0,0 +1,144 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: per_stripe_binary_fuse.h
+// -----------------------------------------------------------------------------
+
+#ifndef CI_PER_STRIPE_BINARY_FUSE_H_
+#define CI_PER_STRIPE_BINARY_FUSE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "binary_fuse_filter.h"
+#include "common/bitmap.h"
+#include "data.h"
+#include "evaluation_utils.h"
+#include "index_structure.h"
+#include "per_stripe_filter_utils.h"
+
+namespace ci {
+
+// Creates one binary fuse filter with 8-bit or 16-bit fingerprints per stripe.
+// A lookup hashes the value once and reuses the hash for all stripes' filters.
+template <typename Fingerprint>
+class PerStripeBinaryFuse : public IndexStructure {
+ public:
+  using Filters = BinaryFuseFilters<Fingerprint>;
+
+  PerStripeBinaryFuse(absl::Span<const int> data,
+                      std::size_t num_rows_per_stripe) {
+    num_stripes_ = AddStripeFilters(data, num_rows_per_stripe,
+                                    [this](absl::Span<const uint64_t> hashes) {
+                                      filters_.AddFilter(hashes);
+                                    });
+  }
+
+  bool StripeContains(std::size_t stripe_id, int value) const override {
+    if (stripe_id >= num_stripes_) {
+      std::cerr << "`stripe_id` is out of bounds." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    // Probe corresponding filter.
+    return filters_.Contains(stripe_id, Filters::Hash(value));
+  }
+
+  Bitmap64 GetQualifyingStripes(int value,
+                                std::size_t num_stripes) const override {
+    Bitmap64 result(/*size=*/num_stripes);
+    filters_.ContainsAll(Filters::Hash(value), &result);
+    return result;
+  }
+
+  Bitmap64 GetQualifyingStripesAmong(
+      int value, const Bitmap64& candidate_stripes) const override {
+    Bitmap64 result(/*size=*/candidate_stripes.bits());
+    filters_.ContainsAmong(Filters::Hash(value), candidate_stripes, &result);
+    return result;
+  }
+
+  std::string name() const override {
+    return std::string("PerStripeBinaryFuse") +
+           std::to_string(8 * sizeof(Fingerprint));
+  }
+
+  size_t byte_size() const override { return filters_.byte_size(); }
+
+  size_t compressed_byte_size() const override {
+    std::string data;
+    Encode(&data);
+    return Compress(data).size();
+  }
+
+  // Appends the binary encoding of the index (the number of stripes followed by
+  // the filters) to `out`.
+  void Encode(std::string* out) const {
+    EncodeNumStripes(num_stripes_, out);
+    filters_.Encode(out);
+  }
+
+  // Decodes an index encoded with Encode(..).
+  static std::unique_ptr<PerStripeBinaryFuse> Decode(
+      absl::string_view encoded) {
+    size_t pos = 0;
+    std::unique_ptr<PerStripeBinaryFuse> index(new PerStripeBinaryFuse());
+    index->num_stripes_ =
+        DecodeNumStripes(encoded, "PerStripeBinaryFuse", &pos);
+    index->filters_ = Filters::Decode(encoded.substr(pos));
+    return index;
+  }
+
+  std::size_t num_stripes() { return num_stripes_; }
+
+ private:
+  // Used by Decode(..).
+  PerStripeBinaryFuse() = default;
+
+  std::size_t num_stripes_;
+  Filters filters_;
+};
+
+using PerStripeBinaryFuse8 = PerStripeBinaryFuse<uint8_t>;
+using PerStripeBinaryFuse16 = PerStripeBinaryFuse<uint16_t>;
+
+template <typename Fingerprint>
+class PerStripeBinaryFuseFactory : public IndexStructureFactory {
+ public:
+  std::unique_ptr<IndexStructure> Create(
+      const Column& column, size_t num_rows_per_stripe) const override {
+    return absl::make_unique<PerStripeBinaryFuse<Fingerprint>>(
+        column.data(), num_rows_per_stripe);
+  }
+
+  std::string index_name() const override {
+    return std::string("PerStripeBinaryFuse") +
+           std::to_string(8 * sizeof(Fingerprint));
+  }
+};
+
+using PerStripeBinaryFuse8Factory = PerStripeBinaryFuseFactory<uint8_t>;
+using PerStripeBinaryFuse16Factory = PerStripeBinaryFuseFactory<uint16_t>;
+
+}  // namespace ci
+
+#endif  // CI_PER_STRIPE_BINARY_FUSE_H_
@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// File: per_stripe_binary_fuse_test.cc
+// -----------------------------------------------------------------------------
+
+#include "per_stripe_binary_fuse.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace ci {
+
+TEST(PerStripeBinaryFuseTest, StripeContains) {
+  PerStripeBinaryFuse8 per_stripe_fuse(/*data=*/{1, 2, 3, 4},
+                                       /*num_rows_per_stripe=*/2);
+
+  EXPECT_TRUE(per_stripe_fuse.StripeContains(/*stripe_id=*/0, /*value=*/1));
+  EXPECT_TRUE(per_stripe_fuse.StripeContains(/*stripe_id=*/0, /*value=*/2));
+  EXPECT_TRUE(per_stripe_fuse.StripeContains(/*stripe_id=*/1, /*value=*/3));
+  EXPECT_TRUE(per_stripe_fuse.StripeContains(/*stripe_id=*/1, /*value=*/4));
+  EXPECT_EQ(per_stripe_fuse.name(), "PerStripeBinaryFuse8");
+}
+
+TEST(PerStripeBinaryFuseTest, GetQualifyingStripes) {
+  PerStripeBinaryFuse16 per_stripe_fuse(/*data=*/{1, 2, 3, 4, 1, 3},
+                                        /*num_rows_per_stripe=*/2);
+
+  for (int value = 1; value <= 4; ++value) {
+    const Bitmap64 stripes =
+        per_stripe_fuse.GetQualifyingStripes(value, /*num_stripes=*/3);
+    for (size_t stripe_id = 0; stripe_id < 3; ++stripe_id) {
+      EXPECT_EQ(stripes.Get(stripe_id),
+                per_stripe_fuse.StripeContains(stripe_id, value));
+    }
+  }
+  EXPECT_EQ(per_stripe_fuse.name(), "PerStripeBinaryFuse16");
+}
+
+TEST(PerStripeBinaryFuseTest, EncodeDecode) {
+  PerStripeBinaryFuse8 per_stripe_fuse(/*data=*/{1, 2, 3, 4},
+                                       /*num_rows_per_stripe=*/2);
+  std::string encoded;
+  per_stripe_fuse.Encode(&encoded);
+
+  const std::unique_ptr<PerStripeBinaryFuse8> decoded =
+      PerStripeBinaryFuse8::Decode(encoded);
+  EXPECT_EQ(decoded->num_stripes(), 2);
+  for (int value = 0; value <= 5; ++value) {
+    for (size_t stripe_id = 0; stripe_id < 2; ++stripe_id) {
+      EXPECT_EQ(decoded->StripeContains(stripe_id, value),
+                per_stripe_fuse.StripeContains(stripe_id, value));
+    }
+  }
+}
+
+}  // namespace ci
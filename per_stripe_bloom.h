@@ -23,44 +23,31 @@
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <vector>
 
-#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "blocked_bloom_filter.h"
+#include "common/bitmap.h"
 #include "data.h"
 #include "evaluation_utils.h"
 #include "index_structure.h"
-#include "leveldb/filter_policy.h"
-#include "leveldb/slice.h"
+#include "per_stripe_filter_utils.h"
 
 namespace ci {
 
+// One cache-line-blocked Bloom filter per stripe. Values are hashed as integers
+// (no string conversion), and a lookup hashes the value once and reuses the
+// hash for probing all stripes' filters.
 class PerStripeBloom : public IndexStructure {
  public:
-  PerStripeBloom(const std::vector<int>& data, std::size_t num_rows_per_stripe,
+  PerStripeBloom(absl::Span<const int> data, std::size_t num_rows_per_stripe,
                  std::size_t num_bits_per_key)
-      : num_bits_per_key_(num_bits_per_key),
-        policy_(leveldb::NewBloomFilterPolicy(num_bits_per_key_)) {
-    num_stripes_ = data.size() / num_rows_per_stripe;
-    // Pre-allocate `num_stripes_` strings to store filters.
-    filters_.resize(num_stripes_);
-    for (size_t stripe_id = 0; stripe_id < num_stripes_; ++stripe_id) {
-      const std::size_t stripe_begin = num_rows_per_stripe * stripe_id;
-      const std::size_t stripe_end = stripe_begin + num_rows_per_stripe;
-      const std::size_t num_values = stripe_end - stripe_begin;
-      // Collect values of current stripe. (LevelDB's Bloom filter only accepts
-      // leveldb::Slice.)
-      absl::flat_hash_set<std::string> string_values;
-      string_values.reserve(num_values);
-      for (size_t i = stripe_begin; i < stripe_end; ++i) {
-        string_values.insert(std::to_string(data[i]));
-      }
-
-      // Create the filter for the current stripe.
-      const std::vector<leveldb::Slice> slices(string_values.begin(),
-                                               string_values.end());
-      policy_->CreateFilter(slices.data(), static_cast<int>(slices.size()),
-                            &filters_[stripe_id]);
-    }
+      : num_bits_per_key_(num_bits_per_key) {
+    num_stripes_ = AddStripeFilters(
+        data, num_rows_per_stripe, [this](absl::Span<const uint64_t> hashes) {
+          filters_.AddFilter(hashes, num_bits_per_key_);
+        });
   }
 
   bool StripeContains(std::size_t stripe_id, int value) const override {
@@ -69,29 +56,32 @@ class PerStripeBloom : public IndexStructure {
       exit(EXIT_FAILURE);
     }
     // Probe corresponding filter.
-    return policy_->KeyMayMatch(leveldb::Slice(std::to_string(value)),
-                                filters_[stripe_id]);
+    return filters_.Contains(stripe_id, BlockedBloomFilters::Hash(value));
   }
 
-  std::string name() const override {
-    return std::string("PerStripeBloom/") + std::to_string(num_bits_per_key_);
+  Bitmap64 GetQualifyingStripes(int value,
+                                std::size_t num_stripes) const override {
+    Bitmap64 result(/*size=*/num_stripes);
+    filters_.ContainsAll(BlockedBloomFilters::Hash(value), &result);
+    return result;
   }
 
-  size_t byte_size() const override {
-    std::size_t result = 0;
-    for (const std::string filter : filters_) {
-      result += filter.size();
-    }
+  Bitmap64 GetQualifyingStripesAmong(
+      int value, const Bitmap64& candidate_stripes) const override {
+    Bitmap64 result(/*size=*/candidate_stripes.bits());
+    filters_.ContainsAmong(BlockedBloomFilters::Hash(value), candidate_stripes,
+                           &result);
     return result;
   }
 
-  size_t compressed_byte_size() const override {
-    std::string data;
-    for (const std::string& filter : filters_) {
-      absl::StrAppend(&data, filter);
-    }
+  std::string name() const override {
+    return std::string("PerStripeBloom/") + std::to_string(num_bits_per_key_);
+  }
+
+  size_t byte_size() const override { return filters_.byte_size(); }
 
-    return Compress(data).size();
+  size_t compressed_byte_size() const override {
+    return Compress(filters_.Data()).size();
   }
 
   std::size_t num_stripes() { return num_stripes_; }
@@ -99,8 +89,7 @@ class PerStripeBloom : public IndexStructure {
  private:
   std::size_t num_stripes_;
   std::size_t num_bits_per_key_;
-  std::unique_ptr<const leveldb::FilterPolicy> policy_;
-  std::vector<std::string> filters_;
+  BlockedBloomFilters filters_;
 };
 
 class PerStripeBloomFactory : public IndexStructureFactory {
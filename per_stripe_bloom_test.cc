@@ -33,4 +33,22 @@ TEST(PerStripeBloomTest, StripeContains) {
   EXPECT_TRUE(per_stripe_bloom.StripeContains(/*stripe_id=*/1, /*value=*/4));
 }
 
+TEST(PerStripeBloomTest, GetQualifyingStripes) {
+  PerStripeBloom per_stripe_bloom(
+      /*data=*/{1, 2, 3, 4, 1, 3}, /*num_rows_per_stripe=*/2,
+      /*num_bits_per_key=*/10);
+
+  for (int value = 1; value <= 4; ++value) {
+    const Bitmap64 stripes =
+        per_stripe_bloom.GetQualifyingStripes(value, /*num_stripes=*/3);
+    for (size_t stripe_id = 0; stripe_id < 3; ++stripe_id) {
+      EXPECT_EQ(stripes.Get(stripe_id),
+                per_stripe_bloom.StripeContains(stripe_id, value));
+    }
+  }
+  EXPECT_TRUE(per_stripe_bloom.GetQualifyingStripes(/*value=*/1,
+                                                    /*num_stripes=*/3)
+                  .Get(2));
+}
+
 }  // namespace ci
@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: per_stripe_filter_utils.h
+// -----------------------------------------------------------------------------
+//
+// Helpers shared by the index structures that keep one filter per stripe
+// (e.g., PerStripeBloom, PerStripeXor and PerStripeBinaryFuse).
+
+#ifndef CI_PER_STRIPE_FILTER_UTILS_H_
+#define CI_PER_STRIPE_FILTER_UTILS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "common/int_hash.h"
+
+namespace ci {
+
+// Calls `add_filter(hashes)` with the hashes (see HashInt(..)) of the distinct
+// values of each of the stripes of `data` in order. Returns the number of
+// stripes.
+template <typename AddFilter>
+size_t AddStripeFilters(absl::Span<const int> data, size_t num_rows_per_stripe,
+                        const AddFilter& add_filter) {
+  const size_t num_stripes = data.size() / num_rows_per_stripe;
+  std::vector<int> values;
+  std::vector<uint64_t> hashes;
+  for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+    const absl::Span<const int> stripe =
+        data.subspan(num_rows_per_stripe * stripe_id, num_rows_per_stripe);
+    // Collect the distinct values of the current stripe.
+    values.assign(stripe.begin(), stripe.end());
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    // Create the filter for the current stripe.
+    hashes.clear();
+    for (const int value : values) hashes.push_back(HashInt(value));
+    add_filter(absl::Span<const uint64_t>(hashes));
+  }
+  return num_stripes;
+}
+
+// Appends the header of an encoded per-stripe index (its number of stripes) to
+// `out`.
+inline void EncodeNumStripes(size_t num_stripes, std::string* out) {
+  const uint64_t value = num_stripes;
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Returns the number of stripes encoded with EncodeNumStripes(..) at `*pos` of
+// `encoded` and advances `*pos` past it. Exits if `encoded` (an encoding of
+// the index `index_name`) is too short.
+inline size_t DecodeNumStripes(absl::string_view encoded,
+                               absl::string_view index_name, size_t* pos) {
+  uint64_t num_stripes;
+  if (encoded.size() < *pos + sizeof(num_stripes)) {
+    std::cerr << "Invalid " << index_name << " encoding." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::memcpy(&num_stripes, encoded.data() + *pos, sizeof(num_stripes));
+  *pos += sizeof(num_stripes);
+  return num_stripes;
+}
+
+}  // namespace ci
+
+#endif  // CI_PER_STRIPE_FILTER_UTILS_H_
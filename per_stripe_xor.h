@@ -20,14 +20,19 @@
 #define CI_PER_STRIPE_XOR_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
-#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "data.h"
 #include "evaluation_utils.h"
 #include "index_structure.h"
+#include "per_stripe_filter_utils.h"
 #include "xor_filter.h"
 
 namespace ci {
@@ -35,7 +40,7 @@ namespace ci {
 // Creates one Xor8 filter per stripe.
 class PerStripeXor : public IndexStructure {
  public:
-  PerStripeXor(const std::vector<int>& data, std::size_t num_rows_per_stripe) {
+  PerStripeXor(absl::Span<const int> data, std::size_t num_rows_per_stripe) {
     num_stripes_ = data.size() / num_rows_per_stripe;
     filters_.reserve(num_stripes_);
     for (size_t stripe_id = 0; stripe_id < num_stripes_; ++stripe_id) {
@@ -73,14 +78,34 @@ class PerStripeXor : public IndexStructure {
 
   size_t compressed_byte_size() const override {
     std::string data;
-    for (size_t i = 0; i < filters_.size(); ++i)
-      absl::StrAppend(&data, filters_[i]->Data());
+    Encode(&data);
     return Compress(data).size();
   }
 
+  // Appends the binary encoding of the index (the number of stripes followed by
+  // the stripes' filters) to `out`.
+  void Encode(std::string* out) const {
+    EncodeNumStripes(num_stripes_, out);
+    for (const auto& filter : filters_) filter->Encode(out);
+  }
+
+  // Decodes an index encoded with Encode(..).
+  static std::unique_ptr<PerStripeXor> Decode(absl::string_view encoded) {
+    size_t pos = 0;
+    std::unique_ptr<PerStripeXor> index(new PerStripeXor());
+    index->num_stripes_ = DecodeNumStripes(encoded, "PerStripeXor", &pos);
+    index->filters_.reserve(index->num_stripes_);
+    for (size_t i = 0; i < index->num_stripes_; ++i)
+      index->filters_.push_back(Xor8::Decode(encoded, &pos));
+    return index;
+  }
+
   std::size_t num_stripes() { return num_stripes_; }
 
  private:
+  // Used by Decode(..).
+  PerStripeXor() = default;
+
   std::size_t num_stripes_;
   std::vector<std::unique_ptr<Xor8>> filters_;
 };
@@ -18,6 +18,9 @@
 
 #include "per_stripe_xor.h"
 
+#include <memory>
+#include <string>
+
 #include "gtest/gtest.h"
 
 namespace ci {
@@ -31,4 +34,16 @@ TEST(PerStripeXorTest, StripeContains) {
   EXPECT_TRUE(per_stripe_xor.StripeContains(/*stripe_id=*/1, /*value=*/4));
 }
 
+TEST(PerStripeXorTest, EncodeDecode) {
+  PerStripeXor per_stripe_xor(/*data=*/{1, 2, 3, 4}, /*num_rows_per_stripe=*/2);
+  std::string encoded;
+  per_stripe_xor.Encode(&encoded);
+
+  const std::unique_ptr<PerStripeXor> decoded = PerStripeXor::Decode(encoded);
+  EXPECT_EQ(decoded->num_stripes(), 2);
+  std::string reencoded;
+  decoded->Encode(&reencoded);
+  EXPECT_EQ(reencoded, encoded);
+}
+
 }  // namespace ci
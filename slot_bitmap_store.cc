@@ -0,0 +1,325 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: slot_bitmap_store.cc
+// -----------------------------------------------------------------------------
+
+#include "slot_bitmap_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <limits>
+
+#include "absl/memory/memory.h"
+#include "common/bit_packing.h"
+#include "common/byte_coding.h"
+
+namespace ci {
+namespace {
+
+// Backends ordered by the cost of extracting slot bitmaps: dense bitmaps are
+// copied (and shifted) word by word, Roaring and sorted lists only visit set bits (with
+// Roaring skipping whole containers), and RLE has to decode runs.
+constexpr SlotBitmapBackend kAutoPreference[] = {
+    SlotBitmapBackend::DENSE, SlotBitmapBackend::ROARING,
+    SlotBitmapBackend::SORTED_LIST, SlotBitmapBackend::RLE};
+
+// Exits if positions of `bitmap` can't be represented as uint32_t.
+void CheckFitsUint32(const Bitmap64& bitmap) {
+  if (bitmap.bits() > std::numeric_limits<uint32_t>::max()) {
+    std::cerr << "Bitmap with " << bitmap.bits()
+              << " bits exceeds 32-bit positions." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+SlotBitmapStorePtr CreateAuto(const Bitmap64& bitmap, size_t num_stripes) {
+  std::vector<SlotBitmapStorePtr> candidates;
+  for (const SlotBitmapBackend backend :
+       {SlotBitmapBackend::RLE, SlotBitmapBackend::ROARING,
+        SlotBitmapBackend::DENSE, SlotBitmapBackend::SORTED_LIST}) {
+    candidates.push_back(
+        SlotBitmapStore::Create(backend, bitmap, num_stripes));
+  }
+
+  std::vector<size_t> sizes;
+  size_t min_size = std::numeric_limits<size_t>::max();
+  for (const SlotBitmapStorePtr& candidate : candidates) {
+    sizes.push_back(candidate->Encode().size());
+    min_size = std::min(min_size, sizes.back());
+  }
+
+  // Among all candidates that are small enough, pick the one with the
+  // cheapest extraction. Only depends on the encoded sizes, so the same input
+  // always results in the same encoding.
+  for (const SlotBitmapBackend backend : kAutoPreference) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      if (candidates[i]->backend() == backend &&
+          sizes[i] <= SlotBitmapStore::kAutoMaxSizeOverhead * min_size) {
+        return std::move(candidates[i]);
+      }
+    }
+  }
+  // Unreachable: the smallest candidate always qualifies.
+  std::cerr << "No slot-bitmap backend qualified." << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+}  // namespace
+
+std::string SlotBitmapBackendName(SlotBitmapBackend backend) {
+  switch (backend) {
+    case SlotBitmapBackend::RLE:
+      return "rle";
+    case SlotBitmapBackend::ROARING:
+      return "roaring";
+    case SlotBitmapBackend::DENSE:
+      return "dense";
+    case SlotBitmapBackend::SORTED_LIST:
+      return "sorted_list";
+    case SlotBitmapBackend::AUTO:
+      return "auto";
+  }
+  std::cerr << "Unknown slot-bitmap backend: " << static_cast<int>(backend)
+            << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+SlotBitmapStorePtr SlotBitmapStore::Create(SlotBitmapBackend backend,
+                                           const Bitmap64& bitmap,
+                                           size_t num_stripes) {
+  switch (backend) {
+    case SlotBitmapBackend::RLE:
+      return absl::make_unique<RleSlotBitmapStore>(bitmap, num_stripes);
+    case SlotBitmapBackend::ROARING:
+      return absl::make_unique<RoaringSlotBitmapStore>(bitmap);
+    case SlotBitmapBackend::DENSE:
+      return absl::make_unique<DenseSlotBitmapStore>(bitmap);
+    case SlotBitmapBackend::SORTED_LIST:
+      return absl::make_unique<SortedListSlotBitmapStore>(bitmap);
+    case SlotBitmapBackend::AUTO:
+      return CreateAuto(bitmap, num_stripes);
+  }
+  std::cerr << "Unknown slot-bitmap backend: " << static_cast<int>(backend)
+            << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+Bitmap64 SlotBitmapStore::ExtractMasked(size_t offset,
+                                        const Bitmap64& mask) const {
+  const size_t num_candidates = mask.GetOnesCount();
+  if (num_candidates * kSparseMaskFactor <= mask.bits()) {
+    Bitmap64 result(/*size=*/mask.bits());
+    if (num_candidates == 0) return result;
+    for (const size_t i : mask.TrueBitIndices()) {
+      if (Get(offset + i)) result.Set(i, true);
+    }
+    return result;
+  }
+  Bitmap64 result = Extract(offset, mask.bits());
+  result &= mask;
+  return result;
+}
+
+void SlotBitmapStore::ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                                Bitmap64* result) const {
+  for (const size_t offset : offsets) *result |= Extract(offset, size);
+}
+
+// **** RleSlotBitmapStore ****
+
+RleSlotBitmapStore::RleSlotBitmapStore(const Bitmap64& bitmap,
+                                       size_t num_stripes)
+    : size_(bitmap.bits()), num_stripes_(num_stripes), rle_bitmap_(bitmap) {
+  if (num_stripes_ == 0) return;
+  slot_ones_counts_.resize((size_ + num_stripes_ - 1) / num_stripes_);
+  for (const size_t pos : bitmap.TrueBitIndices())
+    ++slot_ones_counts_[pos / num_stripes_];
+}
+
+size_t RleSlotBitmapStore::GetOnesCount(size_t offset, size_t size) const {
+  // Fast path for whole slot bitmaps.
+  if (num_stripes_ != 0 && size == num_stripes_ &&
+      offset % num_stripes_ == 0 && offset + size <= size_) {
+    return slot_ones_counts_[offset / num_stripes_];
+  }
+  return rle_bitmap_.Extract(offset, size).GetOnesCount();
+}
+
+// **** RoaringSlotBitmapStore ****
+
+RoaringSlotBitmapStore::RoaringSlotBitmapStore(const Bitmap64& bitmap)
+    : size_(bitmap.bits()) {
+  CheckFitsUint32(bitmap);
+  for (const size_t pos : bitmap.TrueBitIndices()) roaring_.add(pos);
+  roaring_.runOptimize();
+  roaring_.shrinkToFit();
+}
+
+Bitmap64 RoaringSlotBitmapStore::Extract(size_t offset, size_t size) const {
+  assert(offset + size <= size_);
+  Bitmap64 result(/*size=*/size);
+  RoaringSetBitForwardIterator it = roaring_.begin();
+  it.equalorlarger(offset);
+  for (; it != roaring_.end() && *it < offset + size; ++it) {
+    result.Set(*it - offset, true);
+  }
+  return result;
+}
+
+void RoaringSlotBitmapStore::ExtractOr(absl::Span<const size_t> offsets,
+                                       size_t size, Bitmap64* result) const {
+  assert(result->bits() == size);
+  // Reuse the iterator, `offsets` are sorted.
+  RoaringSetBitForwardIterator it = roaring_.begin();
+  for (const size_t offset : offsets) {
+    assert(offset + size <= size_);
+    it.equalorlarger(offset);
+    for (; it != roaring_.end() && *it < offset + size; ++it) {
+      result->Set(*it - offset, true);
+    }
+  }
+}
+
+size_t RoaringSlotBitmapStore::GetOnesCount(size_t offset, size_t size) const {
+  assert(offset + size <= size_);
+  if (size == 0) return 0;
+  // Roaring::rank(x) returns the number of set bits in [0, x].
+  const size_t before = offset == 0 ? 0 : roaring_.rank(offset - 1);
+  return roaring_.rank(offset + size - 1) - before;
+}
+
+std::string RoaringSlotBitmapStore::Encode() const {
+  std::string result(roaring_.getSizeInBytes(/*portable=*/false), '\0');
+  roaring_.write(result.data(), /*portable=*/false);
+  return result;
+}
+
+// **** DenseSlotBitmapStore ****
+
+DenseSlotBitmapStore::DenseSlotBitmapStore(const Bitmap64& bitmap)
+    : size_(bitmap.bits()), words_((size_ + 63) / 64, 0) {
+  for (const size_t pos : bitmap.TrueBitIndices())
+    words_[pos / 64] |= uint64_t{1} << (pos % 64);
+}
+
+void DenseSlotBitmapStore::ExtractWords(size_t offset, size_t size,
+                                        bool combine, uint64_t* words) const {
+  assert(offset + size <= size_);
+  const size_t num_words = (size + 63) / 64;
+  for (size_t i = 0; i < num_words; ++i) {
+    uint64_t word = GetWord(offset + i * 64);
+    // Clear the bits beyond `size` in the last word.
+    if (i == num_words - 1 && size % 64 != 0)
+      word &= (uint64_t{1} << (size % 64)) - 1;
+    words[i] = combine ? words[i] | word : word;
+  }
+}
+
+Bitmap64 DenseSlotBitmapStore::Extract(size_t offset, size_t size) const {
+  std::vector<uint64_t> words((size + 63) / 64);
+  ExtractWords(offset, size, /*combine=*/false, words.data());
+  return Bitmap64::FromWords(words.data(), size);
+}
+
+void DenseSlotBitmapStore::ExtractOr(absl::Span<const size_t> offsets,
+                                     size_t size, Bitmap64* result) const {
+  assert(result->bits() == size);
+  std::vector<uint64_t> words((size + 63) / 64, 0);
+  for (const size_t offset : offsets)
+    ExtractWords(offset, size, /*combine=*/true, words.data());
+  *result |= Bitmap64::FromWords(words.data(), size);
+}
+
+size_t DenseSlotBitmapStore::GetOnesCount(size_t offset, size_t size) const {
+  assert(offset + size <= size_);
+  size_t count = 0;
+  for (size_t i = 0; i < size; i += 64) {
+    uint64_t word = GetWord(offset + i);
+    if (size - i < 64) word &= (uint64_t{1} << (size - i)) - 1;
+    count += __builtin_popcountll(word);
+  }
+  return count;
+}
+
+std::string DenseSlotBitmapStore::Encode() const {
+  Bitmap64 bitmap = Bitmap64::FromWords(words_.data(), size_);
+  bitmap.InitRankLookupTable();
+  std::string result;
+  Bitmap64::DenseEncode(bitmap, &result);
+  return result;
+}
+
+// **** SortedListSlotBitmapStore ****
+
+SortedListSlotBitmapStore::SortedListSlotBitmapStore(const Bitmap64& bitmap)
+    : size_(bitmap.bits()) {
+  CheckFitsUint32(bitmap);
+  for (const size_t pos : bitmap.TrueBitIndices()) positions_.push_back(pos);
+}
+
+Bitmap64 SortedListSlotBitmapStore::Extract(size_t offset, size_t size) const {
+  assert(offset + size <= size_);
+  Bitmap64 result(/*size=*/size);
+  for (auto it = std::lower_bound(positions_.begin(), positions_.end(), offset);
+       it != positions_.end() && *it < offset + size; ++it) {
+    result.Set(*it - offset, true);
+  }
+  return result;
+}
+
+void SortedListSlotBitmapStore::ExtractOr(absl::Span<const size_t> offsets,
+                                          size_t size,
+                                          Bitmap64* result) const {
+  assert(result->bits() == size);
+  // Only search the remaining positions, `offsets` are sorted.
+  auto it = positions_.begin();
+  for (const size_t offset : offsets) {
+    assert(offset + size <= size_);
+    for (it = std::lower_bound(it, positions_.end(), offset);
+         it != positions_.end() && *it < offset + size; ++it) {
+      result->Set(*it - offset, true);
+    }
+  }
+}
+
+bool SortedListSlotBitmapStore::Get(size_t pos) const {
+  assert(pos < size_);
+  return std::binary_search(positions_.begin(), positions_.end(), pos);
+}
+
+size_t SortedListSlotBitmapStore::GetOnesCount(size_t offset,
+                                               size_t size) const {
+  assert(offset + size <= size_);
+  const auto begin =
+      std::lower_bound(positions_.begin(), positions_.end(), offset);
+  const auto end = std::lower_bound(begin, positions_.end(), offset + size);
+  return end - begin;
+}
+
+std::string SortedListSlotBitmapStore::Encode() const {
+  // Encode the positions bit-packed (i.e., still allowing for random access).
+  ByteBuffer result;
+  PutVarint32(positions_.size(), &result);
+  const uint32_t bit_width =
+      MaxBitWidth<uint32_t>(absl::MakeConstSpan(positions_));
+  PutVarint32(bit_width, &result);
+  StoreBitPacked<uint32_t>(positions_, bit_width, &result);
+  PutSlopBytes(&result);
+  return std::string(result.data(), result.pos());
+}
+
+}  // namespace ci
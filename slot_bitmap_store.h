@@ -0,0 +1,222 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: slot_bitmap_store.h
+// -----------------------------------------------------------------------------
+//
+// Storage backends for the concatenated slot bitmaps of a CuckooIndex (one
+// stripe bitmap per active slot, stored back-to-back). All backends support
+// extracting a range of bits, point lookups and counting set bits in a range.
+
+#ifndef CUCKOO_INDEX_SLOT_BITMAP_STORE_H_
+#define CUCKOO_INDEX_SLOT_BITMAP_STORE_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/bitmap.h"
+#include "absl/types/span.h"
+#include "common/rle_bitmap.h"
+#include "roaring.hh"
+
+namespace ci {
+
+// Available slot-bitmap backends. AUTO builds all other backends and picks one
+// per index (see SlotBitmapStore::Create(..)).
+enum class SlotBitmapBackend { RLE, ROARING, DENSE, SORTED_LIST, AUTO };
+
+// Returns a short, human-readable name of `backend` (e.g., "rle").
+std::string SlotBitmapBackendName(SlotBitmapBackend backend);
+
+class SlotBitmapStore;
+using SlotBitmapStorePtr = std::unique_ptr<SlotBitmapStore>;
+
+class SlotBitmapStore {
+ public:
+  // Creates a store with the given `backend` holding `bitmap`. For AUTO, all
+  // other backends are built and, among those whose encoded size is at most
+  // `kAutoMaxSizeOverhead` times the smallest encoded size, the one with the
+  // cheapest extraction (dense, Roaring, sorted list, RLE, in this order) is
+  // returned. The choice is deterministic.
+  static SlotBitmapStorePtr Create(SlotBitmapBackend backend,
+                                   const Bitmap64& bitmap, size_t num_stripes);
+
+  // Maximum relative size overhead of a backend picked by AUTO compared to the
+  // smallest backend.
+  static constexpr double kAutoMaxSizeOverhead = 1.1;
+
+  // ExtractMasked(..) uses point lookups if at most one in
+  // `kSparseMaskFactor` bits of the mask is set.
+  static constexpr size_t kSparseMaskFactor = 16;
+
+  virtual ~SlotBitmapStore() = default;
+
+  virtual SlotBitmapBackend backend() const = 0;
+
+  // Returns the number of bits in the store.
+  virtual size_t bits() const = 0;
+
+  // Returns the slice of the bitmap from `offset` on of the given `size`.
+  virtual Bitmap64 Extract(size_t offset, size_t size) const = 0;
+
+  // Returns the slice of the bitmap from `offset` on of size `mask.bits()`,
+  // ANDed with `mask`. Backends only need to decode the bits set in `mask`.
+  // The default implementation uses point lookups for sparse masks and
+  // Extract(..) otherwise.
+  virtual Bitmap64 ExtractMasked(size_t offset, const Bitmap64& mask) const;
+
+  // ORs the slices of the bitmap from each of the `offsets` on of the given
+  // `size` into `result` (which has to have `size` bits). `offsets` have to be
+  // sorted and the slices must not overlap.
+  virtual void ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                         Bitmap64* result) const;
+
+  // Returns the bit at `pos`.
+  virtual bool Get(size_t pos) const = 0;
+
+  // Returns the number of set bits in [offset, offset + size).
+  virtual size_t GetOnesCount(size_t offset, size_t size) const = 0;
+
+  // Returns the number of set bits.
+  size_t GetOnesCount() const { return GetOnesCount(/*offset=*/0, bits()); }
+
+  // Returns the encoded store (used for size measurements).
+  virtual std::string Encode() const = 0;
+};
+
+// Run-length encoded bitmap (see common/rle_bitmap.h). Keeps the number of
+// set bits of each slot bitmap (of `num_stripes` bits) in memory, so that
+// counting the ones of a slot bitmap doesn't need to decode it.
+class RleSlotBitmapStore : public SlotBitmapStore {
+ public:
+  RleSlotBitmapStore(const Bitmap64& bitmap, size_t num_stripes);
+
+  SlotBitmapBackend backend() const override { return SlotBitmapBackend::RLE; }
+  size_t bits() const override { return size_; }
+  Bitmap64 Extract(size_t offset, size_t size) const override {
+    return rle_bitmap_.Extract(offset, size);
+  }
+  void ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                 Bitmap64* result) const override {
+    rle_bitmap_.ExtractOr(offsets, size, result);
+  }
+  bool Get(size_t pos) const override { return rle_bitmap_.Get(pos); }
+  size_t GetOnesCount(size_t offset, size_t size) const override;
+  std::string Encode() const override {
+    return std::string(rle_bitmap_.data());
+  }
+
+ private:
+  const size_t size_;
+  const size_t num_stripes_;
+  const RleBitmap rle_bitmap_;
+  // Number of set bits of each slot bitmap. Not part of the encoding since it
+  // can be recomputed when decoding.
+  std::vector<uint32_t> slot_ones_counts_;
+};
+
+// Roaring bitmap over the positions of set bits.
+class RoaringSlotBitmapStore : public SlotBitmapStore {
+ public:
+  explicit RoaringSlotBitmapStore(const Bitmap64& bitmap);
+
+  SlotBitmapBackend backend() const override {
+    return SlotBitmapBackend::ROARING;
+  }
+  size_t bits() const override { return size_; }
+  Bitmap64 Extract(size_t offset, size_t size) const override;
+  void ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                 Bitmap64* result) const override;
+  bool Get(size_t pos) const override { return roaring_.contains(pos); }
+  size_t GetOnesCount(size_t offset, size_t size) const override;
+  std::string Encode() const override;
+
+ private:
+  const size_t size_;
+  Roaring roaring_;
+};
+
+// Uncompressed bitmap, kept as 64-bit words in memory so that slot bitmaps
+// are extracted word by word (shifting words for unaligned offsets). Encoded
+// with a rank directory.
+class DenseSlotBitmapStore : public SlotBitmapStore {
+ public:
+  explicit DenseSlotBitmapStore(const Bitmap64& bitmap);
+
+  SlotBitmapBackend backend() const override {
+    return SlotBitmapBackend::DENSE;
+  }
+  size_t bits() const override { return size_; }
+  Bitmap64 Extract(size_t offset, size_t size) const override;
+  void ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                 Bitmap64* result) const override;
+  bool Get(size_t pos) const override {
+    assert(pos < size_);
+    return (words_[pos / 64] >> (pos % 64)) & 1;
+  }
+  size_t GetOnesCount(size_t offset, size_t size) const override;
+  std::string Encode() const override;
+
+ private:
+  // Returns the (up to) 64 bits starting at `pos` in the least-significant
+  // bits of a word. Bits at or beyond `size_` are zero.
+  uint64_t GetWord(size_t pos) const {
+    const size_t word = pos / 64;
+    const size_t shift = pos % 64;
+    uint64_t result = words_[word] >> shift;
+    if (shift != 0 && word + 1 < words_.size())
+      result |= words_[word + 1] << (64 - shift);
+    return result;
+  }
+
+  // Writes the `size` bits starting at `offset` to `words` (or ORs them into
+  // `words` if `combine` is set).
+  void ExtractWords(size_t offset, size_t size, bool combine,
+                    uint64_t* words) const;
+
+  const size_t size_;
+  // Bits beyond `size_` in the last word are zero.
+  std::vector<uint64_t> words_;
+};
+
+// Sorted list of the positions of set bits (i.e., of the stripe ids of all
+// slots, each shifted by the offset of its slot bitmap).
+class SortedListSlotBitmapStore : public SlotBitmapStore {
+ public:
+  explicit SortedListSlotBitmapStore(const Bitmap64& bitmap);
+
+  SlotBitmapBackend backend() const override {
+    return SlotBitmapBackend::SORTED_LIST;
+  }
+  size_t bits() const override { return size_; }
+  Bitmap64 Extract(size_t offset, size_t size) const override;
+  void ExtractOr(absl::Span<const size_t> offsets, size_t size,
+                 Bitmap64* result) const override;
+  bool Get(size_t pos) const override;
+  size_t GetOnesCount(size_t offset, size_t size) const override;
+  std::string Encode() const override;
+
+ private:
+  const size_t size_;
+  std::vector<uint32_t> positions_;
+};
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_SLOT_BITMAP_STORE_H_
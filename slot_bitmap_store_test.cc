@@ -0,0 +1,154 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: slot_bitmap_store_test.cc
+// -----------------------------------------------------------------------------
+
+#include "slot_bitmap_store.h"
+
+#include <vector>
+
+#include "absl/random/random.h"
+#include "gtest/gtest.h"
+
+namespace ci {
+
+constexpr size_t kNumStripes = 100;
+constexpr size_t kNumSlots = 50;
+
+// Returns a bitmap of `kNumSlots` slot bitmaps with `kNumStripes` bits each,
+// with runs of set bits of random lengths (i.e., clustered bits).
+Bitmap64 CreateRandomBitmap() {
+  absl::BitGen gen;
+  Bitmap64 bitmap(/*size=*/kNumStripes * kNumSlots);
+  for (size_t i = 0; i < bitmap.bits();) {
+    const size_t run = absl::Uniform<size_t>(gen, 1, 20);
+    const bool value = absl::Bernoulli(gen, 0.3);
+    for (size_t j = 0; j < run && i < bitmap.bits(); ++j, ++i)
+      bitmap.Set(i, value);
+  }
+  return bitmap;
+}
+
+// Checks all operations of a store with the given `backend` against the
+// original bitmap.
+void CheckBackend(const SlotBitmapBackend backend) {
+  const Bitmap64 bitmap = CreateRandomBitmap();
+  const SlotBitmapStorePtr store =
+      SlotBitmapStore::Create(backend, bitmap, kNumStripes);
+  ASSERT_EQ(store->bits(), bitmap.bits());
+  EXPECT_EQ(store->GetOnesCount(), bitmap.GetOnesCount());
+  for (size_t i = 0; i < bitmap.bits(); ++i)
+    ASSERT_EQ(store->Get(i), bitmap.Get(i));
+  for (size_t slot = 0; slot < kNumSlots; ++slot) {
+    const size_t offset = slot * kNumStripes;
+    const Bitmap64 extracted = store->Extract(offset, kNumStripes);
+    ASSERT_EQ(extracted.bits(), kNumStripes);
+    size_t ones_count = 0;
+    for (size_t i = 0; i < kNumStripes; ++i) {
+      ASSERT_EQ(extracted.Get(i), bitmap.Get(offset + i));
+      ones_count += bitmap.Get(offset + i);
+    }
+    EXPECT_EQ(store->GetOnesCount(offset, kNumStripes), ones_count);
+
+    // Sparse (every 20th stripe) and dense (every other stripe) masks.
+    for (const size_t step : {20, 2}) {
+      Bitmap64 mask(/*size=*/kNumStripes);
+      for (size_t i = 0; i < kNumStripes; i += step) mask.Set(i, true);
+      const Bitmap64 masked = store->ExtractMasked(offset, mask);
+      ASSERT_EQ(masked.bits(), kNumStripes);
+      for (size_t i = 0; i < kNumStripes; ++i)
+        ASSERT_EQ(masked.Get(i), mask.Get(i) && bitmap.Get(offset + i));
+    }
+  }
+
+  // Union of every third slot bitmap.
+  std::vector<size_t> offsets;
+  Bitmap64 expected(/*size=*/kNumStripes);
+  for (size_t slot = 0; slot < kNumSlots; slot += 3) {
+    offsets.push_back(slot * kNumStripes);
+    for (size_t i = 0; i < kNumStripes; ++i) {
+      if (bitmap.Get(slot * kNumStripes + i)) expected.Set(i, true);
+    }
+  }
+  Bitmap64 result(/*size=*/kNumStripes);
+  store->ExtractOr(offsets, kNumStripes, &result);
+  EXPECT_EQ(result.ToString(), expected.ToString());
+
+  // Ranges at (and across) word boundaries.
+  for (const size_t offset : {0, 1, 63, 64, 65, 127, 129, 1000}) {
+    for (const size_t size : {1, 63, 64, 65, 128, 200}) {
+      const Bitmap64 extracted = store->Extract(offset, size);
+      ASSERT_EQ(extracted.bits(), size);
+      size_t ones_count = 0;
+      for (size_t i = 0; i < size; ++i) {
+        ASSERT_EQ(extracted.Get(i), bitmap.Get(offset + i))
+            << "offset: " << offset << ", size: " << size << ", i: " << i;
+        ones_count += bitmap.Get(offset + i);
+      }
+      EXPECT_EQ(store->GetOnesCount(offset, size), ones_count);
+    }
+  }
+  // Last bits of the store.
+  const size_t tail_size = 70;
+  const Bitmap64 tail = store->Extract(bitmap.bits() - tail_size, tail_size);
+  for (size_t i = 0; i < tail_size; ++i)
+    ASSERT_EQ(tail.Get(i), bitmap.Get(bitmap.bits() - tail_size + i));
+
+  EXPECT_FALSE(store->Encode().empty());
+}
+
+TEST(SlotBitmapStoreTest, Rle) { CheckBackend(SlotBitmapBackend::RLE); }
+
+TEST(SlotBitmapStoreTest, Roaring) { CheckBackend(SlotBitmapBackend::ROARING); }
+
+TEST(SlotBitmapStoreTest, Dense) { CheckBackend(SlotBitmapBackend::DENSE); }
+
+TEST(SlotBitmapStoreTest, SortedList) {
+  CheckBackend(SlotBitmapBackend::SORTED_LIST);
+}
+
+TEST(SlotBitmapStoreTest, Auto) { CheckBackend(SlotBitmapBackend::AUTO); }
+
+TEST(SlotBitmapStoreTest, AutoPicksSmallBackendForSparseBitmap) {
+  // A very sparse bitmap: the dense encoding is an order of magnitude larger
+  // than all others and must never be picked.
+  Bitmap64 bitmap(/*size=*/kNumStripes * kNumSlots * 100);
+  bitmap.Set(42, true);
+  const SlotBitmapStorePtr store =
+      SlotBitmapStore::Create(SlotBitmapBackend::AUTO, bitmap, kNumStripes);
+  EXPECT_NE(store->backend(), SlotBitmapBackend::DENSE);
+  EXPECT_TRUE(store->Get(42));
+  EXPECT_EQ(store->GetOnesCount(), 1);
+}
+
+TEST(SlotBitmapStoreTest, AutoIsDeterministic) {
+  // Roughly half of the bits set: the dense encoding is (close to) the
+  // smallest one and the cheapest to extract.
+  Bitmap64 bitmap(/*size=*/kNumStripes * kNumSlots * 100);
+  for (size_t i = 0; i < bitmap.bits(); ++i)
+    bitmap.Set(i, (i * 2654435761u) % 7 < 3);
+  const SlotBitmapStorePtr store =
+      SlotBitmapStore::Create(SlotBitmapBackend::AUTO, bitmap, kNumStripes);
+  EXPECT_EQ(store->backend(), SlotBitmapBackend::DENSE);
+  for (int i = 0; i < 3; ++i) {
+    const SlotBitmapStorePtr other =
+        SlotBitmapStore::Create(SlotBitmapBackend::AUTO, bitmap, kNumStripes);
+    EXPECT_EQ(other->backend(), store->backend());
+    EXPECT_EQ(other->Encode(), store->Encode());
+  }
+}
+
+}  // namespace ci
@@ -0,0 +1,114 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: stripe_filters_test_util.h
+// -----------------------------------------------------------------------------
+//
+// Tests shared by sequences of per-stripe filters (BlockedBloomFilters and
+// BinaryFuseFilters). They're instantiated with a `Config` providing:
+//   using Filters = ..;  // The filters under test.
+//   static void AddFilter(absl::Span<const uint64_t> hashes, Filters* filters);
+// Example:
+//   INSTANTIATE_TYPED_TEST_SUITE_P(Bloom, StripeFiltersTest, BloomConfig);
+
+#ifndef CI_STRIPE_FILTERS_TEST_UTIL_H_
+#define CI_STRIPE_FILTERS_TEST_UTIL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/bitmap.h"
+#include "gtest/gtest.h"
+
+namespace ci {
+
+// Filter `i` contains the keys [StripeFilterOffset(i), StripeFilterOffset(i) +
+// kStripeFilterSizes[i]), with filters of varying sizes (including empty and
+// single-key ones).
+constexpr size_t kNumStripeFilters = 6;
+constexpr int kStripeFilterSizes[kNumStripeFilters] = {0, 1, 2, 100, 1000,
+                                                       20000};
+
+inline int StripeFilterOffset(size_t filter) {
+  int offset = 0;
+  for (size_t i = 0; i < filter; ++i) offset += kStripeFilterSizes[i];
+  return offset;
+}
+
+template <typename Config>
+typename Config::Filters CreateStripeFilters() {
+  typename Config::Filters filters;
+  for (size_t i = 0; i < kNumStripeFilters; ++i) {
+    std::vector<uint64_t> hashes;
+    for (int key = 0; key < kStripeFilterSizes[i]; ++key)
+      hashes.push_back(Config::Filters::Hash(StripeFilterOffset(i) + key));
+    Config::AddFilter(hashes, &filters);
+  }
+  return filters;
+}
+
+template <typename Config>
+class StripeFiltersTest : public ::testing::Test {};
+
+TYPED_TEST_SUITE_P(StripeFiltersTest);
+
+TYPED_TEST_P(StripeFiltersTest, NoFalseNegatives) {
+  using Filters = typename TypeParam::Filters;
+  const Filters filters = CreateStripeFilters<TypeParam>();
+  ASSERT_EQ(filters.num_filters(), kNumStripeFilters);
+  for (size_t i = 0; i < kNumStripeFilters; ++i) {
+    for (int key = 0; key < kStripeFilterSizes[i]; ++key) {
+      EXPECT_TRUE(
+          filters.Contains(i, Filters::Hash(StripeFilterOffset(i) + key)));
+    }
+  }
+}
+
+TYPED_TEST_P(StripeFiltersTest, EmptyFilterContainsNothing) {
+  using Filters = typename TypeParam::Filters;
+  const Filters filters = CreateStripeFilters<TypeParam>();
+  for (int key = -1000; key < StripeFilterOffset(kNumStripeFilters); ++key)
+    EXPECT_FALSE(filters.Contains(/*filter=*/0, Filters::Hash(key)));
+}
+
+TYPED_TEST_P(StripeFiltersTest, ContainsAllMatchesContains) {
+  using Filters = typename TypeParam::Filters;
+  const Filters filters = CreateStripeFilters<TypeParam>();
+  Bitmap64 candidates(/*size=*/kNumStripeFilters);
+  candidates.Set(1, true);
+  candidates.Set(4, true);
+
+  for (int key = -1000; key < StripeFilterOffset(kNumStripeFilters);
+       key += 7) {
+    const uint64_t hash = Filters::Hash(key);
+    Bitmap64 all(/*size=*/kNumStripeFilters);
+    filters.ContainsAll(hash, &all);
+    Bitmap64 among(/*size=*/kNumStripeFilters);
+    filters.ContainsAmong(hash, candidates, &among);
+    for (size_t i = 0; i < kNumStripeFilters; ++i) {
+      EXPECT_EQ(all.Get(i), filters.Contains(i, hash));
+      EXPECT_EQ(among.Get(i), candidates.Get(i) && filters.Contains(i, hash));
+    }
+  }
+}
+
+REGISTER_TYPED_TEST_SUITE_P(StripeFiltersTest, NoFalseNegatives,
+                            EmptyFilterContainsNothing,
+                            ContainsAllMatchesContains);
+
+}  // namespace ci
+
+#endif  // CI_STRIPE_FILTERS_TEST_UTIL_H_
@@ -0,0 +1,165 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: stripe_predicate.cc
+// -----------------------------------------------------------------------------
+
+#include "stripe_predicate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+namespace ci {
+namespace {
+
+// Selectivity estimates of a predicate and (recursively) of its children.
+// Computed once per evaluation, so that each leaf's index is only asked once.
+struct SelectivityEstimates {
+  double selectivity;
+  std::vector<SelectivityEstimates> children;
+};
+
+SelectivityEstimates EstimateSelectivities(const StripePredicate& predicate,
+                                           size_t num_stripes) {
+  SelectivityEstimates estimates;
+  switch (predicate.type()) {
+    case StripePredicate::Type::LEAF:
+      estimates.selectivity =
+          predicate.index()->EstimateSelectivity(predicate.value(),
+                                                 num_stripes);
+      break;
+    case StripePredicate::Type::AND:
+      estimates.selectivity = 1.0;
+      for (const StripePredicatePtr& child : predicate.children()) {
+        estimates.children.push_back(
+            EstimateSelectivities(*child, num_stripes));
+        estimates.selectivity *= estimates.children.back().selectivity;
+      }
+      break;
+    case StripePredicate::Type::OR: {
+      double non_selectivity = 1.0;
+      for (const StripePredicatePtr& child : predicate.children()) {
+        estimates.children.push_back(
+            EstimateSelectivities(*child, num_stripes));
+        non_selectivity *= 1.0 - estimates.children.back().selectivity;
+      }
+      estimates.selectivity = 1.0 - non_selectivity;
+      break;
+    }
+  }
+  return estimates;
+}
+
+// Returns the indexes of the children sorted by their estimated selectivity
+// (ascending if `most_selective_first` is set, else descending).
+std::vector<size_t> GetChildrenOrder(const SelectivityEstimates& estimates,
+                                     bool most_selective_first) {
+  const std::vector<SelectivityEstimates>& children = estimates.children;
+  std::vector<size_t> order(children.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return most_selective_first
+               ? children[a].selectivity < children[b].selectivity
+               : children[a].selectivity > children[b].selectivity;
+  });
+  return order;
+}
+
+// Returns the subset of `candidates` qualifying for `predicate`.
+// `estimates` belong to `predicate`.
+Bitmap64 Evaluate(const StripePredicate& predicate,
+                  const SelectivityEstimates& estimates,
+                  const Bitmap64& candidates) {
+  const size_t num_stripes = candidates.bits();
+  switch (predicate.type()) {
+    case StripePredicate::Type::LEAF:
+      if (candidates.GetOnesCount() == 0) return Bitmap64(num_stripes);
+      return predicate.index()->GetQualifyingStripesAmong(predicate.value(),
+                                                          candidates);
+    case StripePredicate::Type::AND: {
+      // Evaluate the most selective child first and pass on the shrinking
+      // candidate set.
+      Bitmap64 result(candidates);
+      for (const size_t i :
+           GetChildrenOrder(estimates, /*most_selective_first=*/true)) {
+        if (result.GetOnesCount() == 0) break;
+        // The child's result is a subset of `result`.
+        result &= Evaluate(*predicate.children()[i], estimates.children[i],
+                           result);
+      }
+      return result;
+    }
+    case StripePredicate::Type::OR: {
+      // Evaluate the least selective child first and only probe stripes that
+      // didn't qualify yet.
+      Bitmap64 result(num_stripes);
+      Bitmap64 remaining(candidates);
+      for (const size_t i :
+           GetChildrenOrder(estimates, /*most_selective_first=*/false)) {
+        if (remaining.GetOnesCount() == 0) break;
+        const Bitmap64 qualifying = Evaluate(
+            *predicate.children()[i], estimates.children[i], remaining);
+        result |= qualifying;
+        remaining.AndNot(qualifying);
+      }
+      return result;
+    }
+  }
+  std::cerr << "Unknown predicate type: "
+            << static_cast<int>(predicate.type()) << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+}  // namespace
+
+StripePredicatePtr StripePredicate::Leaf(const IndexStructure* index,
+                                         int value) {
+  return StripePredicatePtr(
+      new StripePredicate(Type::LEAF, index, value, /*children=*/{}));
+}
+
+StripePredicatePtr StripePredicate::And(
+    std::vector<StripePredicatePtr> children) {
+  if (children.empty()) {
+    std::cerr << "AND predicate without children." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return StripePredicatePtr(new StripePredicate(
+      Type::AND, /*index=*/nullptr, /*value=*/0, std::move(children)));
+}
+
+StripePredicatePtr StripePredicate::Or(
+    std::vector<StripePredicatePtr> children) {
+  if (children.empty()) {
+    std::cerr << "OR predicate without children." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return StripePredicatePtr(new StripePredicate(
+      Type::OR, /*index=*/nullptr, /*value=*/0, std::move(children)));
+}
+
+double StripePredicate::EstimateSelectivity(size_t num_stripes) const {
+  return EstimateSelectivities(*this, num_stripes).selectivity;
+}
+
+Bitmap64 EvaluateStripePredicate(const StripePredicate& predicate,
+                                 size_t num_stripes) {
+  return Evaluate(predicate, EstimateSelectivities(predicate, num_stripes),
+                  Bitmap64(num_stripes, /*fill_value=*/true));
+}
+
+}  // namespace ci
@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: stripe_predicate.h
+// -----------------------------------------------------------------------------
+//
+// Boolean trees of equality predicates on multiple columns (each leaf probes
+// the IndexStructure of one column) that are evaluated to the set of
+// qualifying stripes. Children of AND nodes are evaluated in order of their
+// estimated selectivity and each probe only considers the stripes that still
+// qualify, so that e.g. a CuckooIndex only decodes the relevant parts of its
+// slot bitmaps.
+
+#ifndef CUCKOO_INDEX_STRIPE_PREDICATE_H_
+#define CUCKOO_INDEX_STRIPE_PREDICATE_H_
+
+#include <memory>
+#include <vector>
+
+#include "common/bitmap.h"
+#include "index_structure.h"
+
+namespace ci {
+
+class StripePredicate;
+using StripePredicatePtr = std::unique_ptr<StripePredicate>;
+
+class StripePredicate {
+ public:
+  enum class Type { LEAF, AND, OR };
+
+  // Returns a predicate `column = value`, where `index` is the index structure
+  // of the column. `index` is not owned and has to outlive the predicate.
+  static StripePredicatePtr Leaf(const IndexStructure* index, int value);
+
+  // Returns the conjunction of `children` (must not be empty).
+  static StripePredicatePtr And(std::vector<StripePredicatePtr> children);
+
+  // Returns the disjunction of `children` (must not be empty).
+  static StripePredicatePtr Or(std::vector<StripePredicatePtr> children);
+
+  Type type() const { return type_; }
+
+  // Only set for leaves.
+  const IndexStructure* index() const { return index_; }
+  int value() const { return value_; }
+
+  // Only set for AND and OR nodes.
+  const std::vector<StripePredicatePtr>& children() const { return children_; }
+
+  // Returns an estimate of the share of the `num_stripes` stripes qualifying
+  // for this predicate (assuming independent columns).
+  double EstimateSelectivity(size_t num_stripes) const;
+
+ private:
+  StripePredicate(Type type, const IndexStructure* index, int value,
+                  std::vector<StripePredicatePtr> children)
+      : type_(type),
+        index_(index),
+        value_(value),
+        children_(std::move(children)) {}
+
+  const Type type_;
+  const IndexStructure* const index_;
+  const int value_;
+  const std::vector<StripePredicatePtr> children_;
+};
+
+// Returns the stripes (out of `num_stripes`) that possibly qualify for
+// `predicate`. Stops probing as soon as the candidate set becomes empty.
+Bitmap64 EvaluateStripePredicate(const StripePredicate& predicate,
+                                 size_t num_stripes);
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_STRIPE_PREDICATE_H_
@@ -0,0 +1,218 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: stripe_predicate_test.cc
+// -----------------------------------------------------------------------------
+
+#include "stripe_predicate.h"
+
+#include <vector>
+
+#include "cuckoo_index.h"
+#include "data.h"
+#include "gtest/gtest.h"
+#include "zone_map.h"
+
+namespace ci {
+
+constexpr size_t kNumRowsPerStripe = 2;
+
+// Counts lookups (and the probed stripes) and selectivity estimates of the
+// wrapped index.
+class CountingIndex : public IndexStructure {
+ public:
+  explicit CountingIndex(const IndexStructure* index) : index_(index) {}
+
+  bool StripeContains(size_t stripe_id, int value) const override {
+    ++num_probed_stripes_;
+    return index_->StripeContains(stripe_id, value);
+  }
+  double EstimateSelectivity(int value, size_t num_stripes) const override {
+    ++num_estimates_;
+    return index_->EstimateSelectivity(value, num_stripes);
+  }
+  std::string name() const override { return "CountingIndex"; }
+  size_t byte_size() const override { return 0; }
+  size_t compressed_byte_size() const override { return 0; }
+
+  size_t num_probed_stripes() const { return num_probed_stripes_; }
+  size_t num_estimates() const { return num_estimates_; }
+
+ private:
+  const IndexStructure* const index_;
+  mutable size_t num_probed_stripes_ = 0;
+  mutable size_t num_estimates_ = 0;
+};
+
+class StripePredicateTest : public ::testing::Test {
+ protected:
+  StripePredicateTest()
+      // 8 stripes: stripe i contains values i + 1 and 10 * (i % 4 + 1).
+      : column_a_(Column::IntColumn("a", {1, 10, 2, 20, 3, 30, 4, 40, 5, 10, 6,
+                                          20, 7, 30, 8, 40})),
+        // 8 stripes: stripe i contains value 100 + i / 2.
+        column_b_(Column::IntColumn("b", {100, 100, 100, 100, 101, 101, 101,
+                                          101, 102, 102, 102, 102, 103, 103,
+                                          103, 103})),
+        zone_map_a_(*column_a_, kNumRowsPerStripe),
+        cuckoo_index_b_(CuckooIndexFactory(CuckooAlgorithm::KICKING,
+                                           kMaxLoadFactor2SlotsPerBucket,
+                                           /*scan_rate=*/0.01,
+                                           /*slots_per_bucket=*/2,
+                                           /*prefix_bits_optimization=*/false)
+                            .Create(*column_b_, kNumRowsPerStripe)) {}
+
+  // Returns the qualifying stripes of `value` in `index` via
+  // GetQualifyingStripes(..).
+  Bitmap64 Lookup(const IndexStructure& index, int value) const {
+    return index.GetQualifyingStripes(value, kNumStripes);
+  }
+
+  static constexpr size_t kNumStripes = 8;
+  const ColumnPtr column_a_;
+  const ColumnPtr column_b_;
+  const ZoneMap zone_map_a_;
+  const IndexStructurePtr cuckoo_index_b_;
+};
+
+TEST_F(StripePredicateTest, Leaf) {
+  const StripePredicatePtr predicate =
+      StripePredicate::Leaf(cuckoo_index_b_.get(), 101);
+  EXPECT_EQ(EvaluateStripePredicate(*predicate, kNumStripes).ToString(),
+            Lookup(*cuckoo_index_b_, 101).ToString());
+}
+
+TEST_F(StripePredicateTest, AndMatchesIntersection) {
+  std::vector<StripePredicatePtr> children;
+  children.push_back(StripePredicate::Leaf(&zone_map_a_, 20));
+  children.push_back(StripePredicate::Leaf(cuckoo_index_b_.get(), 102));
+  const StripePredicatePtr predicate =
+      StripePredicate::And(std::move(children));
+
+  Bitmap64 expected = Lookup(zone_map_a_, 20);
+  expected &= Lookup(*cuckoo_index_b_, 102);
+  EXPECT_EQ(EvaluateStripePredicate(*predicate, kNumStripes).ToString(),
+            expected.ToString());
+}
+
+TEST_F(StripePredicateTest, OrMatchesUnion) {
+  std::vector<StripePredicatePtr> children;
+  children.push_back(StripePredicate::Leaf(&zone_map_a_, 3));
+  children.push_back(StripePredicate::Leaf(cuckoo_index_b_.get(), 103));
+  const StripePredicatePtr predicate =
+      StripePredicate::Or(std::move(children));
+
+  Bitmap64 expected = Lookup(zone_map_a_, 3);
+  expected |= Lookup(*cuckoo_index_b_, 103);
+  EXPECT_EQ(EvaluateStripePredicate(*predicate, kNumStripes).ToString(),
+            expected.ToString());
+}
+
+TEST_F(StripePredicateTest, NestedPredicate) {
+  // (a = 30 OR a = 4) AND b = 101
+  std::vector<StripePredicatePtr> or_children;
+  or_children.push_back(StripePredicate::Leaf(&zone_map_a_, 30));
+  or_children.push_back(StripePredicate::Leaf(&zone_map_a_, 4));
+  std::vector<StripePredicatePtr> and_children;
+  and_children.push_back(StripePredicate::Or(std::move(or_children)));
+  and_children.push_back(StripePredicate::Leaf(cuckoo_index_b_.get(), 101));
+  const StripePredicatePtr predicate =
+      StripePredicate::And(std::move(and_children));
+
+  Bitmap64 expected = Lookup(zone_map_a_, 30);
+  expected |= Lookup(zone_map_a_, 4);
+  expected &= Lookup(*cuckoo_index_b_, 101);
+  EXPECT_EQ(EvaluateStripePredicate(*predicate, kNumStripes).ToString(),
+            expected.ToString());
+}
+
+TEST_F(StripePredicateTest, AndEvaluatesMostSelectiveChildFirst) {
+  // b = 100 qualifies 2 of 8 stripes. The counting index (without selectivity
+  // estimates) is evaluated afterwards and only probes these 2 stripes.
+  const CountingIndex counting_a(&zone_map_a_);
+  std::vector<StripePredicatePtr> children;
+  children.push_back(StripePredicate::Leaf(&counting_a, 10));
+  children.push_back(StripePredicate::Leaf(cuckoo_index_b_.get(), 100));
+  const StripePredicatePtr predicate =
+      StripePredicate::And(std::move(children));
+
+  Bitmap64 expected = Lookup(zone_map_a_, 10);
+  expected &= Lookup(*cuckoo_index_b_, 100);
+  EXPECT_EQ(EvaluateStripePredicate(*predicate, kNumStripes).ToString(),
+            expected.ToString());
+  EXPECT_EQ(counting_a.num_probed_stripes(), 2);
+}
+
+TEST_F(StripePredicateTest, AndShortCircuitsOnEmptyCandidates) {
+  const CountingIndex counting_a(&zone_map_a_);
+  std::vector<StripePredicatePtr> children;
+  children.push_back(StripePredicate::Leaf(&counting_a, 1));
+  // Find a value without false positives in column b's index.
+  int absent_value = 1000;
+  while (cuckoo_index_b_->EstimateSelectivity(absent_value, kNumStripes) > 0) {
+    ++absent_value;
+  }
+  children.push_back(
+      StripePredicate::Leaf(cuckoo_index_b_.get(), absent_value));
+  const StripePredicatePtr predicate =
+      StripePredicate::And(std::move(children));
+
+  EXPECT_EQ(EvaluateStripePredicate(*predicate, kNumStripes).GetOnesCount(),
+            0);
+  EXPECT_EQ(counting_a.num_probed_stripes(), 0);
+}
+
+TEST_F(StripePredicateTest, OrOnlyProbesRemainingStripes) {
+  const CountingIndex first(&zone_map_a_);
+  const CountingIndex second(&zone_map_a_);
+  std::vector<StripePredicatePtr> children;
+  children.push_back(StripePredicate::Leaf(&first, 5));
+  children.push_back(StripePredicate::Leaf(&second, 30));
+  const StripePredicatePtr predicate =
+      StripePredicate::Or(std::move(children));
+
+  const Bitmap64 first_result = Lookup(zone_map_a_, 5);
+  Bitmap64 expected(first_result);
+  expected |= Lookup(zone_map_a_, 30);
+  EXPECT_EQ(EvaluateStripePredicate(*predicate, kNumStripes).ToString(),
+            expected.ToString());
+  // Both children have the same (default) selectivity estimate, so they are
+  // evaluated in order and the second one only probes stripes that didn't
+  // qualify for the first one.
+  EXPECT_EQ(first.num_probed_stripes(), kNumStripes);
+  EXPECT_EQ(second.num_probed_stripes(),
+            kNumStripes - first_result.GetOnesCount());
+}
+
+TEST_F(StripePredicateTest, EstimatesEachLeafOnce) {
+  // ((a = 1 AND a = 2) OR a = 3) AND a = 4, nested three levels deep.
+  const CountingIndex counting_a(&zone_map_a_);
+  std::vector<StripePredicatePtr> inner_children;
+  inner_children.push_back(StripePredicate::Leaf(&counting_a, 1));
+  inner_children.push_back(StripePredicate::Leaf(&counting_a, 2));
+  std::vector<StripePredicatePtr> or_children;
+  or_children.push_back(StripePredicate::And(std::move(inner_children)));
+  or_children.push_back(StripePredicate::Leaf(&counting_a, 3));
+  std::vector<StripePredicatePtr> and_children;
+  and_children.push_back(StripePredicate::Or(std::move(or_children)));
+  and_children.push_back(StripePredicate::Leaf(&counting_a, 4));
+  const StripePredicatePtr predicate =
+      StripePredicate::And(std::move(and_children));
+
+  EvaluateStripePredicate(*predicate, kNumStripes);
+  EXPECT_EQ(counting_a.num_estimates(), 4);
+}
+
+}  // namespace ci
@@ -0,0 +1,48 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: table_flags.cc
+// -----------------------------------------------------------------------------
+
+#include "table_flags.h"
+
+#include "absl/flags/flag.h"
+
+ABSL_FLAG(int, generate_num_values, 100000,
+          "Number of values to generate (number of rows).");
+ABSL_FLAG(int, num_unique_values, 1000,
+          "Number of unique values to generate (cardinality).");
+ABSL_FLAG(std::string, input_csv_path, "", "Path to the input CSV file.");
+ABSL_FLAG(std::string, table_cache_path, "",
+          "Path to a binary table cache. If the file was written for the same "
+          "inputs (CSV file and --columns_to_test, or generation flags), the "
+          "table is mapped from it instead of being loaded from "
+          "--input_csv_path (or generated). Otherwise, the loaded table is "
+          "written to it.");
+ABSL_FLAG(std::vector<std::string>, columns_to_test, {},
+          "Comma-separated list of columns to tests, e.g. "
+          "'company_name,country_code'.");
+
+namespace ci {
+
+std::unique_ptr<Table> LoadTableFromFlags() {
+  return Table::LoadOrCreate(absl::GetFlag(FLAGS_table_cache_path),
+                             absl::GetFlag(FLAGS_input_csv_path),
+                             absl::GetFlag(FLAGS_columns_to_test),
+                             absl::GetFlag(FLAGS_generate_num_values),
+                             absl::GetFlag(FLAGS_num_unique_values));
+}
+
+}  // namespace ci
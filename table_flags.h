@@ -0,0 +1,45 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: table_flags.h
+// -----------------------------------------------------------------------------
+//
+// Command-line flags selecting the table the binaries (evaluate,
+// lookup_benchmark and build_benchmark) run on.
+
+#ifndef CUCKOO_INDEX_TABLE_FLAGS_H_
+#define CUCKOO_INDEX_TABLE_FLAGS_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "data.h"
+
+ABSL_DECLARE_FLAG(int, generate_num_values);
+ABSL_DECLARE_FLAG(int, num_unique_values);
+ABSL_DECLARE_FLAG(std::string, input_csv_path);
+ABSL_DECLARE_FLAG(std::string, table_cache_path);
+ABSL_DECLARE_FLAG(std::vector<std::string>, columns_to_test);
+
+namespace ci {
+
+// Returns the table selected by the flags above (see Table::LoadOrCreate(..)).
+std::unique_ptr<Table> LoadTableFromFlags();
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_TABLE_FLAGS_H_
@@ -19,10 +19,15 @@
 #ifndef CI_XOR_FILTER_H_
 #define CI_XOR_FILTER_H_
 
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
-#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "include/xorfilter.h"
 
 namespace ci {
@@ -58,19 +63,53 @@ class Xor8 {
     return xor8_contain(key, &filter_);
   }
 
-  std::string Data() const {
-    std::string data;
-    absl::StrAppend(&data, filter_.seed);
-    absl::StrAppend(&data, filter_.blockLength);
-    const size_t num_fingerprints = 3 * filter_.blockLength;
-    for (size_t i = 0; i < num_fingerprints; ++i)
-      absl::StrAppend(&data, filter_.fingerprints[i]);
-    return data;
+  // Appends the binary encoding of the filter to `out`. Layout: seed, block
+  // length, followed by the 3 * block length fingerprints.
+  void Encode(std::string* out) const {
+    const uint64_t header[2] = {filter_.seed, filter_.blockLength};
+    out->append(reinterpret_cast<const char*>(header), sizeof(header));
+    out->append(reinterpret_cast<const char*>(filter_.fingerprints),
+                3 * filter_.blockLength);
+  }
+
+  // Decodes a filter encoded with Encode(..) starting at `encoded[*pos]` and
+  // advances `pos` past it.
+  static std::unique_ptr<Xor8> Decode(absl::string_view encoded, size_t* pos) {
+    uint64_t header[2];
+    if (*pos + sizeof(header) > encoded.size()) {
+      std::cerr << "Invalid Xor filter encoding." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    std::memcpy(header, encoded.data() + *pos, sizeof(header));
+    *pos += sizeof(header);
+    const size_t num_fingerprints = 3 * header[1];
+    if (*pos + num_fingerprints > encoded.size()) {
+      std::cerr << "Invalid Xor filter encoding." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    std::unique_ptr<Xor8> xor8(new Xor8());
+    xor8->filter_.seed = header[0];
+    xor8->filter_.blockLength = header[1];
+    // Allocated with malloc(..), since xor8_free(..) releases it with free(..).
+    xor8->filter_.fingerprints =
+        static_cast<uint8_t*>(std::malloc(num_fingerprints));
+    if (xor8->filter_.fingerprints == nullptr) {
+      std::cerr << "Couldn't allocate Xor filter." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    std::memcpy(xor8->filter_.fingerprints, encoded.data() + *pos,
+                num_fingerprints);
+    *pos += num_fingerprints;
+    return xor8;
   }
 
   size_t SizeInBytes() const { return xor8_size_in_bytes(&filter_); }
 
  private:
+  // Used by Decode(..).
+  Xor8() : filter_() {}
+
   xor8_s filter_;
 };
 
@@ -19,6 +19,8 @@
 #include "xor_filter.h"
 
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -52,4 +54,22 @@ TEST(Xor8Test, CheckForLowFalsePositiveProbability) {
   EXPECT_LT(false_positive_probability, 0.01);
 }
 
+TEST(Xor8Test, EncodeDecode) {
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < kNumKeys; ++i) keys.push_back(i);
+  Xor8 xor8(keys);
+
+  std::string encoded;
+  xor8.Encode(&encoded);
+  // Binary encoding: 16 bytes of header plus one byte per fingerprint.
+  EXPECT_LT(encoded.size(), xor8.SizeInBytes() + 16);
+
+  size_t pos = 0;
+  const std::unique_ptr<Xor8> decoded = Xor8::Decode(encoded, &pos);
+  EXPECT_EQ(pos, encoded.size());
+  std::string reencoded;
+  decoded->Encode(&reencoded);
+  EXPECT_EQ(reencoded, encoded);
+}
+
 }  // namespace ci
@@ -0,0 +1,288 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: zone_map.cc
+// -----------------------------------------------------------------------------
+
+#include "zone_map.h"
+
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CI_ZONE_MAP_X86 1
+#endif
+
+namespace ci {
+namespace {
+
+using zone_map_internal::QualifyingBitsFn;
+
+uint64_t QualifyingBits(const int* minimums, const int* maximums,
+                        size_t num_zones, int value) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < num_zones; ++i) {
+    const uint64_t qualifies = (value >= minimums[i]) & (value <= maximums[i]);
+    bits |= qualifies << i;
+  }
+  return bits;
+}
+
+#ifdef CI_ZONE_MAP_X86
+// SSE2 is part of x86-64, so this version needs no runtime check.
+uint64_t QualifyingBitsSse2(const int* minimums, const int* maximums,
+                            size_t num_zones, int value) {
+  const __m128i values = _mm_set1_epi32(value);
+  uint64_t bits = 0;
+  size_t i = 0;
+  for (; i + 4 <= num_zones; i += 4) {
+    const __m128i mins =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(minimums + i));
+    const __m128i maxs =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(maximums + i));
+    // A zone doesn't qualify if `min > value` or `value > max`.
+    const __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(mins, values),
+                                         _mm_cmpgt_epi32(values, maxs));
+    const uint64_t mask = ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xf;
+    bits |= mask << i;
+  }
+  return bits | (QualifyingBits(minimums + i, maximums + i, num_zones - i,
+                                value)
+                 << i);
+}
+
+__attribute__((target("avx2"))) uint64_t QualifyingBitsAvx2(
+    const int* minimums, const int* maximums, size_t num_zones, int value) {
+  const __m256i values = _mm256_set1_epi32(value);
+  uint64_t bits = 0;
+  size_t i = 0;
+  for (; i + 8 <= num_zones; i += 8) {
+    const __m256i mins =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(minimums + i));
+    const __m256i maxs =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(maximums + i));
+    const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(mins, values),
+                                            _mm256_cmpgt_epi32(values, maxs));
+    const uint64_t mask =
+        ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xff;
+    bits |= mask << i;
+  }
+  return bits | (QualifyingBits(minimums + i, maximums + i, num_zones - i,
+                                value)
+                 << i);
+}
+#endif
+
+QualifyingBitsFn GetQualifyingBitsFn() {
+  static const QualifyingBitsFn fn =
+      zone_map_internal::GetQualifyingBitsKernels().back().fn;
+  return fn;
+}
+
+// Sets the bits [`begin`, `end`) in `words`.
+void SetRange(size_t begin, size_t end, uint64_t* words) {
+  while (begin < end) {
+    const size_t word = begin / 64;
+    const size_t offset = begin % 64;
+    const size_t count = std::min<size_t>(64 - offset, end - begin);
+    const uint64_t mask =
+        count == 64 ? ~uint64_t{0} : ((uint64_t{1} << count) - 1) << offset;
+    words[word] |= mask;
+    begin += count;
+  }
+}
+
+// Sets the bits of the stripes in [`begin`, `end`) that qualify for `value` in
+// `words`, running the kernel on the parts of the range within each word.
+void SetQualifyingBits(const int* minimums, const int* maximums, size_t begin,
+                       size_t end, int value, uint64_t* words) {
+  const QualifyingBitsFn qualifying_bits = GetQualifyingBitsFn();
+  while (begin < end) {
+    const size_t offset = begin % 64;
+    const size_t count = std::min<size_t>(64 - offset, end - begin);
+    words[begin / 64] |=
+        qualifying_bits(minimums + begin, maximums + begin, count, value)
+        << offset;
+    begin += count;
+  }
+}
+
+}  // namespace
+
+namespace zone_map_internal {
+
+std::vector<QualifyingBitsKernel> GetQualifyingBitsKernels() {
+  std::vector<QualifyingBitsKernel> kernels = {{"scalar", QualifyingBits}};
+#ifdef CI_ZONE_MAP_X86
+  kernels.push_back({"sse2", QualifyingBitsSse2});
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"avx2", QualifyingBitsAvx2});
+#endif
+  return kernels;
+}
+
+}  // namespace zone_map_internal
+
+void ZoneMap::DetectMonotoneZones() {
+  // Empty zones (min > max) don't contain any value and are skipped.
+  bool has_empty_zones = false;
+  bool has_previous = false;
+  int previous_min = 0, previous_max = 0;
+  monotone_ = true;
+  for (size_t i = 0; i < num_stripes_; ++i) {
+    if (minimums_[i] > maximums_[i]) {
+      has_empty_zones = true;
+      continue;
+    }
+    if (has_previous &&
+        (minimums_[i] < previous_min || maximums_[i] < previous_max)) {
+      monotone_ = false;
+      return;
+    }
+    has_previous = true;
+    previous_min = minimums_[i];
+    previous_max = maximums_[i];
+  }
+  if (!has_empty_zones) return;
+
+  range_minimums_ = minimums_;
+  range_maximums_ = maximums_;
+  empty_zone_words_.assign((num_stripes_ + 63) / 64, 0);
+  int max = std::numeric_limits<int>::min();
+  for (size_t i = 0; i < num_stripes_; ++i) {
+    if (minimums_[i] > maximums_[i]) {
+      range_maximums_[i] = max;
+      empty_zone_words_[i / 64] |= uint64_t{1} << (i % 64);
+    } else {
+      max = maximums_[i];
+    }
+  }
+  int min = std::numeric_limits<int>::max();
+  for (size_t i = num_stripes_; i-- > 0;) {
+    if (minimums_[i] > maximums_[i]) {
+      range_minimums_[i] = min;
+    } else {
+      min = minimums_[i];
+    }
+  }
+}
+
+void ZoneMap::BuildLevels() {
+  const std::vector<int>* minimums = &minimums_;
+  const std::vector<int>* maximums = &maximums_;
+  while (minimums->size() > fan_out_) {
+    const size_t num_zones = (minimums->size() + fan_out_ - 1) / fan_out_;
+    std::vector<int> level_minimums(num_zones);
+    std::vector<int> level_maximums(num_zones);
+    for (size_t zone = 0; zone < num_zones; ++zone) {
+      const size_t begin = zone * fan_out_;
+      const size_t end = std::min(begin + fan_out_, minimums->size());
+      level_minimums[zone] = *std::min_element(minimums->begin() + begin,
+                                               minimums->begin() + end);
+      level_maximums[zone] = *std::max_element(maximums->begin() + begin,
+                                               maximums->begin() + end);
+    }
+    level_minimums_.push_back(std::move(level_minimums));
+    level_maximums_.push_back(std::move(level_maximums));
+    minimums = &level_minimums_.back();
+    maximums = &level_maximums_.back();
+  }
+}
+
+void ZoneMap::SetQualifyingRange(int value, size_t num_stripes,
+                                 uint64_t* words) const {
+  const std::vector<int>& minimums =
+      range_minimums_.empty() ? minimums_ : range_minimums_;
+  const std::vector<int>& maximums =
+      range_maximums_.empty() ? maximums_ : range_maximums_;
+  // Both are non-decreasing, so stripes qualify iff they're at or after the
+  // first one with `max >= value` and before the first one with `min > value`.
+  const size_t begin =
+      std::lower_bound(maximums.begin(), maximums.begin() + num_stripes,
+                       value) -
+      maximums.begin();
+  const size_t end =
+      std::upper_bound(minimums.begin(), minimums.begin() + num_stripes,
+                       value) -
+      minimums.begin();
+  SetRange(begin, end, words);
+  if (!empty_zone_words_.empty()) {
+    for (size_t word = begin / 64; word < (end + 63) / 64; ++word)
+      words[word] &= ~empty_zone_words_[word];
+  }
+}
+
+void ZoneMap::SetQualifyingInLevels(int value, size_t num_stripes,
+                                    uint64_t* words) const {
+  const size_t top_level = level_minimums_.size() - 1;
+  // Number of stripes spanned by a zone at `top_level`.
+  size_t zone_num_stripes = fan_out_;
+  for (size_t level = 0; level < top_level; ++level)
+    zone_num_stripes *= fan_out_;
+  for (size_t zone = 0; zone < level_minimums_[top_level].size(); ++zone) {
+    DescendLevels(top_level, zone, zone_num_stripes, value, num_stripes,
+                  words);
+  }
+}
+
+void ZoneMap::DescendLevels(size_t level, size_t zone, size_t zone_num_stripes,
+                            int value, size_t num_stripes,
+                            uint64_t* words) const {
+  if (zone * zone_num_stripes >= num_stripes) return;
+  if (value < level_minimums_[level][zone] ||
+      value > level_maximums_[level][zone]) {
+    return;
+  }
+  const size_t begin = zone * fan_out_;
+  if (level == 0) {
+    SetQualifyingBits(minimums_.data(), maximums_.data(), begin,
+                      std::min(begin + fan_out_, num_stripes), value, words);
+    return;
+  }
+  const size_t end =
+      std::min(begin + fan_out_, level_minimums_[level - 1].size());
+  for (size_t child = begin; child < end; ++child) {
+    DescendLevels(level - 1, child, zone_num_stripes / fan_out_, value,
+                  num_stripes, words);
+  }
+}
+
+void ZoneMap::ComputeQualifyingWords(absl::Span<const int> values,
+                                     size_t num_stripes, bool combine,
+                                     uint64_t* words) const {
+  const QualifyingBitsFn qualifying_bits = GetQualifyingBitsFn();
+  const size_t num_words = (num_stripes + 63) / 64;
+  // Iterate over the zones in the outer loop, so that each block of
+  // `minimums_` and `maximums_` is only loaded once for all `values`.
+  for (size_t word = 0; word < num_words; ++word) {
+    const size_t begin = word * 64;
+    const size_t num_zones = std::min<size_t>(64, num_stripes - begin);
+    const int* minimums = minimums_.data() + begin;
+    const int* maximums = maximums_.data() + begin;
+    if (combine) {
+      uint64_t bits = 0;
+      for (const int value : values)
+        bits |= qualifying_bits(minimums, maximums, num_zones, value);
+      words[word] = bits;
+    } else {
+      for (size_t i = 0; i < values.size(); ++i) {
+        words[i * num_words + word] =
+            qualifying_bits(minimums, maximums, num_zones, values[i]);
+      }
+    }
+  }
+}
+
+}  // namespace ci
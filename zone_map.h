@@ -20,22 +20,63 @@
 #define CUCKOO_INDEX_ZONE_MAP_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <string>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "data.h"
 #include "evaluation_utils.h"
 #include "index_structure.h"
 
 namespace ci {
 
+namespace zone_map_internal {
+
+// Returns a word whose i-th bit is set if `minimums[i] <= value <=
+// maximums[i]` for i in [0, `num_zones`), `num_zones` <= 64.
+using QualifyingBitsFn = uint64_t (*)(const int* minimums, const int* maximums,
+                                      size_t num_zones, int value);
+
+struct QualifyingBitsKernel {
+  const char* name;
+  QualifyingBitsFn fn;
+};
+
+// Returns the implementations of QualifyingBitsFn supported by the CPU: the
+// portable one first, followed by SIMD ones in increasing order of preference.
+// ZoneMap uses the last one. Exposed for testing.
+std::vector<QualifyingBitsKernel> GetQualifyingBitsKernels();
+
+}  // namespace zone_map_internal
+
+// Per-stripe minimums and maximums.
+//
+// Lookups are sublinear in the number of stripes in two cases:
+//  - If the zones are monotone (i.e., minimums and maximums of non-empty zones
+//    are both non-decreasing, as for sorted or time-partitioned data), which
+//    is detected at build time, the qualifying stripes form a single range
+//    (minus empty zones) that is found by binary search.
+//  - Otherwise, if `fan_out` > 0, zones are recursively grouped into
+//    coarser zones of `fan_out` zones each. Lookups descend from the coarsest
+//    level and skip all stripes of non-qualifying coarse zones, which pays off
+//    for clustered data.
+// Else, lookups scan all zones (with SIMD).
 class ZoneMap : public IndexStructure {
  public:
-  ZoneMap(const std::vector<int>& data, std::size_t num_rows_per_stripe) {
+  ZoneMap(absl::Span<const int> data, std::size_t num_rows_per_stripe,
+          std::size_t fan_out = 0)
+      : fan_out_(fan_out) {
+    if (fan_out_ == 1) {
+      std::cerr << "`fan_out` has to be 0 (no hierarchy) or at least 2."
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
     if (data.size() % num_rows_per_stripe != 0) {
       std::cout << "WARNING: Number of values is not a multiple of "
                    "`num_rows_per_stripe`. Ignoring last stripe."
@@ -61,10 +102,13 @@ class ZoneMap : public IndexStructure {
       minimums_.push_back(per_stripe_min);
       maximums_.push_back(per_stripe_max);
     }
+    DetectMonotoneZones();
+    if (!monotone_ && fan_out_ > 0) BuildLevels();
   }
 
-  ZoneMap(const Column& column, std::size_t num_rows_per_stripe)
-      : ZoneMap(column.data(), num_rows_per_stripe) {}
+  ZoneMap(const Column& column, std::size_t num_rows_per_stripe,
+          std::size_t fan_out = 0)
+      : ZoneMap(column.data(), num_rows_per_stripe, fan_out) {}
 
   void PrintZones() {
     for (size_t i = 0; i < num_stripes_; ++i) {
@@ -81,10 +125,83 @@ class ZoneMap : public IndexStructure {
     return value >= minimums_[stripe_id] && value <= maximums_[stripe_id];
   }
 
-  std::string name() const override { return "ZoneMap"; }
+  Bitmap64 GetQualifyingStripes(int value,
+                                std::size_t num_stripes) const override {
+    CheckNumStripes(num_stripes);
+    std::vector<uint64_t> words((num_stripes + 63) / 64);
+    if (monotone_) {
+      SetQualifyingRange(value, num_stripes, words.data());
+    } else if (!level_minimums_.empty()) {
+      SetQualifyingInLevels(value, num_stripes, words.data());
+    } else {
+      ComputeQualifyingWords({value}, num_stripes, /*combine=*/false,
+                             words.data());
+    }
+    return Bitmap64::FromWords(words.data(), num_stripes);
+  }
+
+  Bitmap64 GetQualifyingStripesIn(absl::Span<const int> values,
+                                  std::size_t num_stripes) const override {
+    CheckNumStripes(num_stripes);
+    std::vector<uint64_t> words((num_stripes + 63) / 64);
+    if (monotone_) {
+      for (const int value : values)
+        SetQualifyingRange(value, num_stripes, words.data());
+    } else if (!level_minimums_.empty()) {
+      for (const int value : values)
+        SetQualifyingInLevels(value, num_stripes, words.data());
+    } else {
+      ComputeQualifyingWords(values, num_stripes, /*combine=*/true,
+                             words.data());
+    }
+    return Bitmap64::FromWords(words.data(), num_stripes);
+  }
+
+  // Cheaper than calling GetQualifyingStripes(..) for each value, since the
+  // zones are only scanned once.
+  std::vector<Bitmap64> GetQualifyingStripesBatch(
+      absl::Span<const int> values, std::size_t num_stripes) const override {
+    CheckNumStripes(num_stripes);
+    const size_t num_words = (num_stripes + 63) / 64;
+    std::vector<uint64_t> words(values.size() * num_words);
+    if (monotone_ || !level_minimums_.empty()) {
+      for (size_t i = 0; i < values.size(); ++i) {
+        uint64_t* row = words.data() + i * num_words;
+        if (monotone_) {
+          SetQualifyingRange(values[i], num_stripes, row);
+        } else {
+          SetQualifyingInLevels(values[i], num_stripes, row);
+        }
+      }
+    } else {
+      ComputeQualifyingWords(values, num_stripes, /*combine=*/false,
+                             words.data());
+    }
+    std::vector<Bitmap64> result;
+    result.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      result.push_back(
+          Bitmap64::FromWords(words.data() + i * num_words, num_stripes));
+    }
+    return result;
+  }
+
+  std::string name() const override {
+    return fan_out_ == 0 ? "ZoneMap"
+                         : "ZoneMap/" + std::to_string(fan_out_);
+  }
 
   size_t byte_size() const override {
-    return sizeof(int) * minimums_.size() + sizeof(int) * maximums_.size();
+    size_t result =
+        sizeof(int) * minimums_.size() + sizeof(int) * maximums_.size();
+    result += sizeof(int) * range_minimums_.size() +
+              sizeof(int) * range_maximums_.size() +
+              sizeof(uint64_t) * empty_zone_words_.size();
+    for (size_t level = 0; level < level_minimums_.size(); ++level) {
+      result += sizeof(int) * level_minimums_[level].size() +
+                sizeof(int) * level_maximums_[level].size();
+    }
+    return result;
   }
 
   size_t compressed_byte_size() const override {
@@ -101,19 +218,81 @@ class ZoneMap : public IndexStructure {
 
   std::size_t num_stripes() { return num_stripes_; }
 
+  // Returns true if the zones are monotone, i.e., lookups binary-search them.
+  bool monotone() const { return monotone_; }
+
+  // Returns the number of levels of coarser zones above the stripes' zones.
+  std::size_t num_levels() const { return level_minimums_.size(); }
+
  private:
+  void CheckNumStripes(std::size_t num_stripes) const {
+    if (num_stripes > num_stripes_) {
+      std::cerr << "`num_stripes` is out of bounds." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Writes the qualifying stripes among the first `num_stripes` ones as 64-bit
+  // words to `words`: for each value a row of (`num_stripes` + 63) / 64 words,
+  // or (if `combine` is set) a single row with the union over all `values`.
+  // Uses SIMD comparisons over `minimums_` and `maximums_` if available.
+  void ComputeQualifyingWords(absl::Span<const int> values,
+                              std::size_t num_stripes, bool combine,
+                              uint64_t* words) const;
+
+  // Sets `monotone_` and, if there are empty zones, the `range_*` members.
+  void DetectMonotoneZones();
+
+  // Builds `level_minimums_` and `level_maximums_`.
+  void BuildLevels();
+
+  // Sets the bits of the qualifying stripes among the first `num_stripes` ones
+  // in `words`. Requires monotone zones.
+  void SetQualifyingRange(int value, std::size_t num_stripes,
+                          uint64_t* words) const;
+
+  // Same as above, but descends the levels of coarser zones.
+  void SetQualifyingInLevels(int value, std::size_t num_stripes,
+                             uint64_t* words) const;
+
+  // Sets the bits of the qualifying stripes in the coarse `zone` at `level`.
+  void DescendLevels(std::size_t level, std::size_t zone,
+                     std::size_t zone_num_stripes, int value,
+                     std::size_t num_stripes, uint64_t* words) const;
+
   std::size_t num_stripes_;
   std::vector<int> minimums_, maximums_;
+  // Number of zones grouped into a coarser zone (0 for no hierarchy).
+  std::size_t fan_out_;
+  bool monotone_ = false;
+  // Only set for monotone zones with empty (i.e., all-null) zones: copies of
+  // `minimums_` and `maximums_` in which empty zones take the minimum of the
+  // next and the maximum of the previous non-empty zone (so both can be
+  // binary-searched), and the empty zones as bitmap words.
+  std::vector<int> range_minimums_, range_maximums_;
+  std::vector<uint64_t> empty_zone_words_;
+  // Minimums and maximums of the coarser zones, from the finest level (each
+  // zone spans `fan_out_` stripes) to the coarsest one (at most `fan_out_`
+  // zones).
+  std::vector<std::vector<int>> level_minimums_, level_maximums_;
 };
 
 class ZoneMapFactory : public IndexStructureFactory {
  public:
+  explicit ZoneMapFactory(size_t fan_out = 0) : fan_out_(fan_out) {}
+
   std::unique_ptr<IndexStructure> Create(
       const Column& column, size_t num_rows_per_stripe) const override {
-    return absl::make_unique<ZoneMap>(column.data(), num_rows_per_stripe);
+    return absl::make_unique<ZoneMap>(column.data(), num_rows_per_stripe,
+                                      fan_out_);
+  }
+
+  std::string index_name() const {
+    return fan_out_ == 0 ? "ZoneMap" : "ZoneMap/" + std::to_string(fan_out_);
   }
 
-  std::string index_name() const { return "ZoneMap"; }
+ private:
+  const size_t fan_out_;
 };
 
 }  // namespace ci
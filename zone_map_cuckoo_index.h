@@ -0,0 +1,115 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: zone_map_cuckoo_index.h
+// -----------------------------------------------------------------------------
+//
+// A composite index structure consisting of a ZoneMap and a CuckooIndex on the
+// same column. Lookups first check the (cheap) min/max values of all stripes
+// and only probe the CuckooIndex if the ZoneMap leaves enough candidate
+// stripes. This is particularly effective for sorted or dict-encoded columns.
+
+#ifndef CUCKOO_INDEX_ZONE_MAP_CUCKOO_INDEX_H_
+#define CUCKOO_INDEX_ZONE_MAP_CUCKOO_INDEX_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "data.h"
+#include "index_structure.h"
+#include "zone_map.h"
+
+namespace ci {
+
+class ZoneMapCuckooIndex : public IndexStructure {
+ public:
+  // `cuckoo_index` has to be built on the same column as `zone_map`. It is
+  // only probed if the share of stripes qualifying according to `zone_map` is
+  // larger than `min_candidate_share` (0.0 means it's probed whenever at least
+  // one stripe qualifies).
+  ZoneMapCuckooIndex(std::unique_ptr<ZoneMap> zone_map,
+                     IndexStructurePtr cuckoo_index,
+                     double min_candidate_share)
+      : zone_map_(std::move(zone_map)),
+        cuckoo_index_(std::move(cuckoo_index)),
+        min_candidate_share_(min_candidate_share) {}
+
+  bool StripeContains(size_t stripe_id, int value) const override {
+    return zone_map_->StripeContains(stripe_id, value) &&
+           cuckoo_index_->StripeContains(stripe_id, value);
+  }
+
+  Bitmap64 GetQualifyingStripes(int value, size_t num_stripes) const override {
+    const Bitmap64 candidates =
+        zone_map_->GetQualifyingStripes(value, num_stripes);
+    const size_t num_candidates = candidates.GetOnesCount();
+    if (num_candidates == 0 ||
+        num_candidates <= min_candidate_share_ * num_stripes) {
+      return candidates;
+    }
+    return cuckoo_index_->GetQualifyingStripesAmong(value, candidates);
+  }
+
+  std::string name() const override {
+    return absl::StrCat(zone_map_->name(), "+", cuckoo_index_->name());
+  }
+
+  size_t byte_size() const override {
+    return zone_map_->byte_size() + cuckoo_index_->byte_size();
+  }
+
+  size_t compressed_byte_size() const override {
+    return zone_map_->compressed_byte_size() +
+           cuckoo_index_->compressed_byte_size();
+  }
+
+ private:
+  const std::unique_ptr<ZoneMap> zone_map_;
+  const IndexStructurePtr cuckoo_index_;
+  const double min_candidate_share_;
+};
+
+class ZoneMapCuckooIndexFactory : public IndexStructureFactory {
+ public:
+  // `cuckoo_index_factory` creates the second-level index (usually a
+  // CuckooIndexFactory). See ZoneMapCuckooIndex for `min_candidate_share`.
+  ZoneMapCuckooIndexFactory(
+      std::unique_ptr<IndexStructureFactory> cuckoo_index_factory,
+      double min_candidate_share = 0.0)
+      : cuckoo_index_factory_(std::move(cuckoo_index_factory)),
+        min_candidate_share_(min_candidate_share) {}
+
+  std::unique_ptr<IndexStructure> Create(
+      const Column& column, size_t num_rows_per_stripe) const override {
+    return absl::make_unique<ZoneMapCuckooIndex>(
+        absl::make_unique<ZoneMap>(column, num_rows_per_stripe),
+        cuckoo_index_factory_->Create(column, num_rows_per_stripe),
+        min_candidate_share_);
+  }
+
+  std::string index_name() const override {
+    return absl::StrCat("ZoneMap+", cuckoo_index_factory_->index_name());
+  }
+
+ private:
+  const std::unique_ptr<IndexStructureFactory> cuckoo_index_factory_;
+  const double min_candidate_share_;
+};
+
+}  // namespace ci
+
+#endif  // CUCKOO_INDEX_ZONE_MAP_CUCKOO_INDEX_H_
@@ -0,0 +1,125 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: zone_map_cuckoo_index_test.cc
+// -----------------------------------------------------------------------------
+
+#include "zone_map_cuckoo_index.h"
+
+#include <vector>
+
+#include "cuckoo_index.h"
+#include "cuckoo_utils.h"
+#include "data.h"
+#include "gtest/gtest.h"
+
+namespace ci {
+
+constexpr size_t kNumRowsPerStripe = 4;
+
+// Returns a column of 100 stripes where stripe i contains the values i + 1 and
+// 1000 + i % 10 (i.e., the latter are spread out over many stripes).
+ColumnPtr CreateColumn() {
+  std::vector<int> data;
+  for (int stripe_id = 0; stripe_id < 100; ++stripe_id) {
+    data.push_back(stripe_id + 1);
+    data.push_back(stripe_id + 1);
+    data.push_back(1000 + stripe_id % 10);
+    data.push_back(stripe_id + 1);
+  }
+  return Column::IntColumn("column", std::move(data));
+}
+
+std::unique_ptr<IndexStructureFactory> CreateFactory(
+    double min_candidate_share) {
+  return absl::make_unique<ZoneMapCuckooIndexFactory>(
+      absl::make_unique<CuckooIndexFactory>(
+          CuckooAlgorithm::SKEWED_KICKING, kMaxLoadFactor1SlotsPerBucket,
+          /*scan_rate=*/0.01, /*slots_per_bucket=*/1,
+          /*prefix_bits_optimization=*/false),
+      min_candidate_share);
+}
+
+TEST(ZoneMapCuckooIndexTest, PositiveLookupsAreExact) {
+  const ColumnPtr column = CreateColumn();
+  const size_t num_stripes = column->num_rows() / kNumRowsPerStripe;
+  const IndexStructurePtr index =
+      CreateFactory(/*min_candidate_share=*/0.0)
+          ->Create(*column, kNumRowsPerStripe);
+  for (const int value : column->distinct_values()) {
+    const Bitmap64 result = index->GetQualifyingStripes(value, num_stripes);
+    for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+      EXPECT_EQ(result.Get(stripe_id),
+                column->StripeContains(kNumRowsPerStripe, stripe_id, value));
+      EXPECT_EQ(index->StripeContains(stripe_id, value),
+                column->StripeContains(kNumRowsPerStripe, stripe_id, value));
+    }
+  }
+}
+
+TEST(ZoneMapCuckooIndexTest, ResultIsIntersection) {
+  const ColumnPtr column = CreateColumn();
+  const size_t num_stripes = column->num_rows() / kNumRowsPerStripe;
+  const IndexStructurePtr index =
+      CreateFactory(/*min_candidate_share=*/0.0)
+          ->Create(*column, kNumRowsPerStripe);
+  const ZoneMap zone_map(*column, kNumRowsPerStripe);
+  // Negative lookups (within and outside of the column's domain).
+  for (const int value : {-5, 500, 999, 1010, 5000}) {
+    const Bitmap64 zone_map_result =
+        zone_map.GetQualifyingStripes(value, num_stripes);
+    const Bitmap64 result = index->GetQualifyingStripes(value, num_stripes);
+    for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+      if (result.Get(stripe_id)) {
+        EXPECT_TRUE(zone_map_result.Get(stripe_id));
+      }
+    }
+  }
+}
+
+TEST(ZoneMapCuckooIndexTest, SkipsCuckooIndexForFewCandidates) {
+  const ColumnPtr column = CreateColumn();
+  const size_t num_stripes = column->num_rows() / kNumRowsPerStripe;
+  // The CuckooIndex is only probed if more than half the stripes qualify.
+  const IndexStructurePtr index =
+      CreateFactory(/*min_candidate_share=*/0.5)
+          ->Create(*column, kNumRowsPerStripe);
+  const ZoneMap zone_map(*column, kNumRowsPerStripe);
+
+  // Value 5 qualifies for only a few stripes in the ZoneMap, whose result is
+  // returned as is.
+  EXPECT_EQ(index->GetQualifyingStripes(5, num_stripes).ToString(),
+            zone_map.GetQualifyingStripes(5, num_stripes).ToString());
+  // Value 1003 qualifies for all stripes in the ZoneMap, the CuckooIndex
+  // prunes this down to the exact result.
+  const Bitmap64 result = index->GetQualifyingStripes(1003, num_stripes);
+  for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id) {
+    EXPECT_EQ(result.Get(stripe_id),
+              column->StripeContains(kNumRowsPerStripe, stripe_id, 1003));
+  }
+}
+
+TEST(ZoneMapCuckooIndexTest, SizeIsSumOfComponents) {
+  const ColumnPtr column = CreateColumn();
+  const IndexStructurePtr index =
+      CreateFactory(/*min_candidate_share=*/0.0)
+          ->Create(*column, kNumRowsPerStripe);
+  const ZoneMap zone_map(*column, kNumRowsPerStripe);
+  EXPECT_GT(index->byte_size(), zone_map.byte_size());
+  EXPECT_GT(index->compressed_byte_size(), zone_map.compressed_byte_size());
+  EXPECT_EQ(index->name().rfind("ZoneMap+CuckooIndex", 0), 0);
+}
+
+}  // namespace ci
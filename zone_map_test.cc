@@ -18,6 +18,11 @@
 
 #include "zone_map.h"
 
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace ci {
@@ -78,4 +83,168 @@ TEST(ZoneMapTest, NullValuesAreIgnored) {
   EXPECT_FALSE(zone_map.StripeContains(/*stripe_id=*/1, /*value=*/7));
 }
 
+TEST(ZoneMapTest, GetQualifyingStripesMatchesStripeContains) {
+  std::vector<int> data;
+  // 150 stripes (more than two 64-bit words) with overlapping ranges.
+  for (int i = 0; i < 300; ++i) data.push_back(i % 7 == 0 ? i / 3 : i / 2);
+  ZoneMap zone_map(data, /*num_rows_per_stripe=*/2);
+
+  for (int value = -1; value < 160; ++value) {
+    const Bitmap64 result =
+        zone_map.GetQualifyingStripes(value, /*num_stripes=*/150);
+    ASSERT_EQ(result.bits(), 150);
+    for (size_t stripe_id = 0; stripe_id < 150; ++stripe_id)
+      ASSERT_EQ(result.Get(stripe_id),
+                zone_map.StripeContains(stripe_id, value));
+  }
+}
+
+TEST(ZoneMapTest, GetQualifyingStripesBatchAndIn) {
+  std::vector<int> data;
+  for (int i = 0; i < 300; ++i) data.push_back(i % 7 == 0 ? i / 3 : i / 2);
+  ZoneMap zone_map(data, /*num_rows_per_stripe=*/2);
+  const std::vector<int> values = {-1, 0, 17, 42, 73, 149, 200};
+
+  // Also probe a prefix of the stripes that doesn't end at a word boundary.
+  for (const size_t num_stripes : {150, 131, 64, 5}) {
+    const std::vector<Bitmap64> batch =
+        zone_map.GetQualifyingStripesBatch(values, num_stripes);
+    ASSERT_EQ(batch.size(), values.size());
+    Bitmap64 expected_in(/*size=*/num_stripes);
+    for (size_t i = 0; i < values.size(); ++i) {
+      const Bitmap64 expected =
+          zone_map.GetQualifyingStripes(values[i], num_stripes);
+      EXPECT_EQ(batch[i].TrueBitIndices(), expected.TrueBitIndices());
+      expected_in |= expected;
+    }
+    EXPECT_EQ(zone_map.GetQualifyingStripesIn(values, num_stripes)
+                  .TrueBitIndices(),
+              expected_in.TrueBitIndices());
+  }
+}
+
+// Checks that all lookup methods of `zone_map` agree with StripeContains(..).
+void ExpectLookupsMatchStripeContains(const ZoneMap& zone_map,
+                                      size_t num_stripes, int max_value) {
+  std::vector<int> values;
+  for (int value = -1; value <= max_value + 1; ++value) {
+    values.push_back(value);
+    const Bitmap64 result = zone_map.GetQualifyingStripes(value, num_stripes);
+    ASSERT_EQ(result.bits(), num_stripes);
+    for (size_t stripe_id = 0; stripe_id < num_stripes; ++stripe_id)
+      ASSERT_EQ(result.Get(stripe_id),
+                zone_map.StripeContains(stripe_id, value))
+          << "value " << value << ", stripe " << stripe_id;
+  }
+  const std::vector<Bitmap64> batch =
+      zone_map.GetQualifyingStripesBatch(values, num_stripes);
+  Bitmap64 expected_in(/*size=*/num_stripes);
+  for (size_t i = 0; i < values.size(); ++i) {
+    const Bitmap64 expected =
+        zone_map.GetQualifyingStripes(values[i], num_stripes);
+    EXPECT_EQ(batch[i].TrueBitIndices(), expected.TrueBitIndices());
+    if (i % 3 == 0) expected_in |= expected;
+  }
+  std::vector<int> in_values;
+  for (size_t i = 0; i < values.size(); i += 3) in_values.push_back(values[i]);
+  EXPECT_EQ(
+      zone_map.GetQualifyingStripesIn(in_values, num_stripes).TrueBitIndices(),
+      expected_in.TrueBitIndices());
+}
+
+TEST(ZoneMapTest, MonotoneZonesAreBinarySearched) {
+  // Sorted data with runs spanning several stripes.
+  std::vector<int> data;
+  for (int i = 0; i < 1000; ++i) data.push_back(i / 7);
+  ZoneMap zone_map(data, /*num_rows_per_stripe=*/4, /*fan_out=*/8);
+  EXPECT_TRUE(zone_map.monotone());
+  EXPECT_EQ(zone_map.num_levels(), 0);
+
+  ExpectLookupsMatchStripeContains(zone_map, /*num_stripes=*/250,
+                                   /*max_value=*/142);
+  ExpectLookupsMatchStripeContains(zone_map, /*num_stripes=*/77,
+                                   /*max_value=*/142);
+}
+
+TEST(ZoneMapTest, MonotoneZonesWithEmptyZones) {
+  // Stripes 0 (leading zeros), 100 and 249 only contain nulls.
+  std::vector<int> data;
+  for (int i = 0; i < 1000; ++i)
+    data.push_back(i / 4 == 100 || i / 4 == 249 ? Column::kIntNullSentinel
+                                                : i / 7);
+  ZoneMap zone_map(data, /*num_rows_per_stripe=*/4, /*fan_out=*/8);
+  EXPECT_TRUE(zone_map.monotone());
+  EXPECT_FALSE(zone_map.StripeContains(/*stripe_id=*/100, /*value=*/57));
+
+  ExpectLookupsMatchStripeContains(zone_map, /*num_stripes=*/250,
+                                   /*max_value=*/142);
+  ExpectLookupsMatchStripeContains(zone_map, /*num_stripes=*/101,
+                                   /*max_value=*/142);
+}
+
+TEST(ZoneMapTest, HierarchicalZones) {
+  // Clustered, but not sorted data.
+  std::vector<int> data;
+  for (int i = 0; i < 2000; ++i) data.push_back((i / 100) % 2 == 0 ? i : -i);
+  // With a fan-out of 80, leaf zones straddle bitmap words.
+  for (const size_t fan_out : {2, 3, 16, 80}) {
+    ZoneMap zone_map(data, /*num_rows_per_stripe=*/5, fan_out);
+    EXPECT_FALSE(zone_map.monotone());
+    EXPECT_GT(zone_map.num_levels(), 0);
+    EXPECT_EQ(zone_map.name(), "ZoneMap/" + std::to_string(fan_out));
+
+    ExpectLookupsMatchStripeContains(zone_map, /*num_stripes=*/400,
+                                     /*max_value=*/2000);
+    ExpectLookupsMatchStripeContains(zone_map, /*num_stripes=*/123,
+                                     /*max_value=*/2000);
+  }
+}
+
+TEST(ZoneMapTest, QualifyingBitsKernelsAgree) {
+  using zone_map_internal::GetQualifyingBitsKernels;
+  using zone_map_internal::QualifyingBitsKernel;
+  constexpr int kMin = std::numeric_limits<int>::min();
+  constexpr int kMax = std::numeric_limits<int>::max();
+  const std::vector<int> edge_values = {kMin, kMin + 1, -1, 0, 1, kMax - 1,
+                                        kMax};
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<size_t> edge_value_d(0, edge_values.size());
+  std::uniform_int_distribution<int> value_d(kMin, kMax);
+  // Returns an edge value or (with the same probability as each of them) a
+  // random one.
+  const auto draw_value = [&]() {
+    const size_t i = edge_value_d(gen);
+    return i < edge_values.size() ? edge_values[i] : value_d(gen);
+  };
+
+  const std::vector<QualifyingBitsKernel> kernels = GetQualifyingBitsKernels();
+  ASSERT_STREQ(kernels[0].name, "scalar");
+  // Covers remainders of the vector widths (4 and 8 zones).
+  for (size_t num_zones = 0; num_zones <= 64; ++num_zones) {
+    // Includes empty zones (min > max).
+    std::vector<int> minimums(num_zones);
+    std::vector<int> maximums(num_zones);
+    for (size_t i = 0; i < num_zones; ++i) {
+      minimums[i] = draw_value();
+      maximums[i] = draw_value();
+    }
+    std::vector<int> values = edge_values;
+    for (size_t i = 0; i < 10; ++i) values.push_back(value_d(gen));
+    values.insert(values.end(), minimums.begin(), minimums.end());
+    values.insert(values.end(), maximums.begin(), maximums.end());
+
+    for (const int value : values) {
+      const uint64_t expected = kernels[0].fn(minimums.data(), maximums.data(),
+                                              num_zones, value);
+      for (const QualifyingBitsKernel& kernel : kernels) {
+        EXPECT_EQ(
+            kernel.fn(minimums.data(), maximums.data(), num_zones, value),
+            expected)
+            << kernel.name << ", num_zones: " << num_zones
+            << ", value: " << value;
+      }
+    }
+  }
+}
+
 }  // namespace ci